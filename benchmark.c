@@ -0,0 +1,405 @@
+// Scaling benchmark for the scheduling policies of simulator.c
+// Every policy runs on generated workloads of 10^3 .. 10^7 processes, the result is
+// printed as a table and written to bench.json (one run per line), so two builds can
+// be compared with --baseline.
+//
+// gcc -O2 benchmark.c -o benchmark -lm
+// ./benchmark [--max N] [--budget seconds] [--series] [--threads N] [--out file] [--baseline file] [--threshold percent]
+//
+// --max       : largest workload (default 10000000)
+// --budget    : a policy taking longer than this on one workload skips the larger ones (default 10)
+// --series    : keep the time series on while measuring (off by default)
+// --threads   : threads a run may use, only FCFS built with -DSIM_PTHREADS=1 -pthread splits its work (default 1)
+// --out       : where the JSON goes (default bench.json)
+// --baseline  : earlier bench.json, every run slower by more than --threshold percent (default 10)
+//               in ns per decision is reported and the exit code is 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+// every allocation made by the simulator goes through these
+long long bench_allocations;
+long long bench_allocated_bytes;
+
+void *bench_malloc(size_t size)
+{
+    bench_allocations++;
+    bench_allocated_bytes += size;
+    return malloc(size);
+}
+
+void *bench_calloc(size_t count, size_t size)
+{
+    bench_allocations++;
+    bench_allocated_bytes += count * size;
+    return calloc(count, size);
+}
+
+void *bench_realloc(void *pointer, size_t size)
+{
+    bench_allocations++;
+    bench_allocated_bytes += size;
+    return realloc(pointer, size);
+}
+
+#define malloc(size) bench_malloc(size)
+#define calloc(count, size) bench_calloc(count, size)
+#define realloc(pointer, size) bench_realloc(pointer, size)
+
+#define SIMULATOR_NO_MAIN
+#include "simulator.c"
+
+#undef malloc
+#undef calloc
+#undef realloc
+
+#define MIN_SIZE 1000
+#define MAX_SIZE 10000000
+#define MIN_TIME 0.1       // small workloads are repeated until they took this long, the fastest run counts
+#define LOAD 0.9           // offered load of the generated workloads
+#define MAX_RUNS 64        // (8 policies * 5 sizes) plus room for a baseline file
+#define TIME_QUANTUM 2
+
+struct bench_run
+{
+    char policy[32];
+    int n;
+    long long decisions;
+    double seconds;
+    double decisions_per_sec;
+    double ns_per_decision;
+    long peak_rss_kb;
+    long long allocations;      // first run of a fresh context
+    long long allocated_bytes;  // first run of a fresh context
+    long long warm_allocations; // a repetition, once the context's arena fits the run
+};
+typedef struct bench_run bench_run;
+
+double now_seconds();
+long peak_rss_kb();
+int bench_policy(sim_context *ctx, int algorithm, process *ps, int n, bench_run *run);
+int read_baseline(char *file, bench_run *runs);
+void write_json(char *file, bench_run *runs, int no_of_runs);
+int compare_baseline(bench_run *runs, int no_of_runs, bench_run *baseline, int no_of_baseline, double threshold);
+
+int main(int argc, char *argv[])
+{
+    int max_size = MAX_SIZE;
+    double budget = 10;
+    char *output = "bench.json";
+    char *baseline_file = NULL;
+    double threshold = 10;
+    int track_series = 0;
+    int threads = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+        {
+            max_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            budget = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--series") == 0)
+        {
+            track_series = 1;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+        {
+            threshold = atof(argv[++i]);
+        }
+        else
+        {
+            printf("\nUnknown option %s", argv[i]);
+            return 2;
+        }
+    }
+
+    bench_run runs[MAX_RUNS];
+    int no_of_runs = 0;
+    int skipped[8] = {0};
+
+    printf("%-12s %10s %12s %14s %14s %12s %12s %12s\n", "Policy", "Processes", "Decisions", "Decisions/s",
+           "ns/decision", "Peak-RSS-KB", "Allocations", "Warm-Allocs");
+
+    for (int n = MIN_SIZE; n <= max_size; n *= 10)
+    {
+        process *ps = malloc(n * sizeof(process));
+        if (ps == NULL)
+        {
+            printf("\nNot enough memory for %d processes", n);
+            break;
+        }
+        sim_context *ctx = sim_create();
+        if (ctx == NULL)
+        {
+            printf("\nNot enough memory for a context");
+            free(ps);
+            break;
+        }
+        sim_seed(ctx, n); // every build measures the same workloads
+        generate_workload(ctx, ps, n, LOAD);
+
+        for (int k = 0; k < 8; k++)
+        {
+            if (skipped[k])
+            {
+                continue;
+            }
+
+            // a fresh context per policy, so allocations show what one cold run costs
+            sim_context *run_ctx = sim_create();
+            if (run_ctx == NULL)
+            {
+                break;
+            }
+            run_ctx->track_series = track_series;
+            sim_set_threads(run_ctx, threads);
+            sim_seed(run_ctx, n);
+
+            bench_run *run = &runs[no_of_runs];
+            int completed = bench_policy(run_ctx, k, ps, n, run);
+            sim_destroy(run_ctx);
+            if (!completed)
+            {
+                printf("%-12s %10d   out of memory\n", algorithm_names[k], n);
+                skipped[k] = 1;
+                continue;
+            }
+            no_of_runs++;
+
+            printf("%-12s %10d %12lld %14.0f %14.2f %12ld %12lld %12lld\n", run->policy, run->n, run->decisions,
+                   run->decisions_per_sec, run->ns_per_decision, run->peak_rss_kb, run->allocations,
+                   run->warm_allocations);
+            fflush(stdout);
+
+            if (run->seconds > budget)
+            {
+                // growing the workload ten times would only take longer
+                skipped[k] = 1;
+            }
+        }
+
+        sim_destroy(ctx);
+        free(ps);
+        if (n > INT_MAX / 10)
+        {
+            break;
+        }
+    }
+
+    write_json(output, runs, no_of_runs);
+    printf("\nWrote %d runs to %s\n", no_of_runs, output);
+
+    if (baseline_file != NULL)
+    {
+        bench_run baseline[MAX_RUNS];
+        int no_of_baseline = read_baseline(baseline_file, baseline);
+        if (no_of_baseline < 0)
+        {
+            printf("\nCould not open %s\n", baseline_file);
+            return 2;
+        }
+        return compare_baseline(runs, no_of_runs, baseline, no_of_baseline, threshold) > 0;
+    }
+    return 0;
+}
+
+double now_seconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// peak resident memory of the whole benchmark so far, it never goes down between runs
+long peak_rss_kb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return (long)(counters.PeakWorkingSetSize / 1024);
+    }
+    return -1;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// 0 when the policy ran out of memory
+int bench_policy(sim_context *ctx, int algorithm, process *ps, int n, bench_run *run)
+{
+    double best = -1, spent = 0;
+    long long decisions = 0, allocations = -1, allocated_bytes = 0, warm_allocations = -1;
+
+    // the second run may still resize the arena to what the first one needed, the third shows the steady state
+    for (int repetition = 0; repetition < 3 || spent < MIN_TIME; repetition++)
+    {
+        // policies only write the results of ps, every repetition sees the same workload
+        initialize_final_result(ctx->final_result);
+        bench_allocations = 0;
+        bench_allocated_bytes = 0;
+
+        double start = now_seconds();
+        run_algorithm(ctx, algorithm, ps, n, TIME_QUANTUM);
+        double seconds = now_seconds() - start;
+
+        if (ctx->final_result[algorithm].tat_stats.count < n)
+        {
+            return 0;
+        }
+        if (best < 0 || seconds < best)
+        {
+            best = seconds;
+        }
+        spent += seconds;
+        decisions = ctx->final_result[algorithm].decisions;
+        if (allocations == -1)
+        {
+            // first run of a fresh context, later ones reuse its arena
+            allocations = bench_allocations;
+            allocated_bytes = bench_allocated_bytes;
+        }
+        else if (warm_allocations == -1 || bench_allocations < warm_allocations)
+        {
+            warm_allocations = bench_allocations;
+        }
+    }
+
+    strcpy(run->policy, algorithm_names[algorithm]);
+    run->n = n;
+    run->decisions = decisions;
+    run->seconds = best;
+    run->decisions_per_sec = best > 0 ? decisions / best : 0;
+    run->ns_per_decision = decisions > 0 ? best * 1e9 / decisions : 0;
+    run->peak_rss_kb = peak_rss_kb();
+    run->allocations = allocations;
+    run->allocated_bytes = allocated_bytes;
+    run->warm_allocations = warm_allocations;
+    return 1;
+}
+
+void write_json(char *file, bench_run *runs, int no_of_runs)
+{
+    FILE *fptr = fopen(file, "w");
+    if (fptr == NULL)
+    {
+        printf("\nCould not open %s", file);
+        return;
+    }
+
+    // one run per line, read_baseline depends on it
+    fprintf(fptr, "{\"benchmark\": \"scheduler-scaling\", \"runs\": [\n");
+    for (int i = 0; i < no_of_runs; i++)
+    {
+        bench_run *run = &runs[i];
+        fprintf(fptr,
+                "{\"policy\": \"%s\", \"n\": %d, \"decisions\": %lld, \"seconds\": %.9f, \"decisions_per_sec\": %.2f, "
+                "\"ns_per_decision\": %.3f, \"peak_rss_kb\": %ld, \"allocations\": %lld, \"allocated_bytes\": %lld, "
+                "\"warm_allocations\": %lld}%s\n",
+                run->policy, run->n, run->decisions, run->seconds, run->decisions_per_sec, run->ns_per_decision,
+                run->peak_rss_kb, run->allocations, run->allocated_bytes, run->warm_allocations,
+                i + 1 < no_of_runs ? "," : "");
+    }
+    fprintf(fptr, "]}\n");
+    fclose(fptr);
+}
+
+// -1 when the file cannot be opened
+int read_baseline(char *file, bench_run *runs)
+{
+    FILE *fptr = fopen(file, "r");
+    if (fptr == NULL)
+    {
+        return -1;
+    }
+
+    char line[512];
+    int count = 0;
+    while (count < MAX_RUNS && fgets(line, sizeof(line), fptr) != NULL)
+    {
+        bench_run *run = &runs[count];
+        if (sscanf(line,
+                   "{\"policy\": \"%31[^\"]\", \"n\": %d, \"decisions\": %lld, \"seconds\": %lf, \"decisions_per_sec\": %lf, "
+                   "\"ns_per_decision\": %lf, \"peak_rss_kb\": %ld, \"allocations\": %lld, \"allocated_bytes\": %lld",
+                   run->policy, &run->n, &run->decisions, &run->seconds, &run->decisions_per_sec, &run->ns_per_decision,
+                   &run->peak_rss_kb, &run->allocations, &run->allocated_bytes) == 9)
+        {
+            count++;
+        }
+    }
+    fclose(fptr);
+    return count;
+}
+
+// returns the no. of regressions
+int compare_baseline(bench_run *runs, int no_of_runs, bench_run *baseline, int no_of_baseline, double threshold)
+{
+    int regressions = 0;
+    printf("\nComparison with baseline (threshold %.1f%%) :\n", threshold);
+    printf("%-12s %10s %14s %14s %9s\n", "Policy", "Processes", "Baseline-ns", "Current-ns", "Change");
+
+    for (int i = 0; i < no_of_runs; i++)
+    {
+        for (int j = 0; j < no_of_baseline; j++)
+        {
+            if (runs[i].n != baseline[j].n || strcmp(runs[i].policy, baseline[j].policy) != 0)
+            {
+                continue;
+            }
+
+            double change = baseline[j].ns_per_decision > 0
+                                ? 100 * (runs[i].ns_per_decision - baseline[j].ns_per_decision) / baseline[j].ns_per_decision
+                                : 0;
+            int regressed = change > threshold;
+            printf("%-12s %10d %14.2f %14.2f %+8.1f%%%s\n", runs[i].policy, runs[i].n, baseline[j].ns_per_decision,
+                   runs[i].ns_per_decision, change, regressed ? "  REGRESSION" : "");
+            if (runs[i].allocations > baseline[j].allocations)
+            {
+                printf("%-12s %10d   allocations %lld -> %lld\n", runs[i].policy, runs[i].n, baseline[j].allocations,
+                       runs[i].allocations);
+            }
+            regressions += regressed;
+            break;
+        }
+    }
+
+    printf("\n%d regression(s)\n", regressions);
+    return regressions;
+}
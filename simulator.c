@@ -25,37 +25,36 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <limits.h>
+#include <sys/stat.h>
 
-int debug_RR = 0;       // to debug round robin
-int debug_PRIORITY = 0; // to debug Priority
-int debug_LOTTERY = 0;  // to debug Lottery
-int debug_FCFS = 0;     // to debug FCFS
-int debug_SJF = 0;      // to debug SJF
-int debug_SRTN = 0;     // to debug SRTN
-int debug_HRRN = 0;     // to debug HRRN
-int debug_EDF = 1;      // to debug EDF
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
-FILE *fptr_write;
-
-int result_in_file = 0;     // to show result in file [1 : yes, 0 : no]
-int result_on_terminal = 1; // to show result on terminal [1 : yes, 0 : no]
+#include "simulator.h"
 
 struct process
 {
-    int id;  // process id
-    int at;  // arrival time
-    int bt;  // burst time
-    int rbt; // remaining bt
+    int id; // process id
+    int at; // arrival time
+    int bt; // burst time
     int period;
-    int current_deadline;
     int no_of_execution;
-    int no_of_execution_buffer;
 
     int priority;   // for priority scheduling algorithm
     int tickets[2]; // to maintain tickets {0:lower-ticket, 1:upper-ticket}
+    int quantum;    // time quantum of its own in RR and Lottery (weighted RR), 0 : the run's
+    int cpu_burst;  // I/O-bound : cpu time between two I/O requests, 0 : bt in one go
+    int io_wait;    // I/O-bound : time the device takes to serve one request
 
     int ct;     // completion time
     double wt;  // waiting time
@@ -64,72 +63,1039 @@ struct process
 };
 typedef struct process process;
 
+// Log-linear histogram : values below HIST_SUB_BUCKETS are exact, above that every
+// power of two is split into HIST_SUB_BUCKETS / 2 buckets (~3% relative error).
+#define HIST_SUB_BUCKETS 32
+#define HIST_BUCKETS 448 // enough for every non-negative int time value
+
+struct latency_stats
+{
+    long long count; // no. of samples recorded
+    double mean;     // running mean (Welford)
+    double m2;       // sum of squared differences from the mean (Welford)
+    double min;
+    double max;
+    long long buckets[HIST_BUCKETS]; // histogram used for percentiles
+};
+typedef struct latency_stats latency_stats;
+
+#define SERIES_CAPACITY 256 // windows kept in memory, older ones are only in series.csv
+
+struct series_window
+{
+    int start;            // window start time
+    int width;            // window length (last window of a run can be shorter)
+    int busy;             // time the cpu spent running processes
+    int completions;      // processes completed in the window
+    int context_switch;   // context-switches in the window
+    long long queue_area; // run-queue length summed over every time unit of the window
+};
+typedef struct series_window series_window;
+
+struct time_series
+{
+    int algorithm;      // index into final_result, used for series.csv
+    int tracked;        // 1 when the run fills the series, the engine reports its arrivals
+    int in_system;      // arrived but not yet completed processes
+    int clock;          // time up to which the series is filled
+    int width;          // width of every window (time units)
+    FILE *fptr;         // the context's series file, NULL when windows stay in memory only
+
+    series_window current;                  // window being filled
+    series_window windows[SERIES_CAPACITY]; // ring of closed windows
+    int head;                               // oldest window in the ring
+    int count;                              // windows in the ring
+    long long dropped;                      // windows pushed out of the ring
+};
+typedef struct time_series time_series;
+
+// Binary schedule trace : fixed size records collected in a buffer while a policy
+// runs and written to the context's trace file in blocks, trace_export.c turns them into Chrome JSON.
+#define TRACE_CAPACITY 65536 // records per block, must be a power of two
+#define TRACE_MAGIC "SCHTRC01"
+
+#define TRACE_RUN 0      // a policy starts, pid holds its index into final_result
+#define TRACE_SLICE 1    // process pid held cpu from time for duration
+#define TRACE_COMPLETE 2 // process pid completed at time
+
+struct trace_record
+{
+    int time;     // when the event happened
+    int duration; // length of a slice, 0 for the other events
+    short cpu;    // cpu the event happened on
+    short event;  // TRACE_RUN, TRACE_SLICE or TRACE_COMPLETE
+    int pid;      // process id
+};
+typedef struct trace_record trace_record;
+
+struct trace_buffer
+{
+    trace_record *records; // TRACE_CAPACITY records, NULL while tracing is off
+    int count;             // records in the current block
+    long long total;       // records in the current run
+    FILE *fptr;            // trace file, when it is NULL the buffer keeps only the newest records
+};
+typedef struct trace_buffer trace_buffer;
+
 struct result
 {
-    double awt;         // average waiting-time
-    double att;         // average turn-around time
-    double art;         // average response time
-    int context_switch; // context-switches
-    double throughput;  // no. of processes completed per unit time
+    double awt;          // average waiting-time
+    double att;          // average turn-around time
+    double art;          // average response time
+    int context_switch;  // context-switches
+    double throughput;   // no. of processes completed per unit time
+    long long decisions; // times the scheduler picked a process to run
+
+    latency_stats wt_stats;  // waiting-time distribution
+    latency_stats tat_stats; // turn-around time distribution
+    latency_stats rt_stats;  // response-time distribution
+
+    int busy_time;          // time the cpu spent running processes
+    int idle_time;          // time the cpu had nothing to run
+    double cpu_utilization; // busy_time / total time
+    time_series series;     // windowed utilization, run-queue, throughput, context-switches
+
+    latency_stats burst_stats; // I/O-bound : wait from a served I/O request to the cpu (interactive latency)
+    int io_busy;               // time the I/O device spent serving requests
+    double io_utilization;     // io_busy / total time
+
+    int overhead_time;     // cost model : time the cpu spent switching processes and warming their caches
+    double overhead_share; // overhead_time / total time
 };
 typedef struct result result;
 
+// Result cache : one file per run in a local directory, named by a 64-bit hash of the
+// workload and everything else the run depends on. Entries written by another
+// SIM_VERSION_TAG are never read, so changing any simulated number only needs a new tag.
+#define CACHE_MAGIC "SIMRES01"
+
+struct cache_header
+{
+    char magic[8];
+    char version[32];         // SIM_VERSION_TAG of the simulator that wrote the entry
+    unsigned long long key;   // run_key of the run
+    int algorithm;
+    int n;
+    int has_outputs;          // ct / wt / tat / rt of every process follow the aggregates
+    unsigned long long seed;  // random no. generator after the run (Lottery draws from it)
+};
+typedef struct cache_header cache_header;
+
+// the parts of result a run produces, stored as they are
+struct cache_result
+{
+    double awt;
+    double att;
+    double art;
+    int context_switch;
+    double throughput;
+    long long decisions;
+    latency_stats wt_stats;
+    latency_stats tat_stats;
+    latency_stats rt_stats;
+    int busy_time;
+    int idle_time;
+    double cpu_utilization;
+    latency_stats burst_stats;
+    int io_busy;
+    double io_utilization;
+    int overhead_time;
+    double overhead_share;
+};
+typedef struct cache_result cache_result;
+
+// Scheduling engine : one event loop runs every policy, a policy only says how its
+// ready queue is ordered and when the running process has to give up the cpu.
+#define QUEUE_FIFO 0    // first come first served (RR, FCFS)
+#define QUEUE_HEAP 1    // smallest key first, ties in queueing order (Priority, SJF, SRTN, EDF)
+#define QUEUE_LOTTERY 2 // random ticket among the ready processes (Lottery)
+#define QUEUE_SCAN 3    // key changes with the clock, scanned on every pick (HRRN)
+
+#define KEY_NONE 0
+#define KEY_PRIORITY 1  // smaller number runs first
+#define KEY_BURST 2     // burst time
+#define KEY_REMAINING 3 // remaining burst time
+#define KEY_DEADLINE 4  // current deadline
+
+struct policy
+{
+    int algorithm;    // index into final_result
+    int queue;        // QUEUE_FIFO, QUEUE_HEAP, QUEUE_LOTTERY or QUEUE_SCAN
+    int key;          // what a QUEUE_HEAP is ordered by
+    int uses_quantum; // running process goes back to the queue after time_quantum [1 : yes, 0 : no]
+    int preemptive;   // an arrival with a smaller key takes the cpu [1 : yes, 0 : no]
+    int periodic;     // every process is released no_of_execution times, once per period [1 : yes, 0 : no]
+};
+typedef struct policy policy;
+
+struct queue_entry
+{
+    long long key; // ordering key (arrival or release time outside of the ready queue)
+    int seq;       // order in which entries were queued, breaks ties
+    int index;     // index into ps
+};
+typedef struct queue_entry queue_entry;
+
+// What one run changes, allocated from the context's arena : the workload itself is only read,
+// so the same processes can go through every policy without being copied or reset.
+struct run_state
+{
+    int *remaining; // burst time left of the current job
+    int *first_run; // when the current job first got the cpu, -1 before
+    int *release;   // periodic : release time of the current job
+    int *jobs_left; // periodic : jobs not yet completed
+    int *ct;        // completion time (of the last job)
+    double *wt;     // waiting time, averaged over the jobs when periodic
+    double *tat;    // turn-around time, averaged over the jobs when periodic
+    double *rt;     // response time, averaged over the jobs when periodic
+    int *cpu_left;  // I/O-bound : cpu time of the job after the current burst
+    int *blocked;   // I/O-bound : time the current job spent blocked on I/O
+    int *woken;     // I/O-bound : when its last I/O request was served, -1 once it got the cpu
+    int *last_ran;  // cost model : when the process last left the cpu, -1 before
+};
+typedef struct run_state run_state;
+
+// FCFS as a max-plus scan : in arrival order ct[k] = max(ct[k - 1], at[k]) + bt[k], and the
+// maps x -> max(x + a, b) stay of that form when composed ((a1, b1) then (a2, b2) is
+// (a1 + a2, max(b1 + a2, b2))). Every chunk of jobs first folds into one (a, b), the folds
+// give every chunk the completion time it starts after, then the chunks fill in their jobs
+// independently. fcfs_scan is used when nothing watches the run slice by slice.
+#define SCAN_MIN_CHUNK 65536 // jobs below which another thread costs more than it saves
+#define MAX_SCAN_THREADS 64
+
+struct scan_chunk
+{
+    const process *ps;
+    const queue_entry *order; // arrival order of ps, NULL when ps already is in arrival order
+    run_state *state;         // where ct / wt / tat / rt go
+    int first;                // chunk is jobs [first, last) of the arrival order
+    int last;
+
+    long long a;     // the chunk is x -> max(x + a, b) : total burst
+    long long b;     // and completion of its last job when the cpu is free from the start
+    long long carry; // completion time of the job before the chunk
+    int fill;        // scan_worker : 0 fold, 1 fill
+
+    latency_stats wt_stats; // samples of the chunk, merged in chunk order
+    latency_stats tat_stats;
+    latency_stats rt_stats;
+};
+typedef struct scan_chunk scan_chunk;
+
+// Checkpoints : a baseline run keeps a snapshot of the engine every so many arrivals, taken at
+// the top of the loop once the arrivals of that time are queued. A snapshot only holds what is
+// in flight (the ready queue and the running process), processes completed by then take their
+// outcome from the baseline's final state and the ones not yet arrived start fresh. A what-if
+// run over a changed workload resumes from the last snapshot before the first change and stops
+// at the first later snapshot its state matches again, the rest of the schedule is the baseline's.
+#define CHECKPOINTS_DEFAULT 256 // snapshots a baseline aims for when no interval is given
+#define CHECKPOINT_MIN_INTERVAL 64
+
+struct checkpoint_entry
+{
+    queue_entry entry; // as it was in the ready queue (FIFO : index only)
+    int remaining;
+    int first_run;
+};
+typedef struct checkpoint_entry checkpoint_entry;
+
+struct checkpoint_stats
+{
+    long long count; // a latency_stats less its histogram, rebuilt from the jobs themselves
+    double mean;     // when a what-if run resumes or converges at the snapshot
+    double m2;
+    double min;
+    double max;
+};
+typedef struct checkpoint_stats checkpoint_stats;
+
+struct checkpoint
+{
+    int now;
+    int running;
+    int slice_start;
+    int slice_end;
+    int previous;
+    int seq;
+    int next_order;
+    int completed;
+    int ready;
+    int first_entry;       // ready queue in checkpoint_entries[first_entry, first_entry + ready)
+    int running_remaining; // remaining and first_run of the running process
+    int running_first_run;
+
+    int context_switch; // partial metrics of the run so far
+    long long decisions;
+    int busy_time;
+    checkpoint_stats stats[3]; // wt, tat, rt of the jobs completed so far
+};
+typedef struct checkpoint checkpoint;
+
+struct sim_checkpoints
+{
+    int algorithm;
+    int time_quantum;
+    int n;
+    int interval; // arrivals between two snapshots
+    process *ps;  // baseline workload, a what-if run compares its own against it
+
+    int *ct; // baseline outcome of every process
+    double *wt;
+    double *tat;
+    double *rt;
+    result final; // baseline metrics (series never tracked)
+    int end;      // completion time of the last job
+    unsigned long long seed; // random no. generator when the baseline started
+
+    checkpoint *points; // in time order
+    int no_of_points;
+    int points_size;
+    checkpoint_entry *entries;
+    int no_of_entries;
+    int entries_size;
+};
+
+// Periodic releases wait in a hierarchical timing wheel : level l has WHEEL_SLOTS slots of
+// WHEEL_SLOTS^l time units each. A timer sits at the level of the highest WHEEL_BITS-bit group in
+// which its time differs from the wheel's clock, in the slot of its time's group there, so insert
+// and remove are O(1) and the earliest timer is a bit scan away. When the lower levels run empty
+// the earliest slot above moves down, every timer moves at most once per level it was set above.
+// Timers set before the clock (a job released after its deadline passed) wait in a heap instead.
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS 256 // 1 << WHEEL_BITS
+#define WHEEL_WORDS 4   // WHEEL_SLOTS / 64, bitmap words of a level
+#define WHEEL_LEVELS 4  // 32 bits, enough for every int time
+
+struct wheel_node
+{
+    queue_entry timer; // time, seq, index
+    int link;          // next timer of its slot, -1 at the end
+    int back;          // previous timer of its slot, -1 at the start
+    int slot;          // level * WHEEL_SLOTS + slot, -1 when not in a slot
+};
+typedef struct wheel_node wheel_node;
+
+struct timer_wheel
+{
+    int clock;   // no timer in a slot is earlier, only moves up to the earliest one
+    int count;   // timers pending, overdue ones included
+    int next;    // earliest time in a slot (INT_MAX : none), recomputed when stale
+    int stale;   // [1 : next has to be recomputed, 0 : it is current]
+    unsigned long long occupied[WHEEL_LEVELS][WHEEL_WORDS]; // non-empty slots of every level
+    int head[WHEEL_LEVELS][WHEEL_SLOTS];                     // first timer of a slot, -1 when empty
+    int tail[WHEEL_LEVELS][WHEEL_SLOTS];
+    wheel_node *nodes;    // per process, a process has at most one timer
+    queue_entry *overdue; // timers set before the clock, heap
+    int no_of_overdue;
+};
+typedef struct timer_wheel timer_wheel;
+
+// Simulated I/O device : serves one request at a time in the order they were made. A process
+// blocked on I/O waits in its queue (the blocked queue) or is the one being served.
+struct io_device
+{
+    int *queue;  // ring of n processes waiting for the device
+    int head;    // oldest entry of queue
+    int waiting; // entries in queue
+    int serving; // process whose request is being served, -1 when idle
+    int done_at; // when serving's request is done, INT_MAX when idle
+};
+typedef struct io_device io_device;
+
+// Streaming : arrivals are read while the schedule runs and every process holds a slot from its
+// arrival to its completion, then the slot goes to the next arrival. Memory follows the
+// processes in the system, not the length of the feed.
+#define STREAM_MIN_SLOTS 1024 // slots to begin with, doubled whenever the system outgrows them
+
+struct stream
+{
+    process *rows;            // process in every slot, the engine's ps
+    int *free_slots;          // stack of the slots not in use
+    int no_of_free;
+    int capacity;             // slots, a power of two so the lottery Fenwick tree can double
+    int active;               // processes in the system
+    long long arrived;        // processes read so far
+    long long late;           // arrivals read after simulated time had passed them, run as arriving then
+    int last_completion;      // completion time of the last process retired
+    FILE *out;                // completion and metrics records (CSV)
+    int completions;          // a record per completed process [1 : yes, 0 : no]
+    const char *policy;       // fused runs : policy named in every record, NULL : a run of one policy
+};
+typedef struct stream stream;
+
+// Packed workloads : a trace in arrival order held at a few bytes per process. Processes go in
+// blocks of PACK_BLOCK, and every column of a block keeps only the offsets from its smallest value,
+// in as many bits as the largest offset needs. Arrivals are stored as the gaps between them, which
+// stay small however long the trace runs. A column's offsets are interleaved over PACK_LANES words
+// (value j in lane j % PACK_LANES), so a block decodes with the same shift in every lane at once.
+#define PACK_BLOCK 128
+#define PACK_LANES 4
+#define PACK_COLUMNS 9 // gap to the previous arrival, bt, priority, period - bt, executions, quantum, cpu_burst, io_wait, tickets
+
+struct pack_block
+{
+    long long offset;                   // first word of the block
+    int at;                             // arrival of its first process
+    int base[PACK_COLUMNS];             // smallest value of every column
+    unsigned char bits[PACK_COLUMNS];   // bits of every offset, 0 : the whole column is base
+};
+typedef struct pack_block pack_block;
+
+struct packed_workload
+{
+    pack_block *blocks;
+    int no_of_blocks;
+    int blocks_capacity;
+    unsigned int *words;                // columns of every block, PACK_LANES words of padding at the end
+    long long no_of_words;
+    long long words_capacity;
+    long long n;                        // processes packed so far
+    int last_at;                        // arrival of the last one
+    int pending[PACK_COLUMNS][PACK_BLOCK]; // columns of the block being filled
+    int no_of_pending;
+};
+typedef struct packed_workload packed_workload;
+
+// Tuning : searches the time quantum of RR or Lottery for the best value of an objective, within a
+// budget of context-switches per job, and with Lottery how strongly tickets favour short bursts.
+// The ticket scalings are raced by successive halving : every one is tuned on a short prefix of the
+// workload (in arrival order), the better half goes on to a prefix twice as long, and so on up to
+// the whole workload, a single candidate goes straight to it. Every tuning is a golden-section
+// search over the quantum, in the bracket around the quantum the previous rung found, and the
+// quanta of a search step not run yet run at once. A run stops as soon as it can no longer win :
+// once it has switched more than the budget allows, or once the jobs it completed hold its
+// objective above the best value of the search. With SIM_PTHREADS the candidates of a rung, and
+// the runs of a step, go on threads of their own.
+#define TUNE_RUNGS 4 // prefixes of n / 8, n / 4, n / 2 and n processes
+#define TUNE_MAX_CANDIDATES 8
+#define TUNE_MAX_RUNS 64 // runs of one search, a bracket of any width takes far fewer
+#define TUNE_PROBES 4    // runs of one search step, the two golden-section points or a short bracket
+#define TUNE_CHECKS 64   // times a run checks whether it can still win, at least
+
+#define TUNE_RAN 0         // the run went to its end
+#define TUNE_OVER_BUDGET 1 // stopped once over the budget, its value is the switches per job so far
+#define TUNE_DOMINATED 2   // stopped once its objective could only end above the threshold
+#define TUNE_FAILED 3      // could not start for lack of memory, worse than any run
+
+#define OBJECTIVE_ART 0 // average response time
+#define OBJECTIVE_RT_P99 1
+#define OBJECTIVE_AWT 2
+#define OBJECTIVE_WT_P99 3
+#define OBJECTIVE_ATT 4
+#define OBJECTIVE_TAT_P99 5
+
+struct tune_settings
+{
+    int algorithm;           // RR or Lottery
+    int objective;           // OBJECTIVE_ ...
+    double budget;           // context-switches per job a setting may take, 0 : any
+    unsigned long long seed; // every run draws the same lottery, settings are compared on equal terms
+    double mean_bt;          // of the workload, ticket scalings are relative to it
+};
+typedef struct tune_settings tune_settings;
+
+struct tune_candidate
+{
+    double scaling;   // tickets * (mean_bt / bt)^scaling, 0 : the tickets of the workload
+    int lo, hi;       // quantum bracket to search
+    int quantum;      // best quantum found
+    int feasible;     // quantum keeps within the budget [1 : yes, 0 : no]
+    double value;     // objective at quantum, context-switches per job when not feasible
+    int runs;         // runs of the last search
+    long long work;   // processes simulated by all its searches
+    int failed;       // a run could not start for lack of memory, quantum means nothing [1 : yes, 0 : no]
+
+    const tune_settings *settings;
+    sim_context *ctx[TUNE_PROBES]; // of the candidate's own, one per run of a step
+    const process *ps; // the workload in arrival order
+    process *rows;    // the prefix being run, tickets scaled
+    int n;            // processes in the prefix
+    int span;         // time between the checks of a run, a share of the prefix's bursts
+};
+typedef struct tune_candidate tune_candidate;
+
+// one run of a candidate's prefix, the start routine of its thread is tune_run
+struct tune_probe
+{
+    tune_candidate *c;
+    sim_context *ctx;
+    int quantum;
+    int cuts;         // the run may stop early [1 : yes, 0 : no]
+    double threshold; // cuts : the run stops once its objective can only end above it, HUGE_VAL : never
+    int feasible;     // as tune_candidate's
+    double value;
+    int cut;          // TUNE_RAN, TUNE_OVER_BUDGET, TUNE_DOMINATED or TUNE_FAILED
+    long long work;   // processes the run completed
+};
+typedef struct tune_probe tune_probe;
+
+struct engine
+{
+    sim_context *ctx;
+    const process *ps;
+    run_state state;
+    int n;
+    result *r;
+    int time_quantum;
+
+    int now;         // simulated time
+    int running;     // index of the process on the cpu, -1 when idle
+    int slice_start; // when running got the cpu
+    int slice_end;   // when running leaves the cpu if nothing preempts it
+    int previous;    // index of the last process that ran, for context-switches
+    int completed;   // jobs completed
+    int jobs;        // jobs in the run (every periodic release is a job)
+    int seq;         // entries queued so far
+
+    queue_entry *order;    // indexes sorted by arrival time
+    int next_order;        // first entry of order not yet admitted
+    timer_wheel releases;  // periodic : next release of every process
+    int io;                // some process blocks on I/O [1 : yes, 0 : no]
+    io_device device;      // io : the device the blocked processes wait for
+
+    int costed;      // dispatching takes time, see engine_overhead [1 : yes, 0 : no]
+    int switch_cost; // costed : the context's cost model
+    int warmup_cost;
+    int warmup_time;
+    int switch_at;   // costed : when running was dispatched, it runs from slice_start
+
+    int *fifo;               // QUEUE_FIFO ring of n entries
+    int fifo_head;           // oldest entry of fifo
+    queue_entry *heap;       // QUEUE_HEAP heap, QUEUE_SCAN unordered array
+    long long *fenwick;      // QUEUE_LOTTERY tickets of the ready processes (Fenwick tree)
+    long long tickets_ready; // tickets in fenwick
+    int ready;               // processes in the ready queue
+
+    sim_checkpoints *recording;      // baseline run : where snapshots go, NULL otherwise
+    const sim_checkpoints *baseline; // what-if run : snapshots its state is matched against
+    int next_checkpoint;             // recording : arrivals before the next snapshot, what-if : next snapshot to match
+    const int *changed;              // what-if : processes that differ from the baseline
+    int no_of_changed;
+    int converged_at;                // what-if : when the run matched the baseline again, -1 before
+
+    stream *feed; // streamed runs : slots and output, NULL otherwise
+};
+typedef struct engine engine;
+
+#if defined(__GNUC__)
+#define ENGINE_INLINE static inline __attribute__((always_inline))
+#else
+#define ENGINE_INLINE static inline
+#endif
+
+#ifndef SIM_TRACE
+#define SIM_TRACE 1 // 0 : tracing is compiled out of every engine loop
+#endif
+
+#ifndef SIM_COUNTERS
+#define SIM_COUNTERS 0 // 1 : hardware counters and latency of every engine phase, see display_counters
+#endif
+
+#ifndef SIM_PTHREADS
+#define SIM_PTHREADS 0 // 1 : the FCFS scan splits its work over ctx->threads threads, build with -pthread
+#endif
+
+#if SIM_PTHREADS
+#include <pthread.h>
+#endif
+
+// Fused runs : one pass over the arrivals feeds an engine per policy. Every lane is a streamed run
+// on a context of its own (memory, results, random no. generator), the arrivals are handed to the
+// lanes in batches and with SIM_PTHREADS every lane runs its batch on a thread of its own while the
+// next batch is read, so a run takes about as long as its slowest policy. The lane threads live as
+// long as the run and wait for every batch, a follow run hands over one arrival at a time.
+#define FUSE_BATCH 4096 // arrivals handed over at a time, a multiple of PACK_BLOCK
+#define FUSE_MAX_LANES 8
+
+struct fused_lane
+{
+    sim_context *ctx;
+    const policy *pol;
+    void (*step)(engine *e, int limit);
+    engine e;
+    stream st;
+    int ok;              // [1 : running, 0 : out of memory]
+    int every;           // metrics every `every` time units, 0 : none (the run ends with its results)
+    int next_report;
+    const process *batch; // arrivals to run
+    int count;
+    int draining;        // the feed ended, run the processes left to completion [1 : yes, 0 : no]
+#if SIM_PTHREADS
+    struct fused_run *run;
+    int taken;           // batches the lane's thread has taken
+#endif
+};
+typedef struct fused_lane fused_lane;
+
+struct fused_run
+{
+    fused_lane lanes[FUSE_MAX_LANES];
+    int no_of_lanes;
+    process *batch;   // arrivals the lanes are running
+    process *filling; // arrivals being read
+#if SIM_PTHREADS
+    pthread_t workers[FUSE_MAX_LANES];
+    int started[FUSE_MAX_LANES];
+    int threaded;          // lock, fed and done are set up [1 : yes, 0 : no]
+    pthread_mutex_t lock;
+    pthread_cond_t fed;    // a batch was handed over, or the run is closing
+    pthread_cond_t done;   // the last lane thread finished the batch
+    int fed_batches;       // batches handed over to the lane threads
+    int busy;              // lane threads still on the current batch
+    int closing;
+#endif
+};
+typedef struct fused_run fused_run;
+
+#if SIM_COUNTERS
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// Engine phases measured when built with -DSIM_COUNTERS=1. Every call reads the counters
+// before and after (one read() each on linux), so absolute numbers include that cost :
+// use them to compare layouts and data structures, not as the cost of an uninstrumented run.
+#define PHASE_PICK 0    // choosing the next process to run
+#define PHASE_ENQUEUE 1 // putting a process in the ready queue
+#define PHASE_METRICS 2 // busy time, statistics, series and trace updates
+#define NO_OF_PHASES 3
+
+#define COUNTER_CYCLES 0
+#define COUNTER_INSTRUCTIONS 1
+#define COUNTER_LLC_MISSES 2
+#define COUNTER_BRANCH_MISSES 3
+#define NO_OF_COUNTERS 4
+
+struct counter_sample
+{
+    long long ns;                     // monotonic clock
+    long long values[NO_OF_COUNTERS]; // raw counter values
+};
+typedef struct counter_sample counter_sample;
+
+struct phase_counters
+{
+    long long calls;
+    long long totals[NO_OF_COUNTERS]; // counter deltas summed over the calls
+    latency_stats latency;            // ns per call
+};
+typedef struct phase_counters phase_counters;
+
+struct hw_counters
+{
+    int opened;
+    int fd[NO_OF_COUNTERS];   // fd[0] leads the perf group, -1 when the counter could not be opened
+    int slot[NO_OF_COUNTERS]; // position of the counter in a group read, -1 when missing
+    int available;            // counters in the group
+    phase_counters phases[8][NO_OF_PHASES];
+};
+typedef struct hw_counters hw_counters;
+
+#define COUNTERS_BEGIN(counters, sample) \
+    counter_sample sample;               \
+    counters_read(counters, &sample)
+#define COUNTERS_END(counters, sample, algorithm, phase) counters_record(counters, &sample, algorithm, phase)
+#else
+#define COUNTERS_BEGIN(counters, sample)
+#define COUNTERS_END(counters, sample, algorithm, phase)
+#endif
+
+// Report layer : text is formatted once into a large buffer and handed to every
+// text sink on flush, CSV / JSON sinks get one structured record per algorithm.
+#define REPORT_BUFFER_SIZE (64 * 1024)
+#define MAX_SINKS 8
+
+#define SINK_TEXT 0 // terminal or text file, receives the formatted buffer
+#define SINK_CSV 1  // one summary row per algorithm
+#define SINK_JSON 2 // array with one object per algorithm
+
+struct report_sink
+{
+    int kind;   // SINK_TEXT, SINK_CSV or SINK_JSON
+    FILE *fptr; // where the sink writes
+    int rows;   // records written so far (JSON needs it for the commas)
+};
+typedef struct report_sink report_sink;
+
+struct report
+{
+    char buffer[REPORT_BUFFER_SIZE];
+    int length; // bytes of buffer in use
+    report_sink sinks[MAX_SINKS];
+    int no_of_sinks;
+    char *workload; // name of the workload being reported, NULL : "default"
+    int tuning;     // CSV / JSON sinks get tuning records (report_tuning) [1 : yes, 0 : results]
+};
+typedef struct report report;
+
+#define MAX_WORKLOADS 64 // workloads one batch scenario can load
+
+struct workload
+{
+    char name[32];
+    process *ps; // as loaded, runs only write its ct / wt / tat / rt
+    int n;
+    packed_workload *packed; // "packed" workloads : the processes, ps is then NULL
+};
+typedef struct workload workload;
+
+// Run-scoped memory : allocations are bumped out of one block and released all together when
+// the next run starts. A run that outgrows the block spills into chunks of their own, the
+// next reset replaces block and chunks by one block big enough for that run, so a sweep
+// settles on no allocation at all after its first (largest) runs.
+#define ARENA_ALIGN 16
+#define ARENA_MIN_CHUNK (64 * 1024)
+
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t size; // bytes of the chunk, header included
+    size_t used; // bytes handed out, header included
+};
+typedef struct arena_chunk arena_chunk;
+
+struct arena
+{
+    char *block;           // memory reused by every run
+    size_t size;           // bytes of block
+    size_t used;           // bytes of block handed out in the current run
+    arena_chunk *overflow; // chunks of the current run that did not fit in block
+    size_t requested;      // bytes the current run asked for, block and chunks together
+    long long allocations; // malloc calls made by the arena, for the benchmark
+};
+typedef struct arena arena;
+
+// Everything one simulation changes : flags, output handles, results and run memory.
+// Contexts share nothing, so every thread can drive its own without locks.
+struct sim_context
+{
+    int trace_enabled;       // to record every scheduling slice, see trace_export.c [1 : yes, 0 : no]
+    char trace_path[256];    // file the records go to, "" : only the newest stay in memory
+
+    int result_in_file;     // to show result in file [1 : yes, 0 : no]
+    int result_on_terminal; // to show result on terminal [1 : yes, 0 : no]
+    int result_in_csv;      // to write a summary row per algorithm to results.csv [1 : yes, 0 : no]
+    int result_in_json;     // to write results (with every process) to results.json [1 : yes, 0 : no]
+
+    int track_series;   // to record utilization / run-queue time series [1 : yes, 0 : no]
+    int series_width;   // width of one time series window (time units)
+    int series_in_file; // to also write every window to series_path [1 : yes, 0 : no]
+    char series_path[256];
+    FILE *fptr_series;  // series_path, opened by the first run that writes to it
+
+    unsigned long long seed; // state of the context's random no. generator
+    int threads;             // threads a run may use (FCFS scan with SIM_PTHREADS), 1 : only the caller's
+
+    int switch_cost; // time a context-switch takes on the cpu, 0 : switches are free
+    int warmup_cost; // time a process with cold caches loses when it gets the cpu, 0 : none
+    int warmup_time; // time off the cpu after which its caches are all cold
+
+    char cache_dir[256];     // result cache directory, "" : no cache
+    int cache_outputs;       // cache entries also keep ct / wt / tat / rt of every process [1 : yes, 0 : no]
+    long long cache_hits;    // runs answered from the cache
+    long long cache_misses;  // runs simulated and then stored
+
+    report rep;             // report every display function writes to
+    trace_buffer tracer;    // schedule trace of the policy being run
+    result final_result[8]; // result of every algorithm, index as in algorithm_names
+
+    arena memory;        // engine arrays and series of the current run
+    process *rows;       // sim_run : the caller's columns as process records
+    int rows_size;       // records rows can hold
+    sim_workload loaded; // columns rows hold, a run given the same ones again skips the copy
+    run_state state;     // outcome of the last run, valid until the next one
+#if SIM_COUNTERS
+    hw_counters counters;
+#endif
+};
+
+char *algorithm_names[8] = {"Round-Robin", "Priority", "Lottery", "FCFS", "SJF", "SRTN", "HRRN", "EDF"};
+char *algorithm_titles[8] = {"Round-Robin", "Priority-Scheduling", "Lottery-Scheduling", "FCFS-Scheduling",
+                             "SJF-Scheduling", "SRTN-Scheduling", "HRRN-Scheduling", "EDF-Scheduling"};
+
+// {algorithm, queue, key, uses_quantum, preemptive, periodic}
+static const policy RR_POLICY = {0, QUEUE_FIFO, KEY_NONE, 1, 0, 0};
+static const policy PRIORITY_POLICY = {1, QUEUE_HEAP, KEY_PRIORITY, 0, 0, 0};
+static const policy LOTTERY_POLICY = {2, QUEUE_LOTTERY, KEY_NONE, 1, 0, 0};
+static const policy FCFS_POLICY = {3, QUEUE_FIFO, KEY_NONE, 0, 0, 0};
+static const policy SJF_POLICY = {4, QUEUE_HEAP, KEY_BURST, 0, 0, 0};
+static const policy SRTN_POLICY = {5, QUEUE_HEAP, KEY_REMAINING, 0, 1, 0};
+static const policy HRRN_POLICY = {6, QUEUE_SCAN, KEY_NONE, 0, 0, 0};
+static const policy EDF_POLICY = {7, QUEUE_HEAP, KEY_DEADLINE, 0, 0, 1};
+
+unsigned long long sim_random(sim_context *ctx);
+
+void *arena_alloc(arena *a, size_t bytes);
+void arena_reset(arena *a);
+void arena_free(arena *a);
+
 void initialize_final_result(result *final_result);
-int generate_random_number(int lower, int upper);
-void generate_tickets(process *processes, int n);
-void generateProcesses(process *ps, int n);
-void set_RBT_RT(process *ps, int n);
+int generate_random_number(sim_context *ctx, int lower, int upper);
+void generate_tickets(sim_context *ctx, process *processes, int n);
+void generateProcesses(sim_context *ctx, process *ps, int n);
+void generate_workload(sim_context *ctx, process *ps, int n, double load);
+void generate_io_behavior(sim_context *ctx, process *ps, int n);
 void set_processes(process *ps, int n);
-void set_Priority(process *ps, int n);
-void set_current_deadline_AT(process *ps, int n);
-void set_Execution_buffer(process *ps, int n);
+void set_Priority(sim_context *ctx, process *ps, int n);
+void set_EDF_AT(process *ps, int n);
 
-void sort_by_arrival(process *ps, int n);
-void sort_by_priority(process *ps, int n);
 void sort_by_index(process *ps, int no_of_process);
-void sort_by_deadline(process *ps, int n);
-
-void round_robin(process *ps, int time_quantum, int no_of_process, result *final_result);
-void priority_scheduling(process *ps, int no_of_process, result *final_result);
-int get_process_index(process *ps, int no_of_process, int ticket_number);
-void lottery_scheduling(process *ps, int time_quantum, int no_of_process, result *final_result);
-void fcfs_scheduling(process *ps, int no_of_process, result *final_result);
-void sjf_scheduling(process *ps, int no_of_process, result *final_result);
-void srtn_scheduling(process *ps, int no_of_process, result *final_result);
-void hrrn_scheduling(process *ps, int no_of_process, result *final_result);
-void edf_scheduling(process *ps, int no_of_process, result *final_result);
-
-void separate_results(result *final_result, int i);
-
-void calculate_TAT_WT(process *ps, int no_of_process);
-void calculate_AWT_ATT_ART(process *ps, int no_of_process, result *final_result, int index);
-
-void display(process *ps, int n);  // displays complete details of generated processes
-void display2(process *ps, int n); // displays result (S.NO, ID, AT, BT, TAT, WT, RT, CT)
-void display_Basic_process_details(process *ps, int n);
-void display_priority_process_details(process *ps, int n);
-void display_Lottery_process_details(process *ps, int n);
-void display_EDF_details(process *ps, int n);
-void display_result(result *final_result); // display final comparison chart
-void display_AWT(result *final_result, int n);
-void display_ATT(result *final_result, int n);
-void display_ART(result *final_result, int n);
-void display_Context_switch(result *final_result, int n);
-void display_throughput(result *final_result, int i);
-
-void dotted_line();
-void dotted_line_in_file();
-
-void main()
-{
-    dotted_line();
+
+void round_robin(sim_context *ctx, process *ps, int time_quantum, int no_of_process);
+void priority_scheduling(sim_context *ctx, process *ps, int no_of_process);
+void lottery_scheduling(sim_context *ctx, process *ps, int time_quantum, int no_of_process);
+void fcfs_scheduling(sim_context *ctx, process *ps, int no_of_process);
+void sjf_scheduling(sim_context *ctx, process *ps, int no_of_process);
+void srtn_scheduling(sim_context *ctx, process *ps, int no_of_process);
+void hrrn_scheduling(sim_context *ctx, process *ps, int no_of_process);
+void edf_scheduling(sim_context *ctx, process *ps, int no_of_process);
+void run_algorithm(sim_context *ctx, int algorithm, process *ps, int n, int time_quantum);
+int load_columns(sim_context *ctx, const sim_workload *w);
+int same_columns(const sim_workload *a, const sim_workload *b);
+void write_output(sim_context *ctx, int algorithm, int n, sim_output *out);
+int estimate_workload(sim_context *ctx, const process *ps, int n, sim_estimate *est);
+
+int batch_main(int argc, char *argv[]);
+int estimate_main(int argc, char *argv[]);
+int stream_main(int argc, char *argv[]);
+int tune_main(int argc, char *argv[]);
+int policy_index(char *name);
+int load_workload_file(sim_context *ctx, char *file, process **ps);
+int read_process(char *line, process *p);
+
+int compare_entry(const void *a, const void *b);
+void heap_push(queue_entry *heap, int *count, queue_entry entry);
+queue_entry heap_pop(queue_entry *heap, int *count);
+int wheel_alloc(timer_wheel *w, arena *memory, int n);
+void wheel_reset(timer_wheel *w);
+int wheel_lowest_slot(const unsigned long long *occupied);
+void wheel_link(timer_wheel *w, int i);
+void wheel_unlink(timer_wheel *w, int i);
+void wheel_settle(timer_wheel *w);
+void wheel_insert(timer_wheel *w, queue_entry timer);
+int wheel_next(timer_wheel *w);
+queue_entry wheel_pop(timer_wheel *w);
+void fenwick_add(long long *tree, int n, int i, long long delta);
+int fenwick_find(long long *tree, int n, long long target);
+int process_tickets(const process *p);
+long long random_ticket(sim_context *ctx, long long total);
+int engine_init(engine *e, sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol);
+int workload_has_io(const process *ps, int n);
+int run_has_costs(const sim_context *ctx);
+ENGINE_INLINE void behavior_start(engine *e, int i);
+ENGINE_INLINE void engine_block(engine *e, int i);
+ENGINE_INLINE void engine_wake(engine *e, const policy pol);
+ENGINE_INLINE int engine_arrival(engine *e, int i, const policy pol);
+ENGINE_INLINE long long engine_key(engine *e, int i, const policy pol);
+ENGINE_INLINE void engine_enqueue(engine *e, int i, const policy pol);
+ENGINE_INLINE int engine_pick(engine *e, const policy pol);
+ENGINE_INLINE int engine_next_arrival(engine *e, const policy pol);
+ENGINE_INLINE void engine_complete(engine *e, int i, const policy pol, const int traced, const int series, const int streamed);
+ENGINE_INLINE int engine_overhead(engine *e, int i, int switched);
+ENGINE_INLINE void engine_dispatch(engine *e, int i, const policy pol, const int series);
+ENGINE_INLINE void engine_stop(engine *e, const policy pol, const int traced, const int series, const int streamed);
+ENGINE_INLINE void engine_series_arrival(engine *e);
+ENGINE_INLINE void engine_admit(engine *e, const policy pol, const int traced, const int series, const int streamed);
+ENGINE_INLINE void engine_advance(engine *e, int limit, const policy pol, const int traced, const int series, const int streamed);
+ENGINE_INLINE int engine_checkpoint(engine *e, const policy pol);
+ENGINE_INLINE void simulate(engine *e, const policy pol, const int traced, const int series, const int checkpointed);
+queue_entry checkpoint_queued(engine *e, int queue, int k);
+void checkpoint_take(engine *e, int queue);
+int checkpoint_matches(engine *e, int queue, const checkpoint *cp);
+void checkpoint_restore(engine *e, int queue, const checkpoint *cp);
+void checkpoint_converge(engine *e, int queue, const checkpoint *cp);
+int run_baseline(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e), sim_checkpoints *c);
+int run_whatif(sim_context *ctx, const process *ps, int n, const sim_checkpoints *c, sim_whatif_info *info);
+ENGINE_INLINE void stream_step(engine *e, int limit, const policy pol);
+int stream_open(engine *e, stream *st, sim_context *ctx, const policy *pol, int time_quantum);
+int stream_resize(void **array, size_t size);
+int stream_grow(engine *e, stream *st, const policy *pol);
+int stream_add(engine *e, stream *st, const process *p, const policy *pol);
+void stream_retire(engine *e, int i);
+void stream_report(engine *e, int time);
+void stream_close(engine *e, stream *st);
+int stream_next(FILE *fptr, int follow, char *line, int size, process *p, FILE *out);
+void stream_wait(void);
+int pack_add(packed_workload *w, const process *p);
+int pack_flush(packed_workload *w);
+void pack_decode(const packed_workload *w, int b, process *rows);
+void pack_free(packed_workload *w);
+packed_workload *load_packed_file(sim_context *ctx, char *file);
+int run_packed(sim_context *ctx, const int *algorithms, int k, const packed_workload *w, int time_quantum);
+int fused_open(fused_run *f, sim_context *ctx, const int *algorithms, int k, int time_quantum, FILE *out,
+               int completions, int every);
+void fused_lane_run(fused_lane *lane);
+#if SIM_PTHREADS
+void *fused_worker(void *arg);
+#endif
+void fused_feed(fused_run *f, int count);
+void fused_wait(fused_run *f);
+int fused_finish(fused_run *f);
+void fused_close(fused_run *f);
+int tune_objective(const char *name);
+void tune_prepare(tune_candidate *c);
+int tune_hopeless(engine *e, const tune_probe *probe);
+ENGINE_INLINE int tune_simulate(engine *e, const policy pol, const tune_probe *probe);
+int tune_rr(engine *e, const tune_probe *probe);
+int tune_lottery(engine *e, const tune_probe *probe);
+void *tune_run(void *arg);
+void tune_evaluate(tune_candidate *c, int quantum, int *feasible, double *value);
+void tune_step(tune_probe *probes, int count);
+int tune_better(int feasible, double value, int other_feasible, double other_value);
+void *tune_search(void *arg);
+int run_policy(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e));
+int run_fresh(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e));
+unsigned long long run_key(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol);
+void cache_path(sim_context *ctx, unsigned long long key, char *path, int size);
+int cache_load(sim_context *ctx, unsigned long long key, int algorithm, int n);
+void cache_store(sim_context *ctx, unsigned long long key, int algorithm, int n);
+void run_records(sim_context *ctx, process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e));
+int fcfs_scan(sim_context *ctx, const process *ps, int n);
+void scan_fold(scan_chunk *c);
+void scan_fill(scan_chunk *c);
+void scan_phase(scan_chunk *chunks, int no_of_chunks, int fill);
+#if SIM_PTHREADS
+void *scan_worker(void *arg);
+#endif
+
+void separate_results(sim_context *ctx, int i);
+
+void stats_init(latency_stats *stats);
+void stats_add(latency_stats *stats, double value);
+void stats_merge(latency_stats *stats, latency_stats *from);
+void stats_subtract(latency_stats *rest, const latency_stats *stats, const latency_stats *part);
+void stats_bucket_add(latency_stats *stats, double value, int weight);
+double stats_stddev(latency_stats *stats);
+double stats_percentile(latency_stats *stats, double percentile);
+int stats_bucket_index(long long value);
+long long stats_bucket_lower(int index);
+long long stats_bucket_upper(int index);
+void record_job(result *r, double wt, double tat, double rt);
+
+int compare_int(const void *a, const void *b);
+int compare_arrival(const void *a, const void *b);
+void series_begin(sim_context *ctx, result *r, int algorithm);
+void series_advance(result *r, int t, int running);
+void series_arrival(result *r, int t);
+void series_close_window(result *r);
+void series_context_switch(result *r, int t);
+void series_completion(result *r, int t);
+void series_finish(result *r, int end);
+
+void trace_begin(sim_context *ctx, int algorithm);
+void trace_spill(trace_buffer *tracer);
+void trace_end(trace_buffer *tracer);
+void trace_close(trace_buffer *tracer);
+
+#if SIM_COUNTERS
+void counters_open(hw_counters *counters);
+void counters_read(hw_counters *counters, counter_sample *sample);
+void counters_record(hw_counters *counters, counter_sample *begin, int algorithm, int phase);
+void counters_close(hw_counters *counters);
+void display_counters(sim_context *ctx, int algorithm);
+#endif
+
+void report_add_sink(report *rep, int kind, FILE *fptr);
+void report_printf(report *rep, const char *format, ...);
+void report_repeat(report *rep, char c, int count);
+void report_flush(report *rep);
+void report_json_string(FILE *fptr, const char *text);
+void report_algorithm(report *rep, result *final_result, int i, process *ps, int n);
+void report_tuning(report *rep, int algorithm, int rung, int n, const tune_candidate *c, const char *objective, int dropped);
+void report_close(report *rep);
+
+void display(sim_context *ctx, process *ps, int n);  // displays complete details of generated processes
+void display2(sim_context *ctx, process *ps, int n); // displays result (S.NO, ID, AT, BT, TAT, WT, RT, CT)
+void display_Basic_process_details(sim_context *ctx, process *ps, int n);
+void display_priority_process_details(sim_context *ctx, process *ps, int n);
+void display_Lottery_process_details(sim_context *ctx, process *ps, int n);
+void display_EDF_details(sim_context *ctx, process *ps, int n);
+void display_algorithm_result(sim_context *ctx, process *ps, int n, int i, int with_histogram);
+void display_result(sim_context *ctx); // display final comparison chart
+void display_estimate(sim_context *ctx, sim_estimate *est, int simulated[3]);
+void display_AWT(sim_context *ctx, int n);
+void display_ATT(sim_context *ctx, int n);
+void display_ART(sim_context *ctx, int n);
+void display_Context_switch(sim_context *ctx, int n);
+void display_throughput(sim_context *ctx, int i);
+void display_percentiles(sim_context *ctx, int n);
+void display_cpu_utilization(sim_context *ctx, int n);
+void display_series(sim_context *ctx, int i);
+
+void dotted_line(sim_context *ctx);
+
+// a few stores and an increment, cheap enough to stay inside the scheduling loops
+static inline void trace_event(trace_buffer *tracer, int event, int time, int duration, int pid)
+{
+    if (tracer->records == NULL)
+    {
+        return;
+    }
+
+    trace_record *record = &tracer->records[tracer->count++];
+    record->time = time;
+    record->duration = duration;
+    record->cpu = 0;
+    record->event = event;
+    record->pid = pid;
+    tracer->total++;
+
+    if (tracer->count == TRACE_CAPACITY)
+    {
+        trace_spill(tracer);
+    }
+}
+
+#ifndef SIMULATOR_NO_MAIN // benchmark.c brings its own main
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "--estimate") == 0)
+        {
+            return estimate_main(argc, argv);
+        }
+        if (strcmp(argv[1], "--tune") == 0)
+        {
+            return tune_main(argc, argv);
+        }
+        return strcmp(argv[1], "--stream") == 0 ? stream_main(argc, argv) : batch_main(argc, argv);
+    }
+
     int choice;
-    srand(time(NULL)); // for random no. generator
     int n, time_quantum = 2;
-    result final_result[8]; // holds AWT and ATT of all processes
+    sim_context *ctx = sim_create(); // holds the results of all algorithms
+    if (ctx == NULL)
+    {
+        return 1;
+    }
+    sim_seed(ctx, time(NULL)); // for random no. generator
+
+    // every sink gets the same formatted buffer, nothing is printed twice
+    if (ctx->result_on_terminal)
+    {
+        report_add_sink(&ctx->rep, SINK_TEXT, stdout);
+    }
+    if (ctx->result_in_file)
+    {
+        report_add_sink(&ctx->rep, SINK_TEXT, fopen("output.txt", "w"));
+    }
+    if (ctx->result_in_csv)
+    {
+        report_add_sink(&ctx->rep, SINK_CSV, fopen("results.csv", "w"));
+    }
+    if (ctx->result_in_json)
+    {
+        report_add_sink(&ctx->rep, SINK_JSON, fopen("results.json", "w"));
+    }
+    strcpy(ctx->trace_path, "trace.bin");
+    strcpy(ctx->series_path, "series.csv");
 
-    initialize_final_result(final_result);
-    // dotted_line();
+    dotted_line(ctx);
+    report_flush(&ctx->rep);
     printf("\nWelcome to CPU Scheduling Simulator.");
     printf("\n\nScheduling Algorithms : ");
     printf("\n1. RR\n2. Priority\n3. Lottery\n4. FCFS\n5. SJF\n6. SRTN\n7. HRRN\n8. EDF\n9. ALL Together");
@@ -143,402 +1109,291 @@ void main()
     set_processes(ps, n);
     printf("\nGenerated %d Processes Successfully", n);
 
-    fptr_write = fopen("output.txt", "w");
-
     switch (choice)
     {
     case 1:
         // 0----------------------------Round-Robin---------------------------
-        display_Basic_process_details(ps, n);
-        round_robin(ps, time_quantum, n, final_result); // Time-quantum = 2, n = no. of processes
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of Round-Robin");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
-            printf("\n-> Histogram for Round-Robin\n");
-            separate_results(final_result, 0);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of Round-Robin", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
-            fputs("\n-> Histogram for Round-Robin\n", fptr_write);
-            separate_results(final_result, 0);
-            dotted_line_in_file();
-        }
+        display_Basic_process_details(ctx, ps, n);
+        round_robin(ctx, ps, time_quantum, n); // Time-quantum = 2, n = no. of processes
+        display_algorithm_result(ctx, ps, n, 0, 1);
         break;
     case 2:
         // 1-----------------------Priority-----------------------------------
-
-        set_Priority(ps, n);
-        display_priority_process_details(ps, n);
-        priority_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of Priority-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
-            printf("\n-> Histogram for Priority\n");
-            separate_results(final_result, 1);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of Priority-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Priority Result
-            fputs("\n-> Histogram for Priority-Scheduling\n", fptr_write);
-            separate_results(final_result, 1);
-            dotted_line_in_file();
-        }
-
+        set_Priority(ctx, ps, n);
+        display_priority_process_details(ctx, ps, n);
+        priority_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 1, 1);
         break;
     case 3:
         // 2-----------------------Lottery-----------------------------------
-        generate_tickets(ps, n);
-        display_Lottery_process_details(ps, n);
-        lottery_scheduling(ps, time_quantum, n, final_result); // Time-quantum = 2, n = no. of processes
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of Lottery-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Lottery-Scheduling Result
-            printf("\n-> Histogram for Lottery\n");
-            separate_results(final_result, 2);
-            dotted_line();
-        }
-
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of Lottery-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Lottery-Scheduling Result
-            fputs("\n-> Histogram for Lottery-Scheduling\n", fptr_write);
-            separate_results(final_result, 2);
-            dotted_line_in_file();
-        }
-
+        generate_tickets(ctx, ps, n);
+        display_Lottery_process_details(ctx, ps, n);
+        lottery_scheduling(ctx, ps, time_quantum, n); // Time-quantum = 2, n = no. of processes
+        display_algorithm_result(ctx, ps, n, 2, 1);
         break;
     case 4:
         // 3-----------------------FCFS-----------------------------------
-        display_Basic_process_details(ps, n);
-        fcfs_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of FCFS-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying FCFS-Scheduling Result
-            printf("\n-> Histogram for FCFS\n");
-            separate_results(final_result, 3);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of FCFS-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying FCFS-Scheduling Result
-            fputs("\n-> Histogram for FCFS-Scheduling\n", fptr_write);
-            separate_results(final_result, 3);
-            dotted_line_in_file();
-        }
+        display_Basic_process_details(ctx, ps, n);
+        fcfs_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 3, 1);
         break;
     case 5:
         // 4-----------------------SJF-----------------------------------
-        display_Basic_process_details(ps, n);
-        sjf_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of SJF-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SJF-Scheduling Result
-            printf("\n-> Histogram for SJF\n");
-            separate_results(final_result, 4);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of SJF-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SJF-Scheduling Result
-            fputs("\n-> Histogram for SJF-Scheduling\n", fptr_write);
-            separate_results(final_result, 4);
-            dotted_line_in_file();
-        }
+        display_Basic_process_details(ctx, ps, n);
+        sjf_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 4, 1);
         break;
     case 6:
         // 5-----------------------SRTN-----------------------------------
-        display_Basic_process_details(ps, n);
-        srtn_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of SRTN-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SRTN-Scheduling Result
-            printf("\n-> Histogram for SRTN\n");
-            separate_results(final_result, 5);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of SRTN-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SRTN-Scheduling Result
-            fputs("\n-> Histogram for SRTN-Scheduling\n", fptr_write);
-            separate_results(final_result, 5);
-            dotted_line_in_file();
-        }
+        display_Basic_process_details(ctx, ps, n);
+        srtn_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 5, 1);
         break;
     case 7:
-        // // 6-----------------------HRRN-----------------------------------
-        display_Basic_process_details(ps, n);
-        hrrn_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of HRRN-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying HRRN-Scheduling Result
-            printf("\n-> Histogram for HRRN\n");
-            separate_results(final_result, 6);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            // fptr_write = fopen("output.txt", "w");
-            dotted_line_in_file();
-            fputs("\n\n-> Result of HRRN-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying HRRN-Scheduling Result
-            fputs("\n-> Histogram for HRRN-Scheduling\n", fptr_write);
-            separate_results(final_result, 6);
-            dotted_line_in_file();
-        }
+        // 6-----------------------HRRN-----------------------------------
+        display_Basic_process_details(ctx, ps, n);
+        hrrn_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 6, 1);
         break;
     case 8:
         // 7-----------------------EDF-----------------------------------
-        set_current_deadline_AT(ps, n);
-        display_EDF_details(ps, n);
-        set_Execution_buffer(ps, n);
-        edf_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            dotted_line();
-            printf("\n\n-> Result of EDF-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying EDF-Scheduling Result
-
-            printf("\nHistogram under development\n");
-            printf("\n-> Histogram for EDF-Scheduling\n");
-            separate_results(final_result, 7);
-            dotted_line();
-        }
-        // putting result in file
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            dotted_line();
-            dotted_line_in_file();
-            fputs("\n\n-> Result of EDF-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying EDF-Scheduling Result
-            // fputs("\n-> Histogram for EDF-Scheduling\n", fptr_write);
-            // separate_results(final_result, 7);
-            dotted_line_in_file();
-        }
-
-        // printf("\n\nEDF Under Development !!\n\n");
+        set_EDF_AT(ps, n);
+        display_EDF_details(ctx, ps, n);
+        edf_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 7, 1);
         break;
 
     case 9:
-        set_Priority(ps, n);
-        generate_tickets(ps, n);
-        fptr_write = fopen("output.txt", "w");
-        display(ps, n);
+        set_Priority(ctx, ps, n);
+        generate_tickets(ctx, ps, n);
+        display(ctx, ps, n);
 
-        // 0----------------------------Round-Robin---------------------------
-        round_robin(ps, time_quantum, n, final_result); // Time-quantum = 2, n = no. of processes
-        if (result_on_terminal)
-        {
-            printf("\n-> Result of Round-Robin");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
-        }
-        if (result_in_file)
-        {
-            printf("\n\nPlease see output.txt for results !!\n");
-            // fptr_write = fopen("output.txt", "a");
-            dotted_line_in_file();
-            fputs("\n\n-> Result of Round-Robin", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
+        round_robin(ctx, ps, time_quantum, n); // Time-quantum = 2, n = no. of processes
+        display_algorithm_result(ctx, ps, n, 0, 0);
 
-            dotted_line_in_file();
-        }
+        priority_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 1, 0);
 
-        // 1-----------------------Priority-----------------------------------
-        priority_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            printf("\n-> Result of Priority-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
-        }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of Priority-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Round Robin Result
+        lottery_scheduling(ctx, ps, time_quantum, n); // Time-quantum = 2, n = no. of processes
+        display_algorithm_result(ctx, ps, n, 2, 0);
 
-            dotted_line_in_file();
-        }
+        fcfs_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 3, 0);
 
-        // 2-----------------------Lottery-----------------------------------
-        lottery_scheduling(ps, time_quantum, n, final_result); // Time-quantum = 2, n = no. of processes
-        if (result_on_terminal)
-        {
-            printf("\n-> Result of Lottery-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Lottery-Scheduling Result
-        }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of Lottery-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying Lottery-Scheduling Result
+        sjf_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 4, 0);
 
-            dotted_line_in_file();
-        }
+        srtn_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 5, 0);
 
-        // 3-----------------------FCFS-----------------------------------
-        fcfs_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            printf("\n-> Result of FCFS-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying FCFS-Scheduling Result
-        }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of FCFS-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying FCFS-Scheduling Result
+        hrrn_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 6, 0);
 
-            dotted_line_in_file();
-        }
+        edf_scheduling(ctx, ps, n);
+        display_algorithm_result(ctx, ps, n, 7, 0);
 
-        // 4-----------------------SJF-----------------------------------
-        sjf_scheduling(ps, n, final_result);
-        if (result_on_terminal)
+        display_result(ctx);
+
+        sim_estimate est;
+        if (estimate_workload(ctx, ps, n, &est))
         {
-            printf("\n-> Result of SJF-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SJF-Scheduling Result
+            int simulated[3] = {1, 1, 1};
+            display_estimate(ctx, &est, simulated);
         }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of SJF-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SJF-Scheduling Result
+        break;
 
-            dotted_line_in_file();
-        }
+    default:
+        printf("\nWarning : Invalid Choice !!");
+        break;
+    }
 
-        // 5-----------------------SRTN-----------------------------------
-        srtn_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            printf("\n-> Result of SRTN-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SRTN-Scheduling Result
-        }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of SRTN-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying SRTN-Scheduling Result
+    report_close(&ctx->rep);
+    if (ctx->result_in_file)
+    {
+        printf("\n\nPlease see output.txt for results !!\n");
+    }
+    sim_destroy(ctx);
+    return 0;
+}
+#endif
 
-            dotted_line_in_file();
-        }
+// a context with the settings the interactive simulator always had, NULL when out of memory
+sim_context *sim_create(void)
+{
+    sim_context *ctx = calloc(1, sizeof(sim_context));
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
 
-        // // 6-----------------------HRRN-----------------------------------
-        hrrn_scheduling(ps, n, final_result);
-        if (result_on_terminal)
-        {
-            printf("\n-> Result of HRRN-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying HRRN-Scheduling Result
-        }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of HRRN-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying HRRN-Scheduling Result
+    ctx->trace_enabled = 0;
+    ctx->result_in_file = 0;
+    ctx->result_on_terminal = 1;
+    ctx->result_in_csv = 0;
+    ctx->result_in_json = 0;
+    ctx->track_series = 1;
+    ctx->series_width = 5;
+    ctx->series_in_file = 0;
+    ctx->threads = 1;
+    sim_seed(ctx, 1);
+    initialize_final_result(ctx->final_result);
+    return ctx;
+}
 
-            dotted_line_in_file();
-        }
+// closes every output of the context and frees it
+void sim_destroy(sim_context *ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
 
-        // 7-----------------------EDF-----------------------------------
-        edf_scheduling(ps, n, final_result);
-        if (result_on_terminal)
+    report_close(&ctx->rep);
+    trace_close(&ctx->tracer);
+#if SIM_COUNTERS
+    counters_close(&ctx->counters);
+#endif
+    if (ctx->fptr_series != NULL)
+    {
+        fclose(ctx->fptr_series);
+    }
+    arena_free(&ctx->memory);
+    free(ctx->rows);
+    free(ctx);
+}
+
+void sim_seed(sim_context *ctx, unsigned long long seed)
+{
+    ctx->seed = seed;
+}
+
+void sim_set_threads(sim_context *ctx, int threads)
+{
+    ctx->threads = threads > 0 ? threads : 1;
+}
+
+void sim_set_switch_cost(sim_context *ctx, int switch_cost, int warmup_cost, int warmup_time)
+{
+    ctx->switch_cost = switch_cost > 0 ? switch_cost : 0;
+    ctx->warmup_cost = warmup_cost > 0 ? warmup_cost : 0;
+    ctx->warmup_time = warmup_time > 0 ? warmup_time : 0;
+}
+
+int sim_set_cache(sim_context *ctx, const char *dir, int per_process)
+{
+    if (dir == NULL || dir[0] == '\0')
+    {
+        ctx->cache_dir[0] = '\0';
+        return SIM_OK;
+    }
+    if (strlen(dir) >= sizeof(ctx->cache_dir))
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+    struct stat info;
+    if (stat(dir, &info) != 0 || !(info.st_mode & S_IFDIR))
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    strcpy(ctx->cache_dir, dir);
+    ctx->cache_outputs = per_process;
+    return SIM_OK;
+}
+
+int sim_set_trace(sim_context *ctx, const char *path)
+{
+    if (path != NULL && strlen(path) >= sizeof(ctx->trace_path))
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    trace_close(&ctx->tracer); // the next run opens the new file
+    ctx->trace_enabled = path != NULL && path[0] != '\0';
+    strcpy(ctx->trace_path, ctx->trace_enabled ? path : "");
+    return SIM_OK;
+}
+
+// splitmix64 : every context draws its own sequence, unlike rand()
+unsigned long long sim_random(sim_context *ctx)
+{
+    unsigned long long z = (ctx->seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// ARENA_ALIGN aligned memory valid until the next arena_reset, NULL when out of memory
+void *arena_alloc(arena *a, size_t bytes)
+{
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    a->requested += bytes;
+    if (a->size - a->used >= bytes)
+    {
+        void *p = a->block + a->used;
+        a->used += bytes;
+        return p;
+    }
+
+    arena_chunk *chunk = a->overflow;
+    if (chunk == NULL || chunk->size - chunk->used < bytes)
+    {
+        size_t size = bytes > ARENA_MIN_CHUNK ? bytes : ARENA_MIN_CHUNK;
+        size_t header = (sizeof(arena_chunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        chunk = malloc(header + size);
+        if (chunk == NULL)
         {
-            printf("\n-> Result of EDF-Scheduling");
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying EDF-Scheduling Result
+            return NULL;
         }
-        if (result_in_file)
-        {
-            fputs("\n\n-> Result of EDF-Scheduling", fptr_write);
-            sort_by_index(ps, n);
-            display2(ps, n); // displaying EDF-Scheduling Result
+        a->allocations++;
+        chunk->next = a->overflow;
+        chunk->size = header + size;
+        chunk->used = header;
+        a->overflow = chunk;
+    }
+    void *p = (char *)chunk + chunk->used;
+    chunk->used += bytes;
+    return p;
+}
 
-            dotted_line_in_file();
+// releases everything allocated since the last reset, the memory is kept for the next run
+void arena_reset(arena *a)
+{
+    if (a->overflow != NULL)
+    {
+        // the last run did not fit : one block for all of it, so the next one does
+        size_t size = a->requested + a->requested / 4;
+        while (a->overflow != NULL)
+        {
+            arena_chunk *next = a->overflow->next;
+            free(a->overflow);
+            a->overflow = next;
         }
+        free(a->block);
+        a->block = malloc(size);
+        a->size = a->block != NULL ? size : 0;
+        a->allocations++;
+    }
+    a->used = 0;
+    a->requested = 0;
+}
 
-        dotted_line();
-        display_result(final_result);
-        break;
-
-    default:
-        printf("\nWarning : Invalid Choice !!");
-        break;
+void arena_free(arena *a)
+{
+    while (a->overflow != NULL)
+    {
+        arena_chunk *next = a->overflow->next;
+        free(a->overflow);
+        a->overflow = next;
     }
-    fclose(fptr_write);
+    free(a->block);
+    a->block = NULL;
+    a->size = 0;
+    a->used = 0;
+    a->requested = 0;
 }
 
 void initialize_final_result(result *final_result)
@@ -546,24 +1401,37 @@ void initialize_final_result(result *final_result)
     for (int i = 0; i < 8; i++)
     {
         final_result[i].context_switch = 0;
+        final_result[i].decisions = 0;
         final_result[i].throughput = 0;
         final_result[i].awt = 0;
         final_result[i].att = 0;
         final_result[i].art = 0;
+        stats_init(&final_result[i].wt_stats);
+        stats_init(&final_result[i].tat_stats);
+        stats_init(&final_result[i].rt_stats);
+        final_result[i].busy_time = 0;
+        final_result[i].idle_time = 0;
+        final_result[i].cpu_utilization = 0;
+        stats_init(&final_result[i].burst_stats);
+        final_result[i].io_busy = 0;
+        final_result[i].io_utilization = 0;
+        final_result[i].overhead_time = 0;
+        final_result[i].overhead_share = 0;
+        final_result[i].series.tracked = 0;
+        final_result[i].series.count = 0;
     }
 }
 
-int generate_random_number(int lower, int upper)
+int generate_random_number(sim_context *ctx, int lower, int upper)
 {
     int range = upper - lower + 1;
-    int randomNumber = rand() % range + lower;
+    int randomNumber = (int)(sim_random(ctx) % range) + lower;
     return randomNumber;
 }
 
 void set_processes(process *ps, int n)
 {
-
-    // generateProcesses(ps, n);
+    // generateProcesses(ctx, ps, n);
 
     ps[0].id = 1;
     ps[1].id = 2;
@@ -588,6 +1456,9 @@ void set_processes(process *ps, int n)
     // initializing with "0"
     for (int i = 0; i < n; i++)
     {
+        ps[i].quantum = 0;
+        ps[i].cpu_burst = 0;
+        ps[i].io_wait = 0;
         ps[i].ct = 0;
         ps[i].tat = 0;
         ps[i].wt = 0;
@@ -595,23 +1466,6 @@ void set_processes(process *ps, int n)
     }
 }
 
-void sort_by_arrival(process *ps, int n)
-{
-    process temp;
-    for (int i = 0; i < n - 1; i++)
-    {
-        for (int j = 0; j < n - 1 - i; j++)
-        {
-            if (ps[j].at > ps[j + 1].at)
-            {
-                temp = ps[j + 1];
-                ps[j + 1] = ps[j];
-                ps[j] = temp;
-            }
-        }
-    }
-}
-
 void sort_by_index(process *ps, int no_of_process)
 {
     process temp;
@@ -629,1636 +1483,5695 @@ void sort_by_index(process *ps, int no_of_process)
     }
 }
 
-void sort_by_priority(process *ps, int n)
+void stats_init(latency_stats *stats)
 {
-    process temp;
-    for (int i = 0; i < n - 1; i++)
+    stats->count = 0;
+    stats->mean = 0;
+    stats->m2 = 0;
+    stats->min = 0;
+    stats->max = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++)
     {
-        for (int j = 0; j < n - 1 - i; j++)
-        {
-            if (ps[j].priority > ps[j + 1].priority)
-            {
-                temp = ps[j + 1];
-                ps[j + 1] = ps[j];
-                ps[j] = temp;
-            }
-        }
+        stats->buckets[i] = 0;
     }
 }
 
-void calculate_TAT_WT(process *ps, int no_of_process)
+int stats_bucket_index(long long value)
 {
-    for (int i = 0; i < no_of_process; i++)
+    if (value < 0)
     {
-        ps[i].tat = ps[i].ct - ps[i].at;
-        ps[i].wt = ps[i].tat - ps[i].bt;
+        value = 0;
     }
-}
-
-void calculate_AWT_ATT_ART(process *ps, int no_of_process, result *final_result, int index)
-{
-    double twt = 0, ttt = 0, trt = 0;
-    for (int i = 0; i < no_of_process; i++)
+    if (value > INT_MAX)
+    {
+        value = INT_MAX;
+    }
+    if (value < HIST_SUB_BUCKETS)
     {
-        twt += ps[i].wt;
-        ttt += ps[i].tat;
-        trt += ps[i].rt;
+        return (int)value;
     }
 
-    final_result[index].awt = twt / no_of_process;
-    final_result[index].att = ttt / no_of_process;
-    final_result[index].art = trt / no_of_process;
+    // only the top 5 bits of the value are kept, the shift picks the power of two
+    int shift = 1;
+    while ((value >> shift) >= HIST_SUB_BUCKETS)
+    {
+        shift++;
+    }
+    return HIST_SUB_BUCKETS + (shift - 1) * (HIST_SUB_BUCKETS / 2) + (int)(value >> shift) - HIST_SUB_BUCKETS / 2;
 }
 
-int get_process_index(process *ps, int no_of_process, int ticket_number)
+long long stats_bucket_lower(int index)
 {
-    for (int i = 0; i < no_of_process; i++)
+    if (index < HIST_SUB_BUCKETS)
     {
-        if (ticket_number >= ps[i].tickets[0] && ticket_number <= ps[i].tickets[1])
-        {
-            return i;
-        }
+        return index;
     }
+    int shift = (index - HIST_SUB_BUCKETS) / (HIST_SUB_BUCKETS / 2) + 1;
+    long long mantissa = (index - HIST_SUB_BUCKETS) % (HIST_SUB_BUCKETS / 2) + HIST_SUB_BUCKETS / 2;
+    return mantissa << shift;
 }
 
-void display(process *ps, int n)
+long long stats_bucket_upper(int index)
 {
-    if (result_on_terminal)
+    if (index < HIST_SUB_BUCKETS)
     {
-        printf("\n------------------------------------------------------------------------\n");
-        printf("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Priority  |  Tickets  |\n");
-        printf("------------------------------------------------------------------------\n");
-    }
-    if (result_in_file)
-    {
-        dotted_line_in_file();
-        fputs("\nProcesses are :", fptr_write);
-        fputs("\n------------------------------------------------------------------------\n", fptr_write);
-        fputs("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Priority  |  Tickets  |\n", fptr_write);
-        fputs("------------------------------------------------------------------------\n", fptr_write);
+        return index;
     }
+    int shift = (index - HIST_SUB_BUCKETS) / (HIST_SUB_BUCKETS / 2) + 1;
+    return stats_bucket_lower(index) + (1LL << shift) - 1;
+}
 
-    for (int i = 0; i < n; i++)
+void stats_add(latency_stats *stats, double value)
+{
+    stats->count++;
+    if (stats->count == 1 || value < stats->min)
     {
-        if (result_on_terminal)
-        {
-            printf("|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  | %3d -%3d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].priority, ps[i].tickets[0], ps[i].tickets[1]);
-        }
-        if (result_in_file)
-        {
-            fprintf(fptr_write, "|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  | %3d -%3d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].priority, ps[i].tickets[0], ps[i].tickets[1]);
-        }
+        stats->min = value;
     }
-
-    if (result_on_terminal)
+    if (stats->count == 1 || value > stats->max)
     {
-        printf("------------------------------------------------------------------------\n");
+        stats->max = value;
     }
 
-    if (result_in_file)
-    {
-        fputs("------------------------------------------------------------------------\n", fptr_write);
-    }
+    // Welford's update, stays accurate on long runs unlike sum and sum of squares
+    double delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+
+    stats->buckets[stats_bucket_index((long long)floor(value + 0.5))]++;
 }
 
-void display2(process *ps, int n)
+// adds the samples of from to stats, as if every one of them went through stats_add
+void stats_merge(latency_stats *stats, latency_stats *from)
 {
-    if (result_on_terminal)
+    if (from->count == 0)
     {
-        printf("\n------------------------------------------------------------------------------------------------------------------\n");
-        printf("| S.No | ID  | Arrival-Time  | Brust-Time  | Completion-Time  | Turn-Around-Time | Waiting-Time | Response-Time  |\n");
-        printf("------------------------------------------------------------------------------------------------------------------\n");
+        return;
     }
-
-    if (result_in_file)
+    if (stats->count == 0)
     {
-
-        fputs("\n------------------------------------------------------------------------------------------------------------------\n", fptr_write);
-        fputs("| S.No | ID  | Arrival-Time  | Brust-Time  | Completion-Time  | Turn-Around-Time | Waiting-Time | Response-Time  |\n", fptr_write);
-        fputs("------------------------------------------------------------------------------------------------------------------\n", fptr_write);
+        *stats = *from;
+        return;
     }
 
-    for (int i = 0; i < n; i++)
+    // Chan et al. : mean and m2 of the union from those of the parts
+    long long count = stats->count + from->count;
+    double delta = from->mean - stats->mean;
+    stats->m2 += from->m2 + delta * delta * ((double)stats->count * from->count / count);
+    stats->mean += delta * from->count / count;
+    stats->count = count;
+    if (from->min < stats->min)
     {
-        if (result_on_terminal)
-        {
-            printf("| %4d | %2d  | %12d  | %10d  | %15d  | %15f  | %11f  | %14f |\n",
-                   i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].ct, ps[i].tat, ps[i].wt, ps[i].rt);
-        }
-
-        if (result_in_file)
-        {
-            fprintf(fptr_write, "| %4d | %2d  | %12d  | %10d  | %15d  | %15f  | %11f  | %14f |\n",
-                    i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].ct, ps[i].tat, ps[i].wt, ps[i].rt);
-        }
+        stats->min = from->min;
     }
-    if (result_on_terminal)
+    if (from->max > stats->max)
     {
-        printf("------------------------------------------------------------------------------------------------------------------\n");
+        stats->max = from->max;
     }
-    if (result_in_file)
+    for (int i = 0; i < HIST_BUCKETS; i++)
     {
-        fputs("------------------------------------------------------------------------------------------------------------------\n", fptr_write);
+        stats->buckets[i] += from->buckets[i];
     }
 }
 
-void display_Basic_process_details(process *ps, int n)
+// rest = the samples of stats that are not in part, part being an earlier state of stats.
+// Only the moments are, min, max and the histogram are left to the caller.
+void stats_subtract(latency_stats *rest, const latency_stats *stats, const latency_stats *part)
 {
-    if (result_on_terminal)
-    {
-        printf("\n-----------------------------------------------\n");
-        printf("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |\n");
-        printf("-----------------------------------------------\n");
-    }
-    if (result_in_file)
+    stats_init(rest);
+    rest->count = stats->count - part->count;
+    if (rest->count <= 0)
     {
-        dotted_line_in_file();
-        fputs("\nProcesses are :", fptr_write);
-        fputs("\n-----------------------------------------------\n", fptr_write);
-        fputs("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |\n", fptr_write);
-        fputs("-----------------------------------------------\n", fptr_write);
+        rest->count = 0;
+        return;
     }
-
-    for (int i = 0; i < n; i++)
+    // Chan et al. run backwards
+    rest->mean = (stats->mean * stats->count - part->mean * part->count) / rest->count;
+    double delta = rest->mean - part->mean;
+    rest->m2 = stats->m2 - part->m2 - delta * delta * ((double)part->count * rest->count / stats->count);
+    if (rest->m2 < 0)
     {
-        if (result_on_terminal)
-        {
-            printf("|  %2d  |  %2d  |  %12d  |  %10d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt);
-        }
-        if (result_in_file)
-        {
-            fprintf(fptr_write, "|  %2d  |  %2d  |  %12d  |  %10d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt);
-        }
+        rest->m2 = 0;
     }
+}
 
-    if (result_on_terminal)
-    {
-        printf("-----------------------------------------------\n");
-    }
+// counts value weight more times in the histogram of stats, the moments stay as they are
+void stats_bucket_add(latency_stats *stats, double value, int weight)
+{
+    stats->buckets[stats_bucket_index((long long)floor(value + 0.5))] += weight;
+}
 
-    if (result_in_file)
+double stats_stddev(latency_stats *stats)
+{
+    if (stats->count < 2)
     {
-        fputs("-----------------------------------------------\n", fptr_write);
+        return 0;
     }
+    return sqrt(stats->m2 / (stats->count - 1));
 }
 
-void display_priority_process_details(process *ps, int n)
+double stats_percentile(latency_stats *stats, double percentile)
 {
-    if (result_on_terminal)
+    if (stats->count == 0)
     {
-        printf("\n------------------------------------------------------------\n");
-        printf("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Priority  |\n");
-        printf("------------------------------------------------------------\n");
+        return 0;
     }
-    if (result_in_file)
+
+    long long rank = (long long)ceil(percentile / 100 * stats->count);
+    if (rank < 1)
     {
-        dotted_line_in_file();
-        fputs("\nProcesses are :", fptr_write);
-        fputs("\n------------------------------------------------------------\n", fptr_write);
-        fputs("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Priority  |\n", fptr_write);
-        fputs("------------------------------------------------------------\n", fptr_write);
+        rank = 1;
     }
 
-    for (int i = 0; i < n; i++)
+    long long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++)
     {
-        if (result_on_terminal)
-        {
-            printf("|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].priority);
-        }
-        if (result_in_file)
+        seen += stats->buckets[i];
+        if (seen >= rank)
         {
-            fprintf(fptr_write, "|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].priority);
+            // middle of the bucket, but never outside of what was really recorded
+            double value = (stats_bucket_lower(i) + stats_bucket_upper(i)) / 2.0;
+            if (value < stats->min)
+            {
+                value = stats->min;
+            }
+            if (value > stats->max)
+            {
+                value = stats->max;
+            }
+            return value;
         }
     }
+    return stats->max;
+}
 
-    if (result_on_terminal)
-    {
-        printf("------------------------------------------------------------\n");
-    }
+// called once per finished job, keeps the averages current without a second pass over ps[]
+void record_job(result *r, double wt, double tat, double rt)
+{
+    stats_add(&r->wt_stats, wt);
+    stats_add(&r->tat_stats, tat);
+    stats_add(&r->rt_stats, rt);
+
+    r->awt = r->wt_stats.mean;
+    r->att = r->tat_stats.mean;
+    r->art = r->rt_stats.mean;
+}
+
+int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
 
-    if (result_in_file)
+// arrival time, then id
+int compare_arrival(const void *a, const void *b)
+{
+    const process *x = a, *y = b;
+    if (x->at != y->at)
     {
-        fputs("------------------------------------------------------------\n", fptr_write);
+        return (x->at > y->at) - (x->at < y->at);
     }
+    return (x->id > y->id) - (x->id < y->id);
 }
 
-void display_Lottery_process_details(process *ps, int n)
+// the series keeps no copy of the workload, arrivals are counted as the engine admits them
+void series_begin(sim_context *ctx, result *r, int algorithm)
 {
-    if (result_on_terminal)
+    time_series *s = &r->series;
+    s->algorithm = algorithm;
+    s->width = ctx->series_width > 0 ? ctx->series_width : 1;
+    if (ctx->series_in_file && ctx->fptr_series == NULL && ctx->series_path[0] != '\0')
     {
-        printf("\n------------------------------------------------------------\n");
-        printf("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Tickets  |\n");
-        printf("------------------------------------------------------------\n");
+        ctx->fptr_series = fopen(ctx->series_path, "w");
+        if (ctx->fptr_series != NULL)
+        {
+            fputs("algorithm,start,width,busy,completions,context_switch,queue_area\n", ctx->fptr_series);
+        }
     }
-    if (result_in_file)
+    s->fptr = ctx->series_in_file ? ctx->fptr_series : NULL;
+    s->tracked = ctx->track_series;
+    s->in_system = 0;
+    s->clock = 0;
+    s->head = 0;
+    s->count = 0;
+    s->dropped = 0;
+    s->current = (series_window){0, 0, 0, 0, 0, 0};
+}
+
+// fills the series up to time t, running tells if the cpu was busy since the last call
+void series_advance(result *r, int t, int running)
+{
+    time_series *s = &r->series;
+    if (!s->tracked)
     {
-        dotted_line_in_file();
-        fputs("\nProcesses are :", fptr_write);
-        fputs("\n-----------------------------------------------------------\n", fptr_write);
-        fputs("| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Tickets  |\n", fptr_write);
-        fputs("-----------------------------------------------------------\n", fptr_write);
+        return;
     }
 
-    for (int i = 0; i < n; i++)
+    while (s->clock < t)
     {
-        if (result_on_terminal)
+        // next point where something changes : end of window or t
+        int next = s->current.start + s->width;
+        if (t < next)
+        {
+            next = t;
+        }
+
+        int waiting = s->in_system - running;
+        if (waiting < 0)
+        {
+            waiting = 0;
+        }
+        s->current.queue_area += (long long)waiting * (next - s->clock);
+        if (running)
         {
-            printf("|  %2d  |  %2d  |  %12d  |  %10d  | %3d -%3d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].tickets[0], ps[i].tickets[1]);
+            s->current.busy += next - s->clock;
         }
-        if (result_in_file)
+        s->clock = next;
+
+        if (s->clock == s->current.start + s->width)
         {
-            fprintf(fptr_write, "|  %2d  |  %2d  |  %12d  |  %10d  | %3d -%3d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].tickets[0], ps[i].tickets[1]);
+            series_close_window(r);
         }
     }
+}
+
+void series_close_window(result *r)
+{
+    time_series *s = &r->series;
+    s->current.width = s->clock - s->current.start;
 
-    if (result_on_terminal)
+    if (s->count == SERIES_CAPACITY)
     {
-        printf("-----------------------------------------------------------\n");
+        // ring is full, forget the oldest window
+        s->head = (s->head + 1) % SERIES_CAPACITY;
+        s->count--;
+        s->dropped++;
     }
+    s->windows[(s->head + s->count) % SERIES_CAPACITY] = s->current;
+    s->count++;
 
-    if (result_in_file)
+    if (s->fptr != NULL)
     {
-        fputs("-----------------------------------------------------------\n", fptr_write);
+        fprintf(s->fptr, "%d,%d,%d,%d,%d,%d,%lld\n", s->algorithm, s->current.start, s->current.width, s->current.busy,
+                s->current.completions, s->current.context_switch, s->current.queue_area);
     }
+
+    s->current = (series_window){s->clock, 0, 0, 0, 0, 0};
+}
+
+// a process arrived at t, the engine admits arrivals at their own time
+void series_arrival(result *r, int t)
+{
+    series_advance(r, t, 0);
+    r->series.in_system++;
 }
 
-void display_EDF_details(process *ps, int n)
+void series_context_switch(result *r, int t)
 {
-    if (result_on_terminal)
+    series_advance(r, t, 0);
+    r->series.current.context_switch++;
+}
+
+void series_completion(result *r, int t)
+{
+    series_advance(r, t, 0);
+    r->series.current.completions++;
+    r->series.in_system--;
+}
+
+// to be called for every stretch of time a process holds the cpu
+void series_finish(result *r, int end)
+{
+    time_series *s = &r->series;
+    series_advance(r, end, 0);
+    if (s->tracked && s->clock > s->current.start)
     {
-        printf("\n---------------------------------------------------------------------------\n");
-        printf("| S.No |  ID  |  Arrival-Time  | Period |  Burst-Time  | No. of Execution |\n");
-        printf("---------------------------------------------------------------------------\n");
+        series_close_window(r);
     }
-    if (result_in_file)
+    s->tracked = 0;
+
+    r->idle_time = end - r->busy_time - r->overhead_time;
+    r->cpu_utilization = end > 0 ? (1.0) * r->busy_time / end : 0;
+    r->io_utilization = end > 0 ? (1.0) * r->io_busy / end : 0;
+    r->overhead_share = end > 0 ? (1.0) * r->overhead_time / end : 0;
+}
+
+void trace_begin(sim_context *ctx, int algorithm)
+{
+    trace_buffer *tracer = &ctx->tracer;
+    tracer->count = 0;
+    tracer->total = 0;
+    if (!ctx->trace_enabled)
     {
-        dotted_line_in_file();
-        fputs("\nProcesses are :", fptr_write);
-        fputs("\n---------------------------------------------------------------------------\n", fptr_write);
-        fputs("| S.No |  ID  |  Arrival-Time  | Period |  Burst-Time  | No. of Execution |\n", fptr_write);
-        fputs("---------------------------------------------------------------------------\n", fptr_write);
+        return;
     }
 
-    for (int i = 0; i < n; i++)
+    if (tracer->records == NULL)
     {
-        if (result_on_terminal)
-        {
-            printf("|  %2d  |  %2d  |  %12d  |  %4d  |  %10d  | %16d |\n", i + 1, ps[i].id, ps[i].at, ps[i].period, ps[i].bt, ps[i].no_of_execution);
-        }
-        if (result_in_file)
+        tracer->records = malloc(TRACE_CAPACITY * sizeof(trace_record));
+        tracer->fptr = ctx->trace_path[0] != '\0' ? fopen(ctx->trace_path, "wb") : NULL;
+        if (tracer->fptr != NULL)
         {
-            fprintf(fptr_write, "|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  | %3d |\n", i + 1, ps[i].id, ps[i].at, ps[i].period, ps[i].bt, ps[i].no_of_execution);
+            int record_size = sizeof(trace_record);
+            fwrite(TRACE_MAGIC, 1, 8, tracer->fptr);
+            fwrite(&record_size, sizeof(int), 1, tracer->fptr);
         }
     }
+    trace_event(tracer, TRACE_RUN, 0, 0, algorithm);
+}
 
-    if (result_on_terminal)
+// block is full : to the trace file if there is one, otherwise start overwriting the oldest
+void trace_spill(trace_buffer *tracer)
+{
+    if (tracer->fptr != NULL)
     {
-        printf("---------------------------------------------------------------------------\n");
+        fwrite(tracer->records, sizeof(trace_record), tracer->count, tracer->fptr);
     }
+    tracer->count = 0;
+}
 
-    if (result_in_file)
+void trace_end(trace_buffer *tracer)
+{
+    if (tracer->records != NULL && tracer->fptr != NULL)
     {
-        fputs("---------------------------------------------------------------------------\n", fptr_write);
+        trace_spill(tracer);
     }
 }
 
-void round_robin(process *ps, int time_quantum, int no_of_process, result *final_result)
+void trace_close(trace_buffer *tracer)
 {
-    sort_by_arrival(ps, no_of_process);
-    int timeline = 0;
-    int index = 0;
-    int previous_process = -1;
-
-    if (debug_RR)
+    if (tracer->fptr != NULL)
     {
-        printf("\nDebugging\n");
-        printf("| Timeline  | ID | Remaining Burst Time| Response-Time | Completion Time \n");
+        fclose(tracer->fptr);
     }
+    free(tracer->records);
+    tracer->records = NULL;
+    tracer->fptr = NULL;
+}
 
-    while (1)
+#if SIM_COUNTERS
+#ifdef __linux__
+int perf_open(unsigned int type, unsigned long long config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group == -1; // the group starts when its leader is enabled
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+// without perf_event_open (other systems, or perf_event_paranoid too high) only latency is measured
+void counters_open(hw_counters *counters)
+{
+    counters->opened = 1;
+    counters->available = 0;
+    for (int k = 0; k < NO_OF_COUNTERS; k++)
     {
-        if (ps[index].rbt > 0)
+        counters->fd[k] = -1;
+        counters->slot[k] = -1;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        for (int j = 0; j < NO_OF_PHASES; j++)
         {
-            if (ps[index].rt == -1)
-            {
-                ps[index].rt = timeline - ps[index].at;
-            }
-
-            if (previous_process == -1)
-            {
-                previous_process = ps[index].id;
-            }
-            else if (previous_process != ps[index].id)
-            {
-                final_result[0].context_switch++;
-                previous_process = ps[index].id;
-            }
-
-            if (debug_RR)
-            {
-
-                printf("| (%2d - %2d) | %2d | %19d | %15f |", timeline, timeline + time_quantum, ps[index].id, ps[index].rbt, ps[index].rt);
-            }
-
-            if (ps[index].rbt > time_quantum)
-            {
-                timeline += time_quantum;
-                ps[index].rbt -= time_quantum;
-            }
-            else
-            {
-                timeline += ps[index].rbt;
-                ps[index].rbt = 0;
-                ps[index].ct = timeline;
-            }
-            if (debug_RR)
-            {
-                printf(" %15d |\n", ps[index].ct);
-            }
+            phase_counters *phase = &counters->phases[i][j];
+            phase->calls = 0;
+            memset(phase->totals, 0, sizeof(phase->totals));
+            stats_init(&phase->latency);
         }
+    }
 
-        // Finding next process with RBT > 0
-        int original_index = index;
-        do
-        {
-            index = (index + 1) % no_of_process;
-        } while (ps[index].rbt == 0 && original_index != index);
-
-        // process changed
-        // Checking if all processes are completed
-        int completed_processes = 0;
-        for (int i = 0; i < no_of_process; i++)
+#ifdef __linux__
+    unsigned long long configs[NO_OF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                  PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int k = 0; k < NO_OF_COUNTERS; k++)
+    {
+        counters->fd[k] = perf_open(PERF_TYPE_HARDWARE, configs[k], k == 0 ? -1 : counters->fd[0]);
+        if (counters->fd[k] == -1)
         {
-            if (ps[i].rbt == 0)
+            if (k == 0)
             {
-                completed_processes++;
+                return; // no group leader, nothing else can be read
             }
+            continue;
         }
-
-        // breaking condition
-        if (completed_processes == no_of_process)
-        {
-            break;
-        }
+        counters->slot[k] = counters->available++;
     }
-    final_result[0].throughput = (1.0) * no_of_process / timeline;
-    // printf("\nTimeline 0 : %d\n",timeline);
-
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 0);
-    // printf("\nART RR : %f", final_result[0].art);
+    ioctl(counters->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
 }
 
-void priority_scheduling(process *ps, int no_of_process, result *final_result)
+void counters_read(hw_counters *counters, counter_sample *sample)
 {
-    // set_processes(ps, no_of_process);
-    set_RBT_RT(ps, no_of_process);
-    sort_by_priority(ps, no_of_process);
-    int timeline = 0;
-    int index = 0;
-    int previous_process = -1;
-
-    if (debug_PRIORITY)
+    if (!counters->opened)
     {
-        printf("\nDebugging\n");
-        printf("| Timeline  | ID | Priority | Remaining Burst Time | Completion Time | Context-Switch |\n");
+        counters_open(counters);
     }
 
-    int completed_processes = 0;
-    while (completed_processes < no_of_process)
+    memset(sample->values, 0, sizeof(sample->values));
+#ifdef __linux__
+    unsigned long long buffer[1 + NO_OF_COUNTERS]; // no. of counters, then their values
+    if (counters->available > 0 && read(counters->fd[0], buffer, sizeof(buffer)) > 0)
     {
-        if (ps[index].at <= timeline && ps[index].rbt > 0)
+        for (int k = 0; k < NO_OF_COUNTERS; k++)
         {
-            if (ps[index].rt == -1)
-            {
-                ps[index].rt = timeline - ps[index].at;
-            }
-            if (previous_process == -1)
-            {
-                previous_process = ps[index].id;
-            }
-            else if (previous_process != ps[index].id)
+            if (counters->slot[k] != -1)
             {
-                final_result[1].context_switch++;
-                previous_process = ps[index].id;
+                sample->values[k] = buffer[1 + counters->slot[k]];
             }
+        }
+    }
+#endif
+
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    sample->ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-            timeline += ps[index].rbt;
-            ps[index].rbt = 0;
-            ps[index].ct = timeline;
-            completed_processes++;
+void counters_record(hw_counters *counters, counter_sample *begin, int algorithm, int phase)
+{
+    counter_sample end;
+    counters_read(counters, &end);
 
-            if (debug_PRIORITY)
-            {
-                printf("| (%2d - %2d) | %2d | %8d | %19d | %19d | %19d |\n",
-                       timeline - ps[index].bt, timeline, ps[index].id, ps[index].priority, ps[index].bt, ps[index].ct, final_result[1].context_switch);
-            }
-            index = 0;
-        }
-        else
+    phase_counters *p = &counters->phases[algorithm][phase];
+    p->calls++;
+    for (int k = 0; k < NO_OF_COUNTERS; k++)
+    {
+        p->totals[k] += end.values[k] - begin->values[k];
+    }
+    stats_add(&p->latency, end.ns - begin->ns);
+}
+
+void counters_close(hw_counters *counters)
+{
+    if (!counters->opened)
+    {
+        return;
+    }
+    for (int k = 0; k < NO_OF_COUNTERS; k++)
+    {
+#ifdef __linux__
+        if (counters->fd[k] != -1)
         {
-            int original_index = index;
-            do
-            {
-                index = (index + 1) % no_of_process;
-            } while (ps[index].rbt == 0 && original_index != index && ps[index].at > timeline);
+            close(counters->fd[k]);
         }
+#endif
+        counters->fd[k] = -1;
     }
-    final_result[1].throughput = (1.0) * no_of_process / timeline;
-    // printf("\nTimeline 1 : %d\n",timeline);
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 1);
-    // printf("\nART Priority : %f", final_result[1].art);
+    counters->available = 0;
+    counters->opened = 0;
 }
+#endif
 
-void lottery_scheduling(process *ps, int time_quantum, int no_of_process, result *final_result)
+void report_add_sink(report *rep, int kind, FILE *fptr)
 {
-    set_RBT_RT(ps, no_of_process);
-    sort_by_index(ps, no_of_process);
-    int timeline = 0;
-    int index = 0;
-    int ticket_number = 0;
-    int local_tq = 0; // local variable to keep track of time spent on the current process
-    int previous_process = -1;
-    int ticket_range = ps[no_of_process - 1].tickets[1];
-    if (debug_LOTTERY)
+    if (fptr == NULL || rep->no_of_sinks == MAX_SINKS)
     {
-        printf("\nDebugging Lottery Scheduling\n");
-        printf("| Timeline  | ID | Remaining Burst Time | Completion Time |\n");
+        return;
     }
 
-    int completed_processes = 0;
-    while (completed_processes < no_of_process)
+    report_sink *sink = &rep->sinks[rep->no_of_sinks++];
+    sink->kind = kind;
+    sink->fptr = fptr;
+    sink->rows = 0;
+
+    if (kind == SINK_CSV && rep->tuning)
+    {
+        fputs("workload,algorithm,rung,processes,ticket_scaling,quantum,objective,value,runs,lo,hi,dropped\n", fptr);
+    }
+    else if (kind == SINK_CSV)
+    {
+        fputs("workload,algorithm,processes,awt,att,art,context_switch,throughput,cpu_utilization,"
+              "wt_p50,wt_p95,wt_p99,wt_p999,tat_p50,tat_p95,tat_p99,tat_p999,rt_p50,rt_p95,rt_p99,rt_p999,overhead\n",
+              fptr);
+    }
+    else if (kind == SINK_JSON)
     {
-        ticket_number = generate_random_number(1, ticket_range);     // generating random no. between 1 - ticket range
-        index = get_process_index(ps, no_of_process, ticket_number); // will give index of process by ticket number
+        fputs("[", fptr);
+    }
+}
+
+// formats straight into the buffer, the sinks only see it on report_flush()
+void report_printf(report *rep, const char *format, ...)
+{
+    va_list args;
+    int room = REPORT_BUFFER_SIZE - rep->length;
+
+    va_start(args, format);
+    int written = vsnprintf(rep->buffer + rep->length, room, format, args);
+    va_end(args);
 
-        if (previous_process == -1)
+    if (written >= room)
+    {
+        // did not fit, empty the buffer and format again at the start
+        report_flush(rep);
+        va_start(args, format);
+        written = vsnprintf(rep->buffer, REPORT_BUFFER_SIZE, format, args);
+        va_end(args);
+        if (written >= REPORT_BUFFER_SIZE)
         {
-            previous_process = ps[index].id;
+            written = REPORT_BUFFER_SIZE - 1; // longer than the whole buffer, cut
         }
-        else if (previous_process != ps[index].id)
+    }
+    if (written > 0)
+    {
+        rep->length += written;
+    }
+}
+
+// histogram bars and dotted lines, one memset instead of one call per character
+void report_repeat(report *rep, char c, int count)
+{
+    while (count > 0)
+    {
+        if (rep->length == REPORT_BUFFER_SIZE)
         {
-            final_result[2].context_switch++;
-            previous_process = ps[index].id;
+            report_flush(rep);
         }
-
-        if (ps[index].at <= timeline && ps[index].rbt > 0)
+        int chunk = REPORT_BUFFER_SIZE - rep->length;
+        if (chunk > count)
         {
-            if (ps[index].rt == -1)
-            {
-                ps[index].rt = timeline - ps[index].at;
-            }
-
-            if (ps[index].rbt > time_quantum)
-            {
-                local_tq = time_quantum;
-                timeline += time_quantum;
-                ps[index].rbt -= time_quantum;
-                ps[index].ct = timeline;
-            }
-            else
-            {
-                local_tq = ps[index].rbt;
-                timeline += ps[index].rbt;
-                ps[index].rbt = 0;
-                ps[index].ct = timeline;
-                completed_processes++;
-            }
-
-            if (debug_LOTTERY)
-            {
-                printf("| (%2d - %2d) | %2d | %19d | %19d |\n",
-                       timeline - local_tq, timeline, ps[index].id, ps[index].rbt, ps[index].ct);
-            }
+            chunk = count;
         }
+        memset(rep->buffer + rep->length, c, chunk);
+        rep->length += chunk;
+        count -= chunk;
     }
-    final_result[2].throughput = (1.0) * no_of_process / timeline;
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 2);
-    // printf("\nART Lottery : %f", final_result[2].art);
 }
 
-void fcfs_scheduling(process *ps, int no_of_process, result *final_result)
+void report_flush(report *rep)
 {
-    set_RBT_RT(ps, no_of_process);
-    sort_by_arrival(ps, no_of_process); // sorted acc. to arrival time
-    int previous_process = -1;
-    int timeline = 0;
-    int index = 0;
-    if (debug_FCFS)
+    for (int i = 0; i < rep->no_of_sinks; i++)
     {
-        printf("\nDebugging FCFS Scheduling\n");
-        printf("| Timeline  | ID | Remaining Burst Time | Completion Time |\n");
+        if (rep->sinks[i].kind == SINK_TEXT)
+        {
+            fwrite(rep->buffer, 1, rep->length, rep->sinks[i].fptr);
+            fflush(rep->sinks[i].fptr);
+        }
     }
+    rep->length = 0;
+}
 
-    int completed_processes = 0;
-    while (completed_processes < no_of_process)
+// text as a JSON string : quotes, backslashes (Windows paths) and control characters escaped
+void report_json_string(FILE *fptr, const char *text)
+{
+    fputc('"', fptr);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++)
     {
-        if (ps[index].rt == -1)
+        if (*c == '"' || *c == '\\')
         {
-            ps[index].rt = timeline - ps[index].at;
+            fputc('\\', fptr);
+            fputc(*c, fptr);
         }
-        if (previous_process == -1)
+        else if (*c < 0x20)
         {
-            previous_process = ps[index].id;
-        }
-        else if (previous_process != ps[index].id)
-        {
-            final_result[3].context_switch++;
-            previous_process = ps[index].id;
-        }
-        if (ps[index].at <= timeline && ps[index].rbt > 0)
-        {
-            timeline += ps[index].rbt;
-            ps[index].rbt = 0;
-            ps[index].ct = timeline;
-            completed_processes++;
-
-            if (debug_FCFS)
-            {
-                printf("| (%2d - %2d) | %2d | %19d | %19d |\n",
-                       timeline - ps[index].bt, timeline, ps[index].id, ps[index].bt, ps[index].ct);
-            }
+            fprintf(fptr, "\\u%04x", *c);
         }
         else
         {
-            printf("\nNote : Arrival time is greater than timeline !");
+            fputc(*c, fptr);
         }
-        index++;
     }
-    final_result[3].throughput = (1.0) * no_of_process / timeline;
-    // printf("\nTimeline 3 : %d\n",timeline);
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 3);
+    fputc('"', fptr);
 }
 
-void sjf_scheduling(process *ps, int no_of_process, result *final_result)
+// machine readable copy of one algorithm's result for the CSV / JSON sinks
+void report_algorithm(report *rep, result *final_result, int i, process *ps, int n)
 {
-    set_RBT_RT(ps, no_of_process);
-    sort_by_arrival(ps, no_of_process); // sorted acc. to arrival time
-
-    int timeline = 0;
-    int index = 0;
-    int previous_process = -1;
-    if (debug_SJF)
-    {
-        printf("\nDebugging SJF Scheduling\n");
-        printf("| Timeline  | ID | Remaining Burst Time | Completion Time |\n");
-    }
+    result *r = &final_result[i];
+    latency_stats *stats[3] = {&r->wt_stats, &r->tat_stats, &r->rt_stats};
+    char *metrics[3] = {"wt", "tat", "rt"};
+    char *workload = rep->workload != NULL ? rep->workload : "default";
 
-    int completed_processes = 0;
-    while (completed_processes < no_of_process)
+    for (int s = 0; s < rep->no_of_sinks; s++)
     {
-        int shortest_job_index = -1;
-        int shortest_job_time = INT_MAX;
+        report_sink *sink = &rep->sinks[s];
+        FILE *fptr = sink->fptr;
 
-        for (int i = 0; i < no_of_process; i++)
+        if (sink->kind == SINK_CSV)
         {
-            if (ps[i].at <= timeline && ps[i].rbt > 0 && ps[i].rbt < shortest_job_time)
+            fprintf(fptr, "%s,%s,%d,%f,%f,%f,%d,%f,%f", workload, algorithm_names[i], n, r->awt, r->att, r->art,
+                    r->context_switch, r->throughput, r->cpu_utilization);
+            for (int j = 0; j < 3; j++)
             {
-                shortest_job_time = ps[i].rbt;
-                shortest_job_index = i;
+                fprintf(fptr, ",%f,%f,%f,%f", stats_percentile(stats[j], 50), stats_percentile(stats[j], 95),
+                        stats_percentile(stats[j], 99), stats_percentile(stats[j], 99.9));
             }
+            fprintf(fptr, ",%f\n", r->overhead_share);
         }
-
-        if (shortest_job_index != -1)
+        else if (sink->kind == SINK_JSON)
         {
-
-            if (debug_SJF)
-            {
-                printf("| (%2d - %2d) | %2d | %19d |", timeline, timeline + ps[shortest_job_index].rbt,
-                       ps[shortest_job_index].id, ps[shortest_job_index].rbt);
-            }
-            if (ps[shortest_job_index].rt == -1)
-            {
-                ps[shortest_job_index].rt = timeline - ps[shortest_job_index].at;
-            }
-            if (previous_process == -1)
+            fprintf(fptr, "%s\n  {\"workload\": ", sink->rows > 0 ? "," : "");
+            report_json_string(fptr, workload);
+            fputs(", \"algorithm\": ", fptr);
+            report_json_string(fptr, algorithm_names[i]);
+            fprintf(fptr, ", \"awt\": %f, \"att\": %f, \"art\": %f, \"context_switch\": %d, "
+                          "\"throughput\": %f, \"cpu_utilization\": %f, \"overhead\": %f",
+                    r->awt, r->att, r->art, r->context_switch, r->throughput, r->cpu_utilization, r->overhead_share);
+            for (int j = 0; j < 3; j++)
             {
-                previous_process = ps[shortest_job_time].id;
+                fprintf(fptr, ", \"%s\": {\"p50\": %f, \"p95\": %f, \"p99\": %f, \"p99.9\": %f, \"stddev\": %f}", metrics[j],
+                        stats_percentile(stats[j], 50), stats_percentile(stats[j], 95), stats_percentile(stats[j], 99),
+                        stats_percentile(stats[j], 99.9), stats_stddev(stats[j]));
             }
-            else if (previous_process != ps[shortest_job_time].id)
+            // packed workloads keep no per-process outcome
+            if (ps != NULL)
             {
-                final_result[4].context_switch++;
-                previous_process = ps[index].id;
+                fputs(",\n   \"processes\": [", fptr);
+                for (int k = 0; k < n; k++)
+                {
+                    fprintf(fptr, "%s{\"id\": %d, \"at\": %d, \"bt\": %d, \"ct\": %d, \"tat\": %f, \"wt\": %f, \"rt\": %f}",
+                            k > 0 ? ", " : "", ps[k].id, ps[k].at, ps[k].bt, ps[k].ct, ps[k].tat, ps[k].wt, ps[k].rt);
+                }
+                fputs("]", fptr);
             }
+            fputs("}", fptr);
+        }
+        sink->rows++;
+    }
+}
 
-            timeline += ps[shortest_job_index].rbt;
-            ps[shortest_job_index].rbt = 0;
-            ps[shortest_job_index].ct = timeline;
-            completed_processes++;
-
-            if (debug_SJF)
-            {
-                printf(" %19d |\n", ps[shortest_job_index].ct);
-            }
+// machine readable copy of a candidate's search on a rung (0 : the grid) for the CSV / JSON sinks,
+// objective is "switches" when no quantum kept to the budget
+void report_tuning(report *rep, int algorithm, int rung, int n, const tune_candidate *c, const char *objective, int dropped)
+{
+    char *workload = rep->workload != NULL ? rep->workload : "default";
+    for (int s = 0; s < rep->no_of_sinks; s++)
+    {
+        report_sink *sink = &rep->sinks[s];
+        if (sink->kind == SINK_CSV)
+        {
+            fprintf(sink->fptr, "%s,%s,%d,%d,%f,%d,%s,%f,%d,%d,%d,%d\n", workload, algorithm_names[algorithm], rung, n,
+                    c->scaling, c->quantum, objective, c->value, c->runs, c->lo, c->hi, dropped);
         }
-        else
+        else if (sink->kind == SINK_JSON)
         {
-            timeline++;
+            fprintf(sink->fptr, "%s\n  {\"workload\": ", sink->rows > 0 ? "," : "");
+            report_json_string(sink->fptr, workload);
+            fputs(", \"algorithm\": ", sink->fptr);
+            report_json_string(sink->fptr, algorithm_names[algorithm]);
+            fprintf(sink->fptr, ", \"rung\": %d, \"processes\": %d, \"ticket_scaling\": %f, \"quantum\": %d, \"objective\": ",
+                    rung, n, c->scaling, c->quantum);
+            report_json_string(sink->fptr, objective);
+            fprintf(sink->fptr, ", \"value\": %f, \"runs\": %d, \"lo\": %d, \"hi\": %d, \"dropped\": %s}", c->value,
+                    c->runs, c->lo, c->hi, dropped ? "true" : "false");
         }
+        sink->rows++;
     }
-
-    final_result[4].throughput = (1.0) * no_of_process / timeline;
-    // printf("\nTimeline 4 : %d\n",timeline);
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 4);
 }
 
-void srtn_scheduling(process *ps, int no_of_process, result *final_result)
+void report_close(report *rep)
 {
-    set_RBT_RT(ps, no_of_process);
-    sort_by_arrival(ps, no_of_process); // sorted acc. to arrival time
-    int previous_process = -1;
-    int timeline = 0;
-    int index = 0;
-
-    if (debug_SRTN)
+    report_flush(rep);
+    for (int i = 0; i < rep->no_of_sinks; i++)
     {
-        printf("\nDebugging SJF Scheduling\n");
-        printf("| Timeline  | ID | Remaining Burst Time | Completion Time |\n");
+        report_sink *sink = &rep->sinks[i];
+        if (sink->kind == SINK_JSON)
+        {
+            fputs("\n]\n", sink->fptr);
+        }
+        if (sink->fptr != stdout)
+        {
+            fclose(sink->fptr);
+        }
     }
+    rep->no_of_sinks = 0;
+}
 
-    int completed_processes = 0;
-    while (completed_processes < no_of_process)
+void display(sim_context *ctx, process *ps, int n)
+{
+    report_printf(&ctx->rep, "\n------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Priority  |  Tickets  |\n");
+    report_printf(&ctx->rep, "------------------------------------------------------------------------\n");
+    for (int i = 0; i < n; i++)
     {
-        int shortest_job_index = -1;
-        int shortest_job_time = INT_MAX;
+        report_printf(&ctx->rep, "|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  | %3d -%3d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].priority, ps[i].tickets[0], ps[i].tickets[1]);
+    }
+    report_printf(&ctx->rep, "------------------------------------------------------------------------\n");
+}
 
-        // Find the process with the shortest remaining burst time among the arrived processes
-        for (int i = 0; i < no_of_process; i++)
-        {
-            if (ps[i].at <= timeline && ps[i].rbt > 0 && ps[i].rbt < shortest_job_time)
-            {
-                shortest_job_time = ps[i].rbt;
-                shortest_job_index = i;
-            }
-        }
-
-        if (shortest_job_index != -1)
-        {
-            if (debug_SRTN)
-            {
-                printf("| (%2d - %2d) | %2d | %19d |", timeline, timeline + 1, ps[shortest_job_index].id, ps[shortest_job_index].rbt);
-            }
-            if (ps[shortest_job_index].rt == -1)
-            {
-                ps[shortest_job_index].rt = timeline - ps[shortest_job_index].at;
-            }
-            timeline++;
-            ps[shortest_job_index].rbt--;
+void display2(sim_context *ctx, process *ps, int n)
+{
+    report_printf(&ctx->rep, "\n------------------------------------------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| S.No | ID  | Arrival-Time  | Brust-Time  | Completion-Time  | Turn-Around-Time | Waiting-Time | Response-Time  |\n");
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "| %4d | %2d  | %12d  | %10d  | %15d  | %15f  | %11f  | %14f |\n",
+                      i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].ct, ps[i].tat, ps[i].wt, ps[i].rt);
+    }
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------------------------------------------\n");
+}
 
-            if (previous_process == -1)
-            {
-                previous_process = ps[index].id;
-            }
-            else if (previous_process != ps[shortest_job_index].id)
-            {
-                final_result[5].context_switch++;
-                previous_process = ps[shortest_job_index].id;
-            }
-            // Checking if the process has completed
-            if (ps[shortest_job_index].rbt == 0)
-            {
-                ps[shortest_job_index].ct = timeline;
-                completed_processes++;
+void display_Basic_process_details(sim_context *ctx, process *ps, int n)
+{
+    report_printf(&ctx->rep, "\n-----------------------------------------------\n");
+    report_printf(&ctx->rep, "| S.No |  ID  |  Arrival-Time  |  Burst-Time  |\n");
+    report_printf(&ctx->rep, "-----------------------------------------------\n");
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "|  %2d  |  %2d  |  %12d  |  %10d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt);
+    }
+    report_printf(&ctx->rep, "-----------------------------------------------\n");
+}
 
-                // Print completion details
-                if (debug_SRTN)
-                {
-                    printf(" %19d |\n", ps[shortest_job_index].ct);
-                }
-            }
-            else
-            {
-                if (debug_SRTN)
-                {
-                    printf("\n");
-                }
-            }
-        }
-        else
-        {
-            // No process is available, just increment timeline
-            timeline++;
-        }
+void display_priority_process_details(sim_context *ctx, process *ps, int n)
+{
+    report_printf(&ctx->rep, "\n------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Priority  |\n");
+    report_printf(&ctx->rep, "------------------------------------------------------------\n");
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "|  %2d  |  %2d  |  %12d  |  %10d  |  %8d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].priority);
     }
-    final_result[5].throughput = (1.0) * no_of_process / timeline;
-    // printf("\nTimeline 5 : %d\n",timeline);
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 5);
+    report_printf(&ctx->rep, "------------------------------------------------------------\n");
 }
 
-void hrrn_scheduling(process *ps, int no_of_process, result *final_result)
+void display_Lottery_process_details(sim_context *ctx, process *ps, int n)
 {
-    set_RBT_RT(ps, no_of_process);
-    sort_by_arrival(ps, no_of_process); // sorted acc. to arrival time
-    int previous_process = -1;
-    int timeline = 0;
+    report_printf(&ctx->rep, "\n-----------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| S.No |  ID  |  Arrival-Time  |  Burst-Time  |  Tickets  |\n");
+    report_printf(&ctx->rep, "-----------------------------------------------------------\n");
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "|  %2d  |  %2d  |  %12d  |  %10d  | %3d -%3d  |\n", i + 1, ps[i].id, ps[i].at, ps[i].bt, ps[i].tickets[0], ps[i].tickets[1]);
+    }
+    report_printf(&ctx->rep, "-----------------------------------------------------------\n");
+}
 
-    if (debug_HRRN)
+void display_EDF_details(sim_context *ctx, process *ps, int n)
+{
+    report_printf(&ctx->rep, "\n---------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| S.No |  ID  |  Arrival-Time  | Period |  Burst-Time  | No. of Execution |\n");
+    report_printf(&ctx->rep, "---------------------------------------------------------------------------\n");
+    for (int i = 0; i < n; i++)
     {
-        printf("\nDebugging HRRN Scheduling\n");
-        printf("| Timeline  | ID | Remaining Burst Time | Completion Time |\n");
+        report_printf(&ctx->rep, "|  %2d  |  %2d  |  %12d  |  %4d  |  %10d  | %16d |\n", i + 1, ps[i].id, ps[i].at, ps[i].period, ps[i].bt, ps[i].no_of_execution);
     }
+    report_printf(&ctx->rep, "---------------------------------------------------------------------------\n");
+}
 
-    int completed_processes = 0;
-    while (completed_processes < no_of_process)
+int compare_entry(const void *a, const void *b)
+{
+    const queue_entry *x = a, *y = b;
+    if (x->key != y->key)
     {
-        int selected_process_index = -1;
-        double highest_response_ratio = -1;
+        return (x->key > y->key) - (x->key < y->key);
+    }
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
 
-        for (int i = 0; i < no_of_process; i++)
+// binary heap on (key, seq), smallest first
+void heap_push(queue_entry *heap, int *count, queue_entry entry)
+{
+    int i = (*count)++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (compare_entry(&heap[parent], &entry) <= 0)
         {
-            if (ps[i].at <= timeline && ps[i].rbt > 0)
-            {
-                double response_ratio = (timeline - ps[i].at + ps[i].bt) / (double)ps[i].bt;
-
-                if (response_ratio > highest_response_ratio)
-                {
-                    highest_response_ratio = response_ratio;
-                    selected_process_index = i;
-                }
-            }
+            break;
         }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = entry;
+}
 
-        if (selected_process_index != -1)
+queue_entry heap_pop(queue_entry *heap, int *count)
+{
+    queue_entry top = heap[0];
+    queue_entry last = heap[--(*count)];
+    int i = 0;
+    while (1)
+    {
+        int child = 2 * i + 1;
+        if (child >= *count)
         {
-            if (debug_HRRN)
-            {
-
-                printf("| (%2d - %2d) | %2d | %19d |\n", timeline, timeline + ps[selected_process_index].rbt,
-                       ps[selected_process_index].id, ps[selected_process_index].rbt);
-            }
-
-            if (ps[selected_process_index].rt == -1)
-            {
-                ps[selected_process_index].rt = timeline - ps[selected_process_index].at;
-            }
-            if (previous_process == -1)
-            {
-                previous_process = ps[selected_process_index].id;
-            }
-            else if (previous_process != ps[selected_process_index].id)
-            {
-                final_result[6].context_switch++;
-                previous_process = ps[selected_process_index].id;
-            }
-            timeline += ps[selected_process_index].rbt;
-            ps[selected_process_index].rbt = 0;
-            ps[selected_process_index].ct = timeline;
-            completed_processes++;
-
-            if (debug_HRRN)
-            {
-                printf(" %19d |\n", ps[selected_process_index].ct);
-            }
+            break;
         }
-        else
+        if (child + 1 < *count && compare_entry(&heap[child + 1], &heap[child]) < 0)
+        {
+            child++;
+        }
+        if (compare_entry(&last, &heap[child]) <= 0)
         {
-            timeline++;
+            break;
         }
+        heap[i] = heap[child];
+        i = child;
     }
-    final_result[6].throughput = (1.0) * no_of_process / timeline;
-    // printf("\nTimeline 6 : %d\n",timeline);
-    calculate_TAT_WT(ps, no_of_process);
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 6);
+    heap[i] = last;
+    return top;
 }
 
-void set_current_deadline_AT(process *ps, int n)
+// per process arrays for n processes, 0 when out of memory
+int wheel_alloc(timer_wheel *w, arena *memory, int n)
 {
-    for (int i = 0; i < n; i++)
-    {
-        ps[i].at = 0;
-        ps[i].current_deadline = ps[i].period;
-    }
+    size_t size = n > 0 ? n : 1;
+    w->nodes = arena_alloc(memory, size * sizeof(wheel_node));
+    w->overdue = arena_alloc(memory, size * sizeof(queue_entry));
+    wheel_reset(w);
+    return w->nodes != NULL && w->overdue != NULL;
 }
 
-void sort_by_deadline(process *ps, int n)
+void wheel_reset(timer_wheel *w)
 {
-    process temp;
-    for (int i = 0; i < n - 1; i++)
+    w->clock = 0;
+    w->count = 0;
+    w->next = INT_MAX;
+    w->stale = 0;
+    w->no_of_overdue = 0;
+    memset(w->occupied, 0, sizeof(w->occupied));
+    memset(w->head, -1, sizeof(w->head));
+    memset(w->tail, -1, sizeof(w->tail));
+}
+
+// first non-empty slot of a level, -1 when the level is empty
+int wheel_lowest_slot(const unsigned long long *occupied)
+{
+    for (int k = 0; k < WHEEL_WORDS; k++)
     {
-        for (int j = 0; j < n - 1 - i; j++)
+        unsigned long long bits = occupied[k];
+        if (bits != 0)
         {
-            if (ps[j].current_deadline > ps[j + 1].current_deadline)
+#if defined(__GNUC__)
+            return 64 * k + __builtin_ctzll(bits);
+#else
+            int s = 64 * k;
+            while ((bits & 1) == 0)
             {
-                temp = ps[j + 1];
-                ps[j + 1] = ps[j];
-                ps[j] = temp;
+                bits >>= 1;
+                s++;
             }
+            return s;
+#endif
         }
     }
+    return -1;
 }
 
-void set_Execution_buffer(process *ps, int n)
+// appends timer i to the slot its time has against the current clock
+void wheel_link(timer_wheel *w, int i)
 {
-    for (int i = 0; i < n; i++)
+    wheel_node *node = &w->nodes[i];
+    unsigned long long time = (unsigned long long)node->timer.key;
+    unsigned long long differ = time ^ (unsigned long long)w->clock;
+    int level = 0;
+    while (differ >= WHEEL_SLOTS)
+    {
+        differ >>= WHEEL_BITS;
+        level++;
+    }
+    int s = (int)((time >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+
+    node->link = -1;
+    node->back = w->tail[level][s];
+    node->slot = level * WHEEL_SLOTS + s;
+    if (node->back == -1)
+    {
+        w->head[level][s] = i;
+        w->occupied[level][s / 64] |= 1ULL << (s % 64);
+    }
+    else
     {
-        ps[i].no_of_execution_buffer = ps[i].no_of_execution;
+        w->nodes[node->back].link = i;
     }
+    w->tail[level][s] = i;
 }
 
-void edf_scheduling(process *ps, int no_of_process, result *final_result)
+// takes timer i out of its slot (cancels it)
+void wheel_unlink(timer_wheel *w, int i)
 {
-    int timeline = 0;
-
-    if (debug_EDF)
+    wheel_node *node = &w->nodes[i];
+    int level = node->slot / WHEEL_SLOTS, s = node->slot % WHEEL_SLOTS;
+    if (node->back == -1)
+    {
+        w->head[level][s] = node->link;
+    }
+    else
+    {
+        w->nodes[node->back].link = node->link;
+    }
+    if (node->link == -1)
     {
-        printf("\nDebugging EDF Scheduling\n");
-        printf("| Timeline  | ID | (AT, CD) | Done |\n");
+        w->tail[level][s] = node->back;
     }
+    else
+    {
+        w->nodes[node->link].back = node->back;
+    }
+    if (w->head[level][s] == -1)
+    {
+        w->occupied[level][s / 64] &= ~(1ULL << (s % 64));
+    }
+    node->slot = -1;
+}
 
-    int completed_processes = 0;
-    int i = 0, t1, t2;
-    while (completed_processes < no_of_process)
+// brings the earliest timer down to level 0 : while level 0 is empty the clock moves to the start
+// of the earliest slot above, whose timers then spread over the levels below it. Those are empty,
+// so every slot keeps the timers in the order they were set.
+void wheel_settle(timer_wheel *w)
+{
+    while (wheel_lowest_slot(w->occupied[0]) == -1)
     {
-        sort_by_deadline(ps, no_of_process);
-        i = 0;
-    label:
-        t1 = timeline;
-        if (debug_EDF)
+        int level = 1, s = -1;
+        while (level < WHEEL_LEVELS && (s = wheel_lowest_slot(w->occupied[level])) == -1)
         {
-            // printf("\nWorking on ID : %d\n", ps[i].id);
+            level++;
         }
-
-        if (ps[i].at <= timeline && ps[i].no_of_execution_buffer > 0)
+        if (s == -1)
         {
-            int at = ps[i].at;
-            ps[i].at = ps[i].current_deadline;
-            ps[i].current_deadline += ps[i].period;
-            timeline += ps[i].bt;
-            t2 = timeline;
-            ps[i].no_of_execution_buffer--;
-
-            if (ps[i].no_of_execution_buffer == 0)
-            {
-                completed_processes++;
-            }
+            return; // no timer in a slot
+        }
 
-            ps[i].tat += (1.0) * (t2 - at) / ps[i].no_of_execution;
-            ps[i].wt += (1.0) * (t1 - at) / ps[i].no_of_execution;
-            ps[i].rt = ps[i].wt;
+        int shift = WHEEL_BITS * level;
+        unsigned long long above = (unsigned long long)w->clock >> (shift + WHEEL_BITS) << (shift + WHEEL_BITS);
+        w->clock = (int)(above | ((unsigned long long)s << shift));
 
-            if (debug_EDF)
-            {
-                printf("| %3d -%3d  | %2d | %2d - %2d  | %4d |\n", t1, t2, ps[i].id, ps[i].at, ps[i].current_deadline, completed_processes);
-            }
-        }
-        else
+        int i = w->head[level][s];
+        w->head[level][s] = -1;
+        w->tail[level][s] = -1;
+        w->occupied[level][s / 64] &= ~(1ULL << (s % 64));
+        while (i != -1)
         {
-            i++;
-            goto label;
+            int next = w->nodes[i].link;
+            wheel_link(w, i);
+            i = next;
         }
     }
+}
+
+// timers of the same time expire in the order they were set, timer.seq has to grow from call to call
+void wheel_insert(timer_wheel *w, queue_entry timer)
+{
+    w->count++;
+    if (timer.key < w->clock)
+    {
+        heap_push(w->overdue, &w->no_of_overdue, timer);
+        return;
+    }
+    w->nodes[timer.index].timer = timer;
+    wheel_link(w, timer.index);
+    if (!w->stale && timer.key < w->next)
+    {
+        w->next = (int)timer.key;
+    }
+}
 
-    calculate_AWT_ATT_ART(ps, no_of_process, final_result, 7);
-    // final_result[7].context_switch = no_of_process - 1;
+// earliest pending time, INT_MAX when nothing is pending
+int wheel_next(timer_wheel *w)
+{
+    // overdue timers are before the clock, so before every timer in a slot
+    if (w->no_of_overdue > 0)
+    {
+        return (int)w->overdue[0].key;
+    }
+    if (w->stale)
+    {
+        wheel_settle(w);
+        int s = wheel_lowest_slot(w->occupied[0]);
+        w->next = s == -1 ? INT_MAX : ((w->clock & ~(WHEEL_SLOTS - 1)) | s);
+        w->stale = 0;
+    }
+    return w->next;
 }
 
-void display_result(result *final_result)
+// removes the earliest timer, (time, seq) order. count is not 0.
+queue_entry wheel_pop(timer_wheel *w)
 {
-    if (result_on_terminal)
+    w->count--;
+    if (w->no_of_overdue > 0)
     {
-        dotted_line();
-        printf("\n\nFinal Comparison");
-        display_AWT(final_result, 8);
-        dotted_line();
-        display_ATT(final_result, 8);
-        dotted_line();
-        display_ART(final_result, 8);
-        dotted_line();
-        display_Context_switch(final_result, 8);
-        dotted_line();
-        display_throughput(final_result, 8);
-        dotted_line();
+        return heap_pop(w->overdue, &w->no_of_overdue);
     }
+    wheel_settle(w);
+    int s = wheel_lowest_slot(w->occupied[0]);
+    int i = w->head[0][s];
+    w->clock = (w->clock & ~(WHEEL_SLOTS - 1)) | s;
+    wheel_unlink(w, i);
+    w->stale = 1;
+    return w->nodes[i].timer;
+}
 
-    if (result_in_file)
+// tree[1..n] holds the tickets of ready processes, i is a 0-based process index
+void fenwick_add(long long *tree, int n, int i, long long delta)
+{
+    for (i++; i <= n; i += i & -i)
     {
-        fputs("\n\nFinal Comparison", fptr_write);
-        display_AWT(final_result, 8);
-        dotted_line_in_file();
-        display_ATT(final_result, 8);
-        dotted_line_in_file();
-        display_ART(final_result, 8);
-        dotted_line_in_file();
-        display_Context_switch(final_result, 8);
-        dotted_line_in_file();
-        display_throughput(final_result, 8);
-        dotted_line_in_file();
+        tree[i] += delta;
     }
 }
 
-void display_AWT(result *final_result, int n)
+// 0-based index of the process holding ticket number target (1 <= target <= total)
+int fenwick_find(long long *tree, int n, long long target)
 {
-    double max = -1;
-    for (int i = 0; i < n; i++)
+    int step = 1;
+    while (step * 2 <= n)
     {
-        if (final_result[i].awt > max)
+        step *= 2;
+    }
+
+    int position = 0;
+    for (; step > 0; step /= 2)
+    {
+        if (position + step <= n && tree[position + step] < target)
         {
-            max = final_result[i].awt;
+            position += step;
+            target -= tree[position];
         }
     }
+    return position;
+}
+
+int process_tickets(const process *p)
+{
+    int tickets = p->tickets[1] - p->tickets[0] + 1;
+    return tickets > 0 ? tickets : 1;
+}
+
+// uniform in [1, total]
+long long random_ticket(sim_context *ctx, long long total)
+{
+    return (long long)(sim_random(ctx) % (unsigned long long)total) + 1;
+}
+
+// 0 when the memory for the run could not be allocated
+int engine_init(engine *e, sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol)
+{
+    e->ctx = ctx;
+    e->ps = ps;
+    e->n = n;
+    e->r = &ctx->final_result[pol->algorithm];
+    e->time_quantum = time_quantum > 0 ? time_quantum : 1;
+    e->now = 0;
+    e->running = -1;
+    e->slice_start = 0;
+    e->slice_end = 0;
+    e->previous = -1;
+    e->completed = 0;
+    e->jobs = 0;
+    e->seq = 0;
+    e->next_order = 0;
+    e->fifo_head = 0;
+    e->tickets_ready = 0;
+    e->ready = 0;
+    e->recording = NULL;
+    e->baseline = NULL;
+    e->next_checkpoint = 0;
+    e->changed = NULL;
+    e->no_of_changed = 0;
+    e->converged_at = -1;
+    e->feed = NULL;
+    e->io = workload_has_io(ps, n);
+    e->device = (io_device){NULL, 0, 0, -1, INT_MAX};
+    e->costed = run_has_costs(ctx);
+    e->switch_cost = ctx->switch_cost;
+    e->warmup_cost = ctx->warmup_cost;
+    e->warmup_time = ctx->warmup_time;
+    e->switch_at = 0;
+
+    // the run state and every array the policy needs live until the next run of the context
+    arena *memory = &ctx->memory;
+    size_t size = n > 0 ? n : 1;
+    run_state *s = &e->state;
+    s->remaining = arena_alloc(memory, size * sizeof(int));
+    s->first_run = arena_alloc(memory, size * sizeof(int));
+    s->ct = arena_alloc(memory, size * sizeof(int));
+    s->wt = arena_alloc(memory, size * sizeof(double));
+    s->tat = arena_alloc(memory, size * sizeof(double));
+    s->rt = arena_alloc(memory, size * sizeof(double));
+    e->order = arena_alloc(memory, size * sizeof(queue_entry));
+    int missing = s->remaining == NULL || s->first_run == NULL || s->ct == NULL || s->wt == NULL || s->tat == NULL ||
+                  s->rt == NULL || e->order == NULL;
+
+    s->cpu_left = NULL;
+    s->blocked = NULL;
+    s->woken = NULL;
+    if (e->io)
+    {
+        s->cpu_left = arena_alloc(memory, size * sizeof(int));
+        s->blocked = arena_alloc(memory, size * sizeof(int));
+        s->woken = arena_alloc(memory, size * sizeof(int));
+        e->device.queue = arena_alloc(memory, size * sizeof(int));
+        missing |= s->cpu_left == NULL || s->blocked == NULL || s->woken == NULL || e->device.queue == NULL;
+    }
 
-    double scale = 100 / max;
-    // printf("\nScale : %0.2f", scale);
+    s->last_ran = NULL;
+    if (e->costed)
+    {
+        s->last_ran = arena_alloc(memory, size * sizeof(int));
+        missing |= s->last_ran == NULL;
+    }
 
-    if (result_on_terminal)
+    s->release = NULL;
+    s->jobs_left = NULL;
+    e->releases = (timer_wheel){0};
+    wheel_reset(&e->releases);
+    if (pol->periodic)
     {
-        printf("\n--------------------------------\n");
-        printf("Average Waiting Time Comparison\n");
-        printf("--------------------------------\n");
+        s->release = arena_alloc(memory, size * sizeof(int));
+        s->jobs_left = arena_alloc(memory, size * sizeof(int));
+        missing |= s->release == NULL || s->jobs_left == NULL || !wheel_alloc(&e->releases, memory, n);
     }
 
-    if (result_in_file)
+    e->fifo = NULL;
+    e->heap = NULL;
+    e->fenwick = NULL;
+    switch (pol->queue)
+    {
+    case QUEUE_FIFO:
+        e->fifo = arena_alloc(memory, size * sizeof(int));
+        missing |= e->fifo == NULL;
+        break;
+    case QUEUE_HEAP:
+    case QUEUE_SCAN:
+        e->heap = arena_alloc(memory, size * sizeof(queue_entry));
+        missing |= e->heap == NULL;
+        break;
+    case QUEUE_LOTTERY:
+        e->fenwick = arena_alloc(memory, (size + 1) * sizeof(long long));
+        missing |= e->fenwick == NULL;
+        if (e->fenwick != NULL)
+        {
+            memset(e->fenwick, 0, (size + 1) * sizeof(long long));
+        }
+        break;
+    }
+    if (missing)
     {
-        fputs("\n--------------------------------\n", fptr_write);
-        fputs("Average Waiting Time Comparison\n", fptr_write);
-        fputs("--------------------------------\n", fptr_write);
+        return 0;
     }
 
     for (int i = 0; i < n; i++)
     {
-        if (result_on_terminal)
-        {
-            printf("\n");
-            if (i == 0)
-                printf("Round-Robin |");
-            else if (i == 1)
-                printf("Priority    |");
-            else if (i == 2)
-                printf("Lottery     |");
-            else if (i == 3)
-                printf("FCFS        |");
-            else if (i == 4)
-                printf("SJF         |");
-            else if (i == 5)
-                printf("SRTN        |");
-            else if (i == 6)
-                printf("HRRN        |");
-            else if (i == 7)
-                printf("EDF         |");
-        }
-        if (result_in_file)
-        {
-            fputs("\n", fptr_write);
-            if (i == 0)
-                fputs("Round-Robin |", fptr_write);
-            else if (i == 1)
-                fputs("Priority    |", fptr_write);
-            else if (i == 2)
-                fputs("Lottery     |", fptr_write);
-            else if (i == 3)
-                fputs("FCFS        |", fptr_write);
-            else if (i == 4)
-                fputs("SJF         |", fptr_write);
-            else if (i == 5)
-                fputs("SRTN        |", fptr_write);
-            else if (i == 6)
-                fputs("HRRN        |", fptr_write);
-            else if (i == 7)
-                fputs("EDF         |", fptr_write);
-        }
-
-        int awtStars = (int)(scale * final_result[i].awt);
-        // printf("\nStars : %d", awtStars);
-        for (int j = 0; j < awtStars; j++)
-        {
-            if (result_on_terminal)
-            {
-                printf("#");
-            }
-            if (result_in_file)
+        behavior_start(e, i);
+        s->first_run[i] = -1;
+        s->ct[i] = 0;
+        s->wt[i] = 0;
+        s->tat[i] = 0;
+        s->rt[i] = 0;
+    }
+    if (e->costed)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            s->last_ran[i] = -1;
+        }
+    }
+
+    if (pol->periodic)
+    {
+        // first job of every process is released at its arrival, the next ones on completion
+        for (int i = 0; i < n; i++)
+        {
+            s->release[i] = ps[i].at;
+            s->jobs_left[i] = ps[i].no_of_execution;
+            if (ps[i].no_of_execution > 0)
             {
-                fputs("#", fptr_write);
+                wheel_insert(&e->releases, (queue_entry){ps[i].at, e->seq++, i});
+                e->jobs += ps[i].no_of_execution;
             }
         }
+        e->next_order = n;
+        return 1;
+    }
 
-        if (result_on_terminal)
+    // workloads usually come sorted by arrival, then the sort can be skipped
+    int sorted = 1;
+    for (int i = 0; i < n; i++)
+    {
+        e->order[i] = (queue_entry){ps[i].at, i, i};
+        if (i > 0 && ps[i].at < ps[i - 1].at)
         {
-            printf(" (%.2f)\n", final_result[i].awt);
+            sorted = 0;
         }
-        if (result_in_file)
+    }
+    if (!sorted)
+    {
+        qsort(e->order, n, sizeof(queue_entry), compare_entry);
+    }
+    e->jobs = n;
+    return 1;
+}
+
+// arrival of the current job : periodic jobs are released once per period
+ENGINE_INLINE int engine_arrival(engine *e, int i, const policy pol)
+{
+    return pol.periodic ? e->state.release[i] : e->ps[i].at;
+}
+
+// 1 when a process of ps alternates cpu bursts and I/O requests
+int workload_has_io(const process *ps, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (ps[i].cpu_burst > 0 && ps[i].cpu_burst < ps[i].bt && ps[i].io_wait > 0)
         {
-            fprintf(fptr_write, " (%.2lf)\n", final_result[i].awt);
+            return 1;
         }
     }
+    return 0;
 }
 
-void display_ATT(result *final_result, int n)
+// 1 when the context charges time for switches or cache warmup, see engine_overhead
+int run_has_costs(const sim_context *ctx)
 {
-    double max = -1;
-    for (int i = 0; i < n; i++)
+    return ctx->switch_cost > 0 || ctx->warmup_cost > 0;
+}
+
+// Process behavior : an I/O-bound process runs cpu_burst, blocks for an I/O request, runs
+// cpu_burst again and so on until its job has had bt of cpu. It is a coroutine the engine
+// resumes whenever a burst ends (engine_stop) or its request is served (engine_wake), and
+// cpu_left is its whole frame, so millions of them cost an int each.
+// behavior_start sets up the first burst of a job.
+ENGINE_INLINE void behavior_start(engine *e, int i)
+{
+    const process *p = &e->ps[i];
+    run_state *s = &e->state;
+    s->remaining[i] = p->bt;
+    if (e->io)
     {
-        if (final_result[i].att > max)
+        if (p->cpu_burst > 0 && p->cpu_burst < p->bt && p->io_wait > 0)
         {
-            max = final_result[i].att;
+            s->remaining[i] = p->cpu_burst;
         }
+        s->cpu_left[i] = p->bt - s->remaining[i];
+        s->blocked[i] = 0;
+        s->woken[i] = -1;
     }
+}
 
-    double scale = 100 / max;
-    if (result_on_terminal)
+// process i ended a burst with cpu time left : it requests I/O and waits for the device
+ENGINE_INLINE void engine_block(engine *e, int i)
+{
+    io_device *d = &e->device;
+    e->state.blocked[i] -= e->now; // the served request adds its end
+    if (d->serving == -1)
+    {
+        d->serving = i;
+        d->done_at = e->now + e->ps[i].io_wait;
+        e->r->io_busy += e->ps[i].io_wait;
+    }
+    else
     {
-        printf("\n------------------------------------\n");
-        printf("Average Turn-Around Time Comparison\n");
-        printf("------------------------------------\n");
+        d->queue[(d->head + d->waiting) % e->n] = i;
+        d->waiting++;
     }
+}
 
-    if (result_in_file)
+// the request being served is done (at device.done_at) : its process gets its next burst and
+// goes to the ready queue, the device takes the next request
+ENGINE_INLINE void engine_wake(engine *e, const policy pol)
+{
+    io_device *d = &e->device;
+    run_state *s = &e->state;
+    int i = d->serving, done = d->done_at;
+    int burst = e->ps[i].cpu_burst < s->cpu_left[i] ? e->ps[i].cpu_burst : s->cpu_left[i];
+    s->blocked[i] += done;
+    s->remaining[i] = burst;
+    s->cpu_left[i] -= burst;
+    s->woken[i] = done;
+
+    if (d->waiting > 0)
+    {
+        int j = d->queue[d->head];
+        d->head = (d->head + 1) % e->n;
+        d->waiting--;
+        d->serving = j;
+        d->done_at = done + e->ps[j].io_wait;
+        e->r->io_busy += e->ps[j].io_wait;
+    }
+    else
     {
-        fputs("\n------------------------------------\n", fptr_write);
-        fputs("Average Turn-Around Time Comparison\n", fptr_write);
-        fputs("------------------------------------\n", fptr_write);
+        d->serving = -1;
+        d->done_at = INT_MAX;
     }
+    engine_enqueue(e, i, pol);
+}
 
-    for (int i = 0; i < n; i++)
+ENGINE_INLINE long long engine_key(engine *e, int i, const policy pol)
+{
+    switch (pol.key)
     {
-        if (result_on_terminal)
-        {
-            printf("\n");
-            if (i == 0)
-                printf("Round-Robin |");
-            else if (i == 1)
-                printf("Priority    |");
-            else if (i == 2)
-                printf("Lottery     |");
-            else if (i == 3)
-                printf("FCFS        |");
-            else if (i == 4)
-                printf("SJF         |");
-            else if (i == 5)
-                printf("SRTN        |");
-            else if (i == 6)
-                printf("HRRN        |");
-            else if (i == 7)
-                printf("EDF         |");
-        }
-        if (result_in_file)
-        {
-            fputs("\n", fptr_write);
-            if (i == 0)
-                fputs("Round-Robin |", fptr_write);
-            else if (i == 1)
-                fputs("Priority    |", fptr_write);
-            else if (i == 2)
-                fputs("Lottery     |", fptr_write);
-            else if (i == 3)
-                fputs("FCFS        |", fptr_write);
-            else if (i == 4)
-                fputs("SJF         |", fptr_write);
-            else if (i == 5)
-                fputs("SRTN        |", fptr_write);
-            else if (i == 6)
-                fputs("HRRN        |", fptr_write);
-            else if (i == 7)
-                fputs("EDF         |", fptr_write);
-        }
-
-        int attStars = (int)(scale * final_result[i].att);
-
-        for (int j = 0; j < attStars; j++)
-        {
-            if (result_on_terminal)
-            {
-                printf("#");
-            }
-            if (result_in_file)
+    case KEY_PRIORITY:
+        return e->ps[i].priority;
+    case KEY_BURST:
+        return e->state.remaining[i]; // the burst about to run, all of bt unless the process does I/O
+    case KEY_REMAINING:
+        return e->state.remaining[i];
+    case KEY_DEADLINE:
+        return (long long)engine_arrival(e, i, pol) + e->ps[i].period;
+    }
+    return 0;
+}
+
+ENGINE_INLINE void engine_enqueue(engine *e, int i, const policy pol)
+{
+    COUNTERS_BEGIN(&e->ctx->counters, enqueue);
+    switch (pol.queue)
+    {
+    case QUEUE_FIFO:
+        e->fifo[(e->fifo_head + e->ready) % e->n] = i;
+        e->ready++;
+        break;
+    case QUEUE_HEAP:
+        heap_push(e->heap, &e->ready, (queue_entry){engine_key(e, i, pol), e->seq++, i});
+        break;
+    case QUEUE_LOTTERY:
+        fenwick_add(e->fenwick, e->n, i, process_tickets(&e->ps[i]));
+        e->tickets_ready += process_tickets(&e->ps[i]);
+        e->ready++;
+        break;
+    case QUEUE_SCAN:
+        e->heap[e->ready++] = (queue_entry){0, e->seq++, i};
+        break;
+    }
+    COUNTERS_END(&e->ctx->counters, enqueue, pol.algorithm, PHASE_ENQUEUE);
+}
+
+// removes the next process to run from the ready queue, -1 when it is empty
+ENGINE_INLINE int engine_pick(engine *e, const policy pol)
+{
+    if (e->ready == 0)
+    {
+        return -1;
+    }
+
+    int i = -1;
+    switch (pol.queue)
+    {
+    case QUEUE_FIFO:
+        i = e->fifo[e->fifo_head];
+        e->fifo_head = (e->fifo_head + 1) % e->n;
+        e->ready--;
+        break;
+    case QUEUE_HEAP:
+        i = heap_pop(e->heap, &e->ready).index;
+        break;
+    case QUEUE_LOTTERY:
+        i = fenwick_find(e->fenwick, e->n, random_ticket(e->ctx, e->tickets_ready));
+        fenwick_add(e->fenwick, e->n, i, -process_tickets(&e->ps[i]));
+        e->tickets_ready -= process_tickets(&e->ps[i]);
+        e->ready--;
+        break;
+    case QUEUE_SCAN:
+    {
+        // highest response ratio (waiting + burst) / burst, compared without dividing
+        int best = 0;
+        for (int j = 1; j < e->ready; j++)
+        {
+            const process *p = &e->ps[e->heap[j].index], *q = &e->ps[e->heap[best].index];
+            long long lhs = (long long)(e->now - p->at + p->bt) * q->bt;
+            long long rhs = (long long)(e->now - q->at + q->bt) * p->bt;
+            if (lhs > rhs || (lhs == rhs && e->heap[j].seq < e->heap[best].seq))
             {
-                fputs("#", fptr_write);
+                best = j;
             }
         }
-        if (result_on_terminal)
-        {
-            printf(" (%.2lf)\n", final_result[i].att);
-        }
-        if (result_in_file)
-        {
-            fprintf(fptr_write, " (%.2lf)\n", final_result[i].att);
-        }
+        i = e->heap[best].index;
+        e->heap[best] = e->heap[--e->ready];
+        break;
     }
+    }
+    return i;
 }
 
-void display_ART(result *final_result, int n)
+// earliest arrival or periodic release not yet admitted, INT_MAX when there is none
+ENGINE_INLINE int engine_next_arrival(engine *e, const policy pol)
 {
-    double max = -1;
-    for (int i = 0; i < n; i++)
+    int next = INT_MAX;
+    if (e->next_order < e->n)
     {
-        if (final_result[i].art > max)
+        next = e->order[e->next_order].key;
+    }
+    if (pol.periodic && e->releases.count > 0 && wheel_next(&e->releases) < next)
+    {
+        next = wheel_next(&e->releases);
+    }
+    if (e->io && e->device.done_at < next)
+    {
+        next = e->device.done_at;
+    }
+    return next;
+}
+
+ENGINE_INLINE void engine_complete(engine *e, int i, const policy pol, const int traced, const int series, const int streamed)
+{
+    const process *p = &e->ps[i];
+    run_state *s = &e->state;
+    int arrival = engine_arrival(e, i, pol);
+    double tat = e->now - arrival;
+    double wt = tat - p->bt - (e->io ? s->blocked[i] : 0); // blocked on I/O is not waiting for the cpu
+    double rt = s->first_run[i] - arrival;
+    s->ct[i] = e->now;
+
+    if (pol.periodic)
+    {
+        // every periodic job counts as its own sample, the state keeps the average over the jobs
+        s->tat[i] += tat / p->no_of_execution;
+        s->wt[i] += wt / p->no_of_execution;
+        s->rt[i] += rt / p->no_of_execution;
+        s->jobs_left[i]--;
+        if (s->jobs_left[i] > 0)
+        {
+            // next job is released at the current deadline
+            s->release[i] += p->period;
+            behavior_start(e, i);
+            s->first_run[i] = -1;
+            wheel_insert(&e->releases, (queue_entry){s->release[i], e->seq++, i});
+        }
+    }
+    else
+    {
+        s->tat[i] = tat;
+        s->wt[i] = wt;
+        s->rt[i] = rt;
+    }
+
+    e->completed++;
+
+    COUNTERS_BEGIN(&e->ctx->counters, metrics);
+    record_job(e->r, wt, tat, rt);
+    if (series)
+    {
+        series_completion(e->r, e->now);
+    }
+    if (traced)
+    {
+        trace_event(&e->ctx->tracer, TRACE_COMPLETE, e->now, 0, p->id);
+    }
+    if (streamed && (!pol.periodic || s->jobs_left[i] == 0))
+    {
+        stream_retire(e, i);
+    }
+    COUNTERS_END(&e->ctx->counters, metrics, pol.algorithm, PHASE_METRICS);
+}
+
+// cost model : time the cpu spends before i runs, a switch from another process plus the
+// caches i lost since it last ran (a share of warmup_cost growing with the time, all of it
+// once warmup_time has passed or when i never ran)
+ENGINE_INLINE int engine_overhead(engine *e, int i, int switched)
+{
+    int cost = switched ? e->switch_cost : 0;
+    int last = e->state.last_ran[i];
+    int away = last == -1 ? INT_MAX : e->now - last;
+    if (away > 0 && away >= e->warmup_time)
+    {
+        cost += e->warmup_cost;
+    }
+    else if (away > 0)
+    {
+        cost += (int)((long long)e->warmup_cost * away / e->warmup_time);
+    }
+    return cost;
+}
+
+ENGINE_INLINE void engine_dispatch(engine *e, int i, const policy pol, const int series)
+{
+    int switched = e->previous != -1 && e->previous != i;
+    if (switched)
+    {
+        e->r->context_switch++;
+        if (series)
+        {
+            series_context_switch(e->r, e->now);
+        }
+    }
+    e->previous = i;
+    e->r->decisions++;
+
+    // the process starts running once the overhead of getting it on the cpu is paid
+    int start = e->costed ? e->now + engine_overhead(e, i, switched) : e->now;
+    if (e->state.first_run[i] == -1)
+    {
+        e->state.first_run[i] = start;
+    }
+    if (e->io && e->state.woken[i] != -1)
+    {
+        stats_add(&e->r->burst_stats, start - e->state.woken[i]);
+        e->state.woken[i] = -1;
+    }
+
+    int run = e->state.remaining[i];
+    if (pol.uses_quantum)
+    {
+        int quantum = e->ps[i].quantum > 0 ? e->ps[i].quantum : e->time_quantum;
+        if (run > quantum)
+        {
+            run = quantum;
+        }
+    }
+    e->running = i;
+    e->switch_at = e->now;
+    e->slice_start = start;
+    e->slice_end = start + run;
+}
+
+// takes the running process off the cpu at the current time
+ENGINE_INLINE void engine_stop(engine *e, const policy pol, const int traced, const int series, const int streamed)
+{
+    int i = e->running;
+    int start = e->slice_start, end = e->now;
+    if (e->costed)
+    {
+        if (start > end)
+        {
+            start = end; // preempted while still being switched in, nothing ran
+        }
+        e->r->overhead_time += start - e->switch_at;
+        e->state.last_ran[i] = end;
+    }
+
+    e->state.remaining[i] -= end - start;
+
+    COUNTERS_BEGIN(&e->ctx->counters, metrics);
+    e->r->busy_time += end - start;
+    if (traced)
+    {
+        trace_event(&e->ctx->tracer, TRACE_SLICE, start, end - start, e->ps[i].id);
+    }
+    if (series)
+    {
+        series_advance(e->r, start, 0);
+        series_advance(e->r, end, 1);
+    }
+    COUNTERS_END(&e->ctx->counters, metrics, pol.algorithm, PHASE_METRICS);
+
+    e->running = -1;
+    if (e->state.remaining[i] == 0 && e->io && e->state.cpu_left[i] > 0)
+    {
+        engine_block(e, i);
+    }
+    else if (e->state.remaining[i] == 0)
+    {
+        engine_complete(e, i, pol, traced, series, streamed);
+    }
+    else
+    {
+        engine_enqueue(e, i, pol);
+    }
+}
+
+// what ran of the current slice is filled in before the series counts an arrival of now
+ENGINE_INLINE void engine_series_arrival(engine *e)
+{
+    if (e->running != -1 && e->slice_start < e->now)
+    {
+        series_advance(e->r, e->slice_start, 0);
+        series_advance(e->r, e->now, 1);
+    }
+    series_arrival(e->r, e->now);
+}
+
+// queues everything that has arrived by now, a preemptive policy may take the cpu back
+ENGINE_INLINE void engine_admit(engine *e, const policy pol, const int traced, const int series, const int streamed)
+{
+    // a served I/O request queues its process ahead of arrivals of the same time
+    if (e->io)
+    {
+        while (e->device.done_at <= e->now)
+        {
+            engine_wake(e, pol);
+        }
+    }
+    while (e->next_order < e->n && e->order[e->next_order].key <= e->now)
+    {
+        if (series)
+        {
+            engine_series_arrival(e);
+        }
+        engine_enqueue(e, e->order[e->next_order++].index, pol);
+    }
+    if (pol.periodic)
+    {
+        while (e->releases.count > 0 && wheel_next(&e->releases) <= e->now)
+        {
+            if (series)
+            {
+                engine_series_arrival(e);
+            }
+            engine_enqueue(e, wheel_pop(&e->releases).index, pol);
+        }
+    }
+
+    // only heap queues preempt : the arrival wins if its key beats what is left of the running process
+    if (pol.preemptive && e->running != -1 && e->ready > 0)
+    {
+        // nothing has run while the process is still being switched in
+        int ran = e->now > e->slice_start ? e->now - e->slice_start : 0;
+        long long remaining = e->state.remaining[e->running] - ran;
+        if (e->heap[0].key < remaining)
+        {
+            engine_stop(e, pol, traced, series, streamed);
+        }
+    }
+}
+
+// runs the schedule up to time limit, or up to an earlier release made while running
+ENGINE_INLINE void engine_advance(engine *e, int limit, const policy pol, const int traced, const int series, const int streamed)
+{
+    while (1)
+    {
+        int until = limit;
+        if (pol.periodic && e->releases.count > 0 && wheel_next(&e->releases) < until)
+        {
+            until = wheel_next(&e->releases);
+        }
+        if (e->io && e->device.done_at < until)
+        {
+            until = e->device.done_at;
+        }
+
+        if (e->running == -1)
+        {
+            if (e->now >= until)
+            {
+                return;
+            }
+            COUNTERS_BEGIN(&e->ctx->counters, pick);
+            int i = engine_pick(e, pol);
+            COUNTERS_END(&e->ctx->counters, pick, pol.algorithm, PHASE_PICK);
+            if (i == -1)
+            {
+                // idle till the next arrival
+                if (until != INT_MAX)
+                {
+                    e->now = until;
+                }
+                return;
+            }
+            engine_dispatch(e, i, pol, series);
+        }
+
+        // a slice ending at an arrival stops after it is admitted, so RR queues the
+        // arrival ahead of the process whose quantum expired at the same time
+        if (e->slice_end > until || (e->slice_end == until && e->now < until))
+        {
+            if (until > e->now)
+            {
+                e->now = until;
+            }
+            return;
+        }
+        e->now = e->slice_end;
+        engine_stop(e, pol, traced, series, streamed);
+    }
+}
+
+// baseline : takes a snapshot when due. What-if : 1 once the state matches the baseline's
+// snapshot of the same time, the loop then stops and the baseline supplies the rest.
+ENGINE_INLINE int engine_checkpoint(engine *e, const policy pol)
+{
+    if (e->recording != NULL)
+    {
+        if (e->next_order >= e->next_checkpoint)
+        {
+            checkpoint_take(e, pol.queue);
+            e->next_checkpoint = e->next_order + e->recording->interval;
+        }
+        return 0;
+    }
+
+    const sim_checkpoints *c = e->baseline;
+    while (e->next_checkpoint < c->no_of_points && c->points[e->next_checkpoint].now < e->now)
+    {
+        e->next_checkpoint++;
+    }
+    return e->next_checkpoint < c->no_of_points && c->points[e->next_checkpoint].now == e->now &&
+           checkpoint_matches(e, pol.queue, &c->points[e->next_checkpoint]);
+}
+
+// the engine loop, every argument but e is a constant in each specialized copy
+ENGINE_INLINE void simulate(engine *e, const policy pol, const int traced, const int series, const int checkpointed)
+{
+    while (e->completed < e->jobs)
+    {
+        engine_advance(e, engine_next_arrival(e, pol), pol, traced, series, 0);
+        engine_admit(e, pol, traced, series, 0);
+
+        if (checkpointed && engine_checkpoint(e, pol))
+        {
+            checkpoint_converge(e, pol.queue, &e->baseline->points[e->next_checkpoint]);
+            break;
+        }
+        if (e->running == -1 && e->ready == 0 && engine_next_arrival(e, pol) == INT_MAX)
+        {
+            break;
+        }
+    }
+}
+
+// one copy of the loop per policy and instrumentation, chosen once per run.
+// Checkpoint runs are never traced and never track a series.
+#define DEFINE_SIMULATE(name, POLICY)                       \
+    void name(engine *e)                                    \
+    {                                                       \
+        int traced = SIM_TRACE && e->ctx->tracer.records != NULL; \
+        int series = e->r->series.tracked;                  \
+        if (e->recording != NULL || e->baseline != NULL)    \
+        {                                                   \
+            simulate(e, POLICY, 0, 0, 1);                   \
+        }                                                   \
+        else if (traced && series)                          \
+        {                                                   \
+            simulate(e, POLICY, SIM_TRACE, 1, 0);           \
+        }                                                   \
+        else if (traced)                                    \
+        {                                                   \
+            simulate(e, POLICY, SIM_TRACE, 0, 0);           \
+        }                                                   \
+        else if (series)                                    \
+        {                                                   \
+            simulate(e, POLICY, 0, 1, 0);                   \
+        }                                                   \
+        else                                                \
+        {                                                   \
+            simulate(e, POLICY, 0, 0, 0);                   \
+        }                                                   \
+    }
+
+DEFINE_SIMULATE(simulate_rr, RR_POLICY)
+DEFINE_SIMULATE(simulate_priority, PRIORITY_POLICY)
+DEFINE_SIMULATE(simulate_lottery, LOTTERY_POLICY)
+DEFINE_SIMULATE(simulate_fcfs, FCFS_POLICY)
+DEFINE_SIMULATE(simulate_sjf, SJF_POLICY)
+DEFINE_SIMULATE(simulate_srtn, SRTN_POLICY)
+DEFINE_SIMULATE(simulate_hrrn, HRRN_POLICY)
+DEFINE_SIMULATE(simulate_edf, EDF_POLICY)
+
+// same order as final_result, for callers that pick a policy by index
+static const policy *const policies[8] = {&RR_POLICY, &PRIORITY_POLICY, &LOTTERY_POLICY, &FCFS_POLICY,
+                                          &SJF_POLICY, &SRTN_POLICY, &HRRN_POLICY, &EDF_POLICY};
+static void (*const simulators[8])(engine *e) = {simulate_rr, simulate_priority, simulate_lottery, simulate_fcfs,
+                                                 simulate_sjf, simulate_srtn, simulate_hrrn, simulate_edf};
+
+// streamed runs : queues what was added at the current time (a preemptive policy may take the cpu
+// back), then runs the schedule up to limit, or till the system is empty when limit is INT_MAX.
+// What happens at limit itself is queued by the next step, with the arrivals of that time.
+ENGINE_INLINE void stream_step(engine *e, int limit, const policy pol)
+{
+    engine_admit(e, pol, 0, 0, 1);
+    while (e->now < limit)
+    {
+        engine_advance(e, limit, pol, 0, 0, 1);
+        if (e->now >= limit)
+        {
+            break;
+        }
+        engine_admit(e, pol, 0, 0, 1);
+        if (e->running == -1 && e->ready == 0 && (!pol.periodic || e->releases.count == 0) &&
+            e->device.done_at == INT_MAX)
+        {
+            break; // nothing happens before the next arrival
+        }
+    }
+}
+
+#define DEFINE_STREAM(name, POLICY)       \
+    void name(engine *e, int limit)       \
+    {                                     \
+        stream_step(e, limit, POLICY);    \
+    }
+
+DEFINE_STREAM(stream_rr, RR_POLICY)
+DEFINE_STREAM(stream_priority, PRIORITY_POLICY)
+DEFINE_STREAM(stream_lottery, LOTTERY_POLICY)
+DEFINE_STREAM(stream_fcfs, FCFS_POLICY)
+DEFINE_STREAM(stream_sjf, SJF_POLICY)
+DEFINE_STREAM(stream_srtn, SRTN_POLICY)
+DEFINE_STREAM(stream_hrrn, HRRN_POLICY)
+DEFINE_STREAM(stream_edf, EDF_POLICY)
+
+static void (*const stream_steps[8])(engine *e, int limit) = {stream_rr, stream_priority, stream_lottery, stream_fcfs,
+                                                              stream_sjf, stream_srtn, stream_hrrn, stream_edf};
+
+// an engine without processes whose arrays are malloc'd, so they can grow with the system
+int stream_open(engine *e, stream *st, sim_context *ctx, const policy *pol, int time_quantum)
+{
+    *st = (stream){0};
+    arena_reset(&ctx->memory);
+    int ok = engine_init(e, ctx, NULL, 0, time_quantum, pol);
+    e->state = (run_state){0};
+    e->order = NULL;
+    e->releases.nodes = NULL;
+    e->releases.overdue = NULL;
+    e->fifo = NULL;
+    e->heap = NULL;
+    e->fenwick = NULL;
+    e->feed = st;
+    e->io = 1; // a process read later may do I/O
+    e->device.queue = NULL;
+    return ok && stream_grow(e, st, pol);
+}
+
+// realloc that leaves *array as it was when it fails
+int stream_resize(void **array, size_t size)
+{
+    void *grown = realloc(*array, size);
+    if (grown == NULL)
+    {
+        return 0;
+    }
+    *array = grown;
+    return 1;
+}
+
+// doubles the slots, 0 when out of memory (the engine then keeps its old size)
+int stream_grow(engine *e, stream *st, const policy *pol)
+{
+    int old = st->capacity, size = old > 0 ? 2 * old : STREAM_MIN_SLOTS;
+    run_state *s = &e->state;
+    int grown = stream_resize((void **)&st->rows, size * sizeof(process)) &&
+                stream_resize((void **)&st->free_slots, size * sizeof(int)) &&
+                stream_resize((void **)&s->remaining, size * sizeof(int)) &&
+                stream_resize((void **)&s->first_run, size * sizeof(int)) &&
+                stream_resize((void **)&s->ct, size * sizeof(int)) &&
+                stream_resize((void **)&s->wt, size * sizeof(double)) &&
+                stream_resize((void **)&s->tat, size * sizeof(double)) &&
+                stream_resize((void **)&s->rt, size * sizeof(double)) &&
+                stream_resize((void **)&s->cpu_left, size * sizeof(int)) &&
+                stream_resize((void **)&s->blocked, size * sizeof(int)) &&
+                stream_resize((void **)&s->woken, size * sizeof(int)) &&
+                stream_resize((void **)&e->device.queue, size * sizeof(int)) &&
+                (!e->costed || stream_resize((void **)&s->last_ran, size * sizeof(int)));
+    // the blocked queue is a ring too
+    if (grown && e->device.head + e->device.waiting > old)
+    {
+        memcpy(e->device.queue + old, e->device.queue, (e->device.head + e->device.waiting - old) * sizeof(int));
+    }
+    if (grown && pol->periodic)
+    {
+        grown = stream_resize((void **)&s->release, size * sizeof(int)) &&
+                stream_resize((void **)&s->jobs_left, size * sizeof(int)) &&
+                stream_resize((void **)&e->releases.nodes, size * sizeof(wheel_node)) &&
+                stream_resize((void **)&e->releases.overdue, size * sizeof(queue_entry));
+    }
+    if (grown)
+    {
+        switch (pol->queue)
+        {
+        case QUEUE_FIFO:
+            grown = stream_resize((void **)&e->fifo, size * sizeof(int));
+            // a ring that wrapped continues past the old end instead
+            if (grown && e->fifo_head + e->ready > old)
+            {
+                memcpy(e->fifo + old, e->fifo, (e->fifo_head + e->ready - old) * sizeof(int));
+            }
+            break;
+        case QUEUE_HEAP:
+        case QUEUE_SCAN:
+            grown = stream_resize((void **)&e->heap, size * sizeof(queue_entry));
+            break;
+        case QUEUE_LOTTERY:
+            // the nodes of the old tree keep their ranges, the new root covers everything
+            grown = stream_resize((void **)&e->fenwick, (size + 1) * sizeof(long long));
+            if (grown)
+            {
+                memset(e->fenwick + old + 1, 0, (size - old) * sizeof(long long));
+                e->fenwick[size] = e->tickets_ready;
+            }
+            break;
+        }
+    }
+    if (!grown)
+    {
+        return 0;
+    }
+
+    // lowest slots are handed out first
+    for (int i = size - 1; i >= old; i--)
+    {
+        st->free_slots[st->no_of_free++] = i;
+    }
+    st->capacity = size;
+    e->ps = st->rows;
+    e->n = size;
+    e->next_order = size; // arrivals never come through order
+    return 1;
+}
+
+// gives p a slot and queues it (periodic : its first release), 0 when out of memory
+int stream_add(engine *e, stream *st, const process *p, const policy *pol)
+{
+    if (st->no_of_free == 0 && !stream_grow(e, st, pol))
+    {
+        return 0;
+    }
+    int i = st->free_slots[--st->no_of_free];
+    run_state *s = &e->state;
+    st->rows[i] = *p;
+    behavior_start(e, i);
+    s->first_run[i] = -1;
+    if (e->costed)
+    {
+        s->last_ran[i] = -1;
+    }
+    s->ct[i] = 0;
+    s->wt[i] = 0;
+    s->tat[i] = 0;
+    s->rt[i] = 0;
+    st->active++;
+    st->arrived++;
+
+    // requests served by now queue ahead of the arrival, as engine_admit has it
+    while (e->io && e->device.done_at <= e->now)
+    {
+        engine_wake(e, *pol);
+    }
+    if (!pol->periodic)
+    {
+        engine_enqueue(e, i, *pol);
+    }
+    else if (p->no_of_execution > 0)
+    {
+        s->release[i] = p->at;
+        s->jobs_left[i] = p->no_of_execution;
+        wheel_insert(&e->releases, (queue_entry){p->at, e->seq++, i});
+    }
+    else
+    {
+        st->free_slots[st->no_of_free++] = i; // no job to run
+        st->active--;
+    }
+    return 1;
+}
+
+// process i completed its last job : writes its record and frees its slot
+void stream_retire(engine *e, int i)
+{
+    stream *st = e->feed;
+    const process *p = &st->rows[i];
+    run_state *s = &e->state;
+    if (st->completions)
+    {
+        fprintf(st->out, "completion%s%s,%d,%d,%d,%d,%f,%f,%f\n", st->policy != NULL ? "," : "",
+                st->policy != NULL ? st->policy : "", s->ct[i], p->id, p->at, p->bt, s->tat[i], s->wt[i], s->rt[i]);
+    }
+    // the next process in the slot is another one, its first dispatch is a context-switch
+    if (e->previous == i)
+    {
+        e->previous = -2;
+    }
+    st->free_slots[st->no_of_free++] = i;
+    st->active--;
+    st->last_completion = s->ct[i];
+}
+
+// metrics of the run up to time, the slice on the cpu counts as far as it got
+void stream_report(engine *e, int time)
+{
+    stream *st = e->feed;
+    result *r = e->r;
+    long long busy = r->busy_time + (e->running != -1 && time > e->slice_start ? time - e->slice_start : 0);
+    long long overhead = r->overhead_time;
+    if (e->running != -1 && e->costed)
+    {
+        overhead += (time < e->slice_start ? time : e->slice_start) - e->switch_at;
+    }
+    fprintf(st->out, "metrics%s%s,%d,%lld,%lld,%d,%f,%f,%f,%f,%f,%d,%f,%f\n", st->policy != NULL ? "," : "",
+            st->policy != NULL ? st->policy : "", time, st->arrived, r->tat_stats.count,
+            st->active, r->awt, r->att, r->art, stats_percentile(&r->wt_stats, 95), stats_percentile(&r->tat_stats, 95),
+            r->context_switch, time > 0 ? (1.0) * busy / time : 0, time > 0 ? (1.0) * overhead / time : 0);
+    fflush(st->out);
+}
+
+void stream_close(engine *e, stream *st)
+{
+    free(st->rows);
+    free(st->free_slots);
+    free(e->state.remaining);
+    free(e->state.first_run);
+    free(e->state.ct);
+    free(e->state.wt);
+    free(e->state.tat);
+    free(e->state.rt);
+    free(e->state.cpu_left);
+    free(e->state.blocked);
+    free(e->state.woken);
+    free(e->state.last_ran);
+    free(e->device.queue);
+    free(e->state.release);
+    free(e->state.jobs_left);
+    free(e->releases.nodes);
+    free(e->releases.overdue);
+    free(e->fifo);
+    free(e->heap);
+    free(e->fenwick);
+}
+
+// next process of the feed, 0 at its end. With follow the end of the file is only where the
+// writer has got to : reading waits there for more, keeping a half written line for later.
+int stream_next(FILE *fptr, int follow, char *line, int size, process *p, FILE *out)
+{
+    int used = 0;
+    while (1)
+    {
+        if (fgets(line + used, size - used, fptr) == NULL)
+        {
+            if (!follow)
+            {
+                return 0;
+            }
+            fflush(out);
+            stream_wait();
+            clearerr(fptr);
+            continue;
+        }
+        used = strlen(line);
+        if (follow && line[used - 1] != '\n' && used < size - 1)
+        {
+            continue; // the rest of the line is not written yet
+        }
+        used = 0;
+        if (read_process(line, p))
+        {
+            return 1;
+        }
+    }
+}
+
+void stream_wait(void)
+{
+#ifdef _WIN32
+    _sleep(200);
+#else
+    usleep(200000);
+#endif
+}
+
+// appends p to the block being filled, a full block is encoded. 0 when out of memory
+int pack_add(packed_workload *w, const process *p)
+{
+    int j = w->no_of_pending++;
+    w->pending[0][j] = p->at; // turned into gaps when the block is encoded
+    w->pending[1][j] = p->bt;
+    w->pending[2][j] = p->priority;
+    w->pending[3][j] = p->period - p->bt; // 0 unless the file gave a period
+    w->pending[4][j] = p->no_of_execution;
+    w->pending[5][j] = p->quantum;
+    w->pending[6][j] = p->cpu_burst;
+    w->pending[7][j] = p->io_wait;
+    w->pending[8][j] = process_tickets(p);
+    w->n++;
+    w->last_at = p->at;
+    return w->no_of_pending < PACK_BLOCK || pack_flush(w);
+}
+
+// encodes the block being filled (a short last block is padded with offsets of 0), 0 when out of memory
+int pack_flush(packed_workload *w)
+{
+    int count = w->no_of_pending;
+    if (count == 0)
+    {
+        return 1;
+    }
+    if (w->no_of_blocks == w->blocks_capacity)
+    {
+        int size = w->blocks_capacity > 0 ? 2 * w->blocks_capacity : 1024;
+        if (!stream_resize((void **)&w->blocks, size * sizeof(pack_block)))
+        {
+            return 0;
+        }
+        w->blocks_capacity = size;
+    }
+    pack_block *block = &w->blocks[w->no_of_blocks];
+    block->offset = w->no_of_words;
+    block->at = w->pending[0][0];
+    for (int j = count - 1; j > 0; j--)
+    {
+        w->pending[0][j] -= w->pending[0][j - 1];
+    }
+    w->pending[0][0] = 0;
+
+    long long words = 0;
+    for (int c = 0; c < PACK_COLUMNS; c++)
+    {
+        int *values = w->pending[c];
+        int low = values[0], high = values[0];
+        for (int j = 1; j < count; j++)
+        {
+            low = values[j] < low ? values[j] : low;
+            high = values[j] > high ? values[j] : high;
+        }
+        for (int j = count; j < PACK_BLOCK; j++)
+        {
+            values[j] = low;
+        }
+        unsigned int range = (unsigned int)high - (unsigned int)low;
+        int bits = 0;
+        while (bits < 32 && (range >> bits) != 0)
+        {
+            bits++;
+        }
+        block->base[c] = low;
+        block->bits[c] = (unsigned char)bits;
+        words += PACK_LANES * bits; // PACK_BLOCK / PACK_LANES values of bits in every lane
+    }
+
+    // two rows of padding : a decode reads one row past the column it is in
+    long long need = w->no_of_words + words + 2 * PACK_LANES;
+    if (need > w->words_capacity)
+    {
+        long long size = w->words_capacity > 0 ? 2 * w->words_capacity : 1 << 16;
+        size = size < need ? need : size;
+        if (!stream_resize((void **)&w->words, size * sizeof(unsigned int)))
+        {
+            return 0;
+        }
+        w->words_capacity = size;
+    }
+    unsigned int *out = w->words + w->no_of_words;
+    memset(out, 0, (words + 2 * PACK_LANES) * sizeof(unsigned int));
+    for (int c = 0; c < PACK_COLUMNS; c++)
+    {
+        int bits = block->bits[c];
+        for (int j = 0; bits > 0 && j < PACK_BLOCK; j++)
+        {
+            int bit = j / PACK_LANES * bits, lane = j % PACK_LANES;
+            unsigned int *word = out + (bit >> 5) * PACK_LANES + lane;
+            unsigned long long offset = (unsigned long long)((unsigned int)w->pending[c][j] - (unsigned int)block->base[c])
+                                        << (bit & 31);
+            word[0] |= (unsigned int)offset;
+            word[PACK_LANES] |= (unsigned int)(offset >> 32);
+        }
+        out += PACK_LANES * bits;
+    }
+    w->no_of_words += words;
+    w->no_of_blocks++;
+    w->no_of_pending = 0;
+    return 1;
+}
+
+// rows of block b, PACK_BLOCK of them whatever the count of a short last block. The lanes of a
+// column share their shift, the inner loop has no branch and compiles to vector code.
+void pack_decode(const packed_workload *w, int b, process *rows)
+{
+    const pack_block *block = &w->blocks[b];
+    const unsigned int *in = w->words + block->offset;
+    int values[PACK_COLUMNS][PACK_BLOCK];
+    for (int c = 0; c < PACK_COLUMNS; c++)
+    {
+        int bits = block->bits[c];
+        unsigned int base = (unsigned int)block->base[c];
+        unsigned long long mask = (1ULL << bits) - 1;
+        for (int k = 0; k < PACK_BLOCK / PACK_LANES; k++)
+        {
+            int bit = k * bits, shift = bit & 31;
+            const unsigned int *row = in + (bit >> 5) * PACK_LANES;
+            int *out = values[c] + k * PACK_LANES;
+            for (int l = 0; l < PACK_LANES; l++)
+            {
+                unsigned long long pair = row[l] | (unsigned long long)row[l + PACK_LANES] << 32;
+                out[l] = (int)(base + (unsigned int)((pair >> shift) & mask));
+            }
+        }
+        in += PACK_LANES * bits;
+    }
+
+    int at = block->at;
+    long long first = (long long)b * PACK_BLOCK;
+    for (int j = 0; j < PACK_BLOCK; j++)
+    {
+        process *p = &rows[j];
+        at += values[0][j];
+        p->id = (int)(first + j + 1);
+        p->at = at;
+        p->bt = values[1][j];
+        p->priority = values[2][j];
+        p->period = values[3][j] + p->bt;
+        p->no_of_execution = values[4][j];
+        p->quantum = values[5][j];
+        p->cpu_burst = values[6][j];
+        p->io_wait = values[7][j];
+        p->tickets[0] = 1;
+        p->tickets[1] = values[8][j];
+        p->ct = 0;
+        p->wt = 0;
+        p->tat = 0;
+        p->rt = -1;
+    }
+}
+
+void pack_free(packed_workload *w)
+{
+    if (w != NULL)
+    {
+        free(w->blocks);
+        free(w->words);
+        free(w);
+    }
+}
+
+// a workload file (in arrival order, see workload_tools --sort) packed as it is read, tickets are
+// drawn as load_workload_file draws them. NULL when it cannot be read, is out of order or has no process.
+packed_workload *load_packed_file(sim_context *ctx, char *file)
+{
+    FILE *fptr = fopen(file, "r");
+    packed_workload *w = fptr != NULL ? calloc(1, sizeof(packed_workload)) : NULL;
+    if (w == NULL)
+    {
+        if (fptr != NULL)
+        {
+            fclose(fptr);
+        }
+        return NULL;
+    }
+
+    int ok = 1;
+    char line[256];
+    process read;
+    while (ok && fgets(line, sizeof(line), fptr) != NULL)
+    {
+        if (!read_process(line, &read))
+        {
+            continue;
+        }
+        if ((w->n > 0 && read.at < w->last_at) || w->n == INT_MAX)
+        {
+            fprintf(stderr, "%s : %s\n", file, w->n == INT_MAX ? "too many processes" : "not in arrival order, sort it with workload_tools --sort first");
+            ok = 0;
+            break;
+        }
+        read.tickets[0] = 1;
+        read.tickets[1] = 1 + generate_random_number(ctx, 0, 19);
+        ok = pack_add(w, &read);
+    }
+    ok = ok && pack_flush(w) && w->n > 0;
+    fclose(fptr);
+    if (!ok)
+    {
+        pack_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+// replays a packed workload through a fused run of k policies : a block is decoded once for all of
+// them when the replay gets to it and only the processes in the system hold engine state. 0 when out
+// of memory, the outcome of every policy is in ctx->final_result.
+int run_packed(sim_context *ctx, const int *algorithms, int k, const packed_workload *w, int time_quantum)
+{
+    fused_run f;
+    int ok = fused_open(&f, ctx, algorithms, k, time_quantum, NULL, 0, 0);
+    int count = 0;
+    for (int b = 0; ok && b < w->no_of_blocks; b++)
+    {
+        pack_decode(w, b, f.filling + count);
+        long long left = w->n - (long long)b * PACK_BLOCK;
+        count += left < PACK_BLOCK ? (int)left : PACK_BLOCK;
+        if (count == FUSE_BATCH || b == w->no_of_blocks - 1)
+        {
+            fused_feed(&f, count);
+            count = 0;
+        }
+    }
+    ok = ok && fused_finish(&f);
+    for (int l = 0; ok && l < k; l++)
+    {
+        ctx->final_result[algorithms[l]] = f.lanes[l].ctx->final_result[algorithms[l]];
+    }
+    fused_close(&f);
+    return ok;
+}
+
+// a lane per algorithm, each with the settings and the seed of ctx. Records go to out, metrics
+// every `every` time units (0 : none). 0 when out of memory, fused_close is needed either way.
+int fused_open(fused_run *f, sim_context *ctx, const int *algorithms, int k, int time_quantum, FILE *out,
+               int completions, int every)
+{
+    memset(f, 0, sizeof(fused_run));
+    f->batch = malloc(FUSE_BATCH * sizeof(process));
+    f->filling = malloc(FUSE_BATCH * sizeof(process));
+    int ok = f->batch != NULL && f->filling != NULL && k <= FUSE_MAX_LANES;
+    for (int l = 0; ok && l < k; l++)
+    {
+        fused_lane *lane = &f->lanes[l];
+        lane->ctx = sim_create();
+        if (lane->ctx == NULL)
+        {
+            return 0;
+        }
+        f->no_of_lanes++;
+        lane->ctx->track_series = 0;
+        sim_seed(lane->ctx, ctx->seed);
+        sim_set_switch_cost(lane->ctx, ctx->switch_cost, ctx->warmup_cost, ctx->warmup_time);
+        lane->pol = policies[algorithms[l]];
+        lane->step = stream_steps[algorithms[l]];
+        lane->ok = stream_open(&lane->e, &lane->st, lane->ctx, lane->pol, time_quantum);
+        lane->st.out = out;
+        lane->st.completions = completions;
+        lane->st.policy = k > 1 ? algorithm_names[algorithms[l]] : NULL;
+        lane->every = every;
+        lane->next_report = every;
+        ok = lane->ok;
+    }
+#if SIM_PTHREADS
+    // one lane runs on the reader's thread, as a run of one policy would
+    if (ok && f->no_of_lanes > 1)
+    {
+        pthread_mutex_init(&f->lock, NULL);
+        pthread_cond_init(&f->fed, NULL);
+        pthread_cond_init(&f->done, NULL);
+        f->threaded = 1;
+        for (int l = 0; l < f->no_of_lanes; l++)
+        {
+            f->lanes[l].run = f;
+            f->started[l] = pthread_create(&f->workers[l], NULL, fused_worker, &f->lanes[l]) == 0;
+        }
+    }
+#endif
+    return ok;
+}
+
+// runs a lane through its batch (the arrivals of the same time are all queued before its schedule
+// moves on) and when draining on to the end
+void fused_lane_run(fused_lane *lane)
+{
+    engine *e = &lane->e;
+    stream *st = &lane->st;
+    for (int j = 0; lane->ok && j < lane->count; j++)
+    {
+        process p = lane->batch[j];
+        if (p.at < e->now)
+        {
+            p.at = e->now;
+            st->late++;
+        }
+        if (p.at > e->now)
+        {
+            while (lane->every > 0 && lane->next_report <= p.at)
+            {
+                lane->step(e, lane->next_report);
+                stream_report(e, lane->next_report);
+                lane->next_report += lane->every;
+            }
+            if (p.at > e->now)
+            {
+                lane->step(e, p.at); // unless a report already took the schedule there
+            }
+        }
+        lane->ok = stream_add(e, st, &p, lane->pol);
+    }
+    if (!lane->ok || !lane->draining)
+    {
+        return;
+    }
+
+    if (lane->every == 0)
+    {
+        lane->step(e, INT_MAX);
+        series_finish(e->r, e->now);
+        e->r->throughput = e->now > 0 ? (1.0) * e->completed / e->now : 0;
+        return;
+    }
+    // the processes still in the system run to completion
+    while (st->active > 0)
+    {
+        lane->step(e, lane->next_report);
+        if (st->active == 0)
+        {
+            break; // reported at its last completion instead
+        }
+        stream_report(e, lane->next_report);
+        lane->next_report += lane->every;
+    }
+    if (st->last_completion > lane->next_report - lane->every)
+    {
+        stream_report(e, st->last_completion);
+    }
+}
+
+#if SIM_PTHREADS
+// the start routine of a lane's thread : runs every batch handed over until the run closes
+void *fused_worker(void *arg)
+{
+    fused_lane *lane = arg;
+    fused_run *f = lane->run;
+    pthread_mutex_lock(&f->lock);
+    for (;;)
+    {
+        while (lane->taken == f->fed_batches && !f->closing)
+        {
+            pthread_cond_wait(&f->fed, &f->lock);
+        }
+        if (lane->taken == f->fed_batches)
+        {
+            break;
+        }
+        lane->taken = f->fed_batches;
+        pthread_mutex_unlock(&f->lock);
+        fused_lane_run(lane);
+        pthread_mutex_lock(&f->lock);
+        if (--f->busy == 0)
+        {
+            pthread_cond_signal(&f->done);
+        }
+    }
+    pthread_mutex_unlock(&f->lock);
+    return NULL;
+}
+#endif
+
+// hands the count arrivals read into filling to every lane, once they are done with the last batch
+void fused_feed(fused_run *f, int count)
+{
+    fused_wait(f);
+    process *batch = f->batch;
+    f->batch = f->filling;
+    f->filling = batch;
+    for (int l = 0; l < f->no_of_lanes; l++)
+    {
+        f->lanes[l].batch = f->batch;
+        f->lanes[l].count = count;
+    }
+#if SIM_PTHREADS
+    if (f->threaded)
+    {
+        pthread_mutex_lock(&f->lock);
+        for (int l = 0; l < f->no_of_lanes; l++)
+        {
+            f->busy += f->started[l];
+        }
+        f->fed_batches++;
+        pthread_cond_broadcast(&f->fed);
+        pthread_mutex_unlock(&f->lock);
+    }
+    for (int l = 0; l < f->no_of_lanes; l++)
+    {
+        if (!f->started[l])
+        {
+            fused_lane_run(&f->lanes[l]);
+        }
+    }
+#else
+    for (int l = 0; l < f->no_of_lanes; l++)
+    {
+        fused_lane_run(&f->lanes[l]);
+    }
+#endif
+}
+
+// until the lane threads are done with the last batch
+void fused_wait(fused_run *f)
+{
+#if SIM_PTHREADS
+    if (f->threaded)
+    {
+        pthread_mutex_lock(&f->lock);
+        while (f->busy > 0)
+        {
+            pthread_cond_wait(&f->done, &f->lock);
+        }
+        pthread_mutex_unlock(&f->lock);
+    }
+#else
+    (void)f;
+#endif
+}
+
+// the feed ended : every lane runs to its end, 0 when one ran out of memory
+int fused_finish(fused_run *f)
+{
+    fused_wait(f);
+    for (int l = 0; l < f->no_of_lanes; l++)
+    {
+        f->lanes[l].draining = 1;
+    }
+    fused_feed(f, 0);
+    fused_wait(f);
+    int ok = f->no_of_lanes > 0;
+    for (int l = 0; l < f->no_of_lanes; l++)
+    {
+        ok &= f->lanes[l].ok;
+    }
+    return ok;
+}
+
+void fused_close(fused_run *f)
+{
+    fused_wait(f);
+#if SIM_PTHREADS
+    if (f->threaded)
+    {
+        pthread_mutex_lock(&f->lock);
+        f->closing = 1;
+        pthread_cond_broadcast(&f->fed);
+        pthread_mutex_unlock(&f->lock);
+        for (int l = 0; l < f->no_of_lanes; l++)
+        {
+            if (f->started[l])
+            {
+                pthread_join(f->workers[l], NULL);
+            }
+        }
+        pthread_mutex_destroy(&f->lock);
+        pthread_cond_destroy(&f->fed);
+        pthread_cond_destroy(&f->done);
+    }
+#endif
+    for (int l = 0; l < f->no_of_lanes; l++)
+    {
+        stream_close(&f->lanes[l].e, &f->lanes[l].st);
+        sim_destroy(f->lanes[l].ctx);
+    }
+    free(f->batch);
+    free(f->filling);
+}
+
+// index of an objective name, -1 when unknown
+int tune_objective(const char *name)
+{
+    char *names[6] = {"art", "rt_p99", "awt", "wt_p99", "att", "tat_p99"};
+    for (int i = 0; i < 6; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// the candidate's prefix with its tickets scaled, for every run of a search
+void tune_prepare(tune_candidate *c)
+{
+    const tune_settings *settings = c->settings;
+    long long bursts = 0;
+    for (int i = 0; i < c->n; i++)
+    {
+        process *p = &c->rows[i];
+        *p = c->ps[i];
+        if (c->scaling != 0)
+        {
+            double tickets = process_tickets(p) * pow(settings->mean_bt / (p->bt > 0 ? p->bt : 1), c->scaling);
+            p->tickets[0] = 1;
+            p->tickets[1] = tickets < 1 ? 1 : tickets > 1000000 ? 1000000 : (int)(tickets + 0.5);
+        }
+        bursts += p->bt;
+    }
+    bursts /= TUNE_CHECKS;
+    c->span = bursts < 1 ? 1 : bursts > INT_MAX ? INT_MAX : (int)bursts;
+}
+
+// TUNE_OVER_BUDGET once the run switched more than the budget allows all its jobs, TUNE_DOMINATED
+// once the jobs it completed hold its objective above the threshold whatever the others do, 0 when
+// it may still win. Latencies are never negative : the jobs left can only raise a mean from what the
+// completed ones add to it, and a 99th percentile ends above the threshold once more than 1% of the
+// jobs already lie in histogram buckets wholly above it.
+int tune_hopeless(engine *e, const tune_probe *probe)
+{
+    const tune_settings *settings = probe->c->settings;
+    result *r = e->r;
+    if (settings->budget > 0 && r->context_switch > settings->budget * e->jobs)
+    {
+        return TUNE_OVER_BUDGET;
+    }
+    if (probe->threshold == HUGE_VAL)
+    {
+        return 0;
+    }
+
+    latency_stats *tails[6] = {NULL, &r->rt_stats, NULL, &r->wt_stats, NULL, &r->tat_stats};
+    latency_stats *means[6] = {&r->rt_stats, NULL, &r->wt_stats, NULL, &r->tat_stats, NULL};
+    latency_stats *stats = means[settings->objective];
+    if (stats != NULL)
+    {
+        return stats->mean * stats->count / e->jobs > probe->threshold ? TUNE_DOMINATED : 0;
+    }
+    stats = tails[settings->objective];
+    long long above = 0, rank = (long long)ceil(99.0 / 100 * e->jobs);
+    for (int i = HIST_BUCKETS - 1; i >= 0 && stats_bucket_lower(i) > probe->threshold + 1; i--)
+    {
+        above += stats->buckets[i];
+    }
+    return above > e->jobs - rank ? TUNE_DOMINATED : 0;
+}
+
+// simulate's loop for a tuning run, which checks every span of busy time whether it can still win
+// (the schedule stops at the end of a span as it does at an arrival, nothing changes but the checks)
+ENGINE_INLINE int tune_simulate(engine *e, const policy pol, const tune_probe *probe)
+{
+    int span = probe->c->span, next_check = span;
+    while (e->completed < e->jobs)
+    {
+        int limit = engine_next_arrival(e, pol);
+        if ((e->running != -1 || e->ready > 0) && limit - e->now > span)
+        {
+            limit = e->now + span; // an idle cpu waits for the arrival in one go
+        }
+        engine_advance(e, limit, pol, 0, 0, 0);
+        engine_admit(e, pol, 0, 0, 0);
+
+        if (probe->cuts && e->now >= next_check)
+        {
+            int cut = tune_hopeless(e, probe);
+            if (cut != TUNE_RAN)
+            {
+                return cut;
+            }
+            next_check = e->now > INT_MAX - span ? INT_MAX : e->now + span;
+        }
+        if (e->running == -1 && e->ready == 0 && engine_next_arrival(e, pol) == INT_MAX)
+        {
+            break;
+        }
+    }
+    return TUNE_RAN;
+}
+
+#define DEFINE_TUNE(name, POLICY)                    \
+    int name(engine *e, const tune_probe *probe)     \
+    {                                                \
+        return tune_simulate(e, POLICY, probe);      \
+    }
+
+DEFINE_TUNE(tune_rr, RR_POLICY)
+DEFINE_TUNE(tune_lottery, LOTTERY_POLICY)
+
+// one run of the candidate's prefix with the probe's quantum, the start routine of a probe's thread
+void *tune_run(void *arg)
+{
+    tune_probe *probe = arg;
+    tune_candidate *c = probe->c;
+    const tune_settings *settings = c->settings;
+    sim_context *ctx = probe->ctx;
+    result *r = &ctx->final_result[settings->algorithm];
+    engine e;
+
+    initialize_final_result(ctx->final_result);
+    sim_seed(ctx, settings->seed);
+    arena_reset(&ctx->memory);
+    probe->work = 0;
+    if (!engine_init(&e, ctx, c->rows, c->n, probe->quantum, policies[settings->algorithm]))
+    {
+        probe->cut = TUNE_FAILED;
+        probe->feasible = 0;
+        probe->value = HUGE_VAL;
+        return NULL;
+    }
+    series_begin(ctx, r, settings->algorithm);
+    probe->cut = settings->algorithm == LOTTERY_POLICY.algorithm ? tune_lottery(&e, probe) : tune_rr(&e, probe);
+    series_finish(r, e.now);
+    probe->work = e.completed;
+
+    double switches = r->tat_stats.count > 0 ? (1.0) * r->context_switch / r->tat_stats.count : 0;
+    latency_stats *tails[6] = {NULL, &r->rt_stats, NULL, &r->wt_stats, NULL, &r->tat_stats};
+    double means[6] = {r->art, 0, r->awt, 0, r->att, 0};
+    probe->feasible = probe->cut != TUNE_OVER_BUDGET && (settings->budget <= 0 || switches <= settings->budget);
+    if (probe->cut == TUNE_OVER_BUDGET)
+    {
+        probe->value = (1.0) * r->context_switch / e.jobs; // at least
+    }
+    else if (probe->cut == TUNE_DOMINATED)
+    {
+        probe->value = probe->threshold; // more than
+    }
+    else if (!probe->feasible)
+    {
+        probe->value = switches;
+    }
+    else
+    {
+        probe->value = tails[settings->objective] != NULL ? stats_percentile(tails[settings->objective], 99)
+                                                          : means[settings->objective];
+    }
+    return NULL;
+}
+
+// one run of the candidate's prefix with quantum, to its end. c->failed is set when it could not start.
+void tune_evaluate(tune_candidate *c, int quantum, int *feasible, double *value)
+{
+    tune_probe probe = {.c = c, .ctx = c->ctx[0], .quantum = quantum, .cuts = 0, .threshold = HUGE_VAL};
+    tune_run(&probe);
+    c->runs++;
+    c->work += probe.work;
+    c->failed |= probe.cut == TUNE_FAILED;
+    *feasible = probe.feasible;
+    *value = probe.value;
+}
+
+// the runs of a search step, at once with SIM_PTHREADS
+void tune_step(tune_probe *probes, int count)
+{
+#if SIM_PTHREADS
+    pthread_t workers[TUNE_PROBES];
+    int started[TUNE_PROBES] = {0};
+    // the first run goes on the search's own thread
+    for (int k = 1; k < count; k++)
+    {
+        started[k] = pthread_create(&workers[k], NULL, tune_run, &probes[k]) == 0;
+        if (!started[k])
+        {
+            tune_run(&probes[k]);
+        }
+    }
+    if (count > 0)
+    {
+        tune_run(&probes[0]);
+    }
+    for (int k = 1; k < count; k++)
+    {
+        if (started[k])
+        {
+            pthread_join(workers[k], NULL);
+        }
+    }
+#else
+    for (int k = 0; k < count; k++)
+    {
+        tune_run(&probes[k]);
+    }
+#endif
+}
+
+// a setting within the budget beats one over it, then the smaller value wins
+int tune_better(int feasible, double value, int other_feasible, double other_value)
+{
+    return feasible != other_feasible ? feasible > other_feasible : value < other_value;
+}
+
+// golden-section search over the candidate's bracket, the start routine of a candidate's thread.
+// Shorter quanta only switch more : once a quantum is over the budget, so is everything below it.
+void *tune_search(void *arg)
+{
+    tune_candidate *c = arg;
+    int quanta[TUNE_MAX_RUNS], feasible[TUNE_MAX_RUNS], cut[TUNE_MAX_RUNS];
+    double values[TUNE_MAX_RUNS], thresholds[TUNE_MAX_RUNS];
+    int runs = 0, best = -1;
+    c->runs = 0;
+    c->failed = 0;
+    tune_prepare(c);
+
+    int a = c->lo, b = c->hi;
+    while (runs + 2 <= TUNE_MAX_RUNS)
+    {
+        // two points dividing [a, b] in the golden ratio, or every point of a short bracket
+        int points[4], no_of_points = 0;
+        if (b - a > 3)
+        {
+            points[no_of_points++] = b - (int)((b - a) * 0.6180339887);
+            points[no_of_points++] = a + (int)((b - a) * 0.6180339887);
+        }
+        else
+        {
+            for (int q = a; q <= b; q++)
+            {
+                points[no_of_points++] = q;
+            }
+        }
+
+        int found[4];
+        for (int k = 0; k < no_of_points; k++)
+        {
+            found[k] = -1;
+            for (int j = 0; j < runs; j++)
+            {
+                found[k] = quanta[j] == points[k] ? j : found[k];
+            }
+        }
+
+        // the points not run yet run at once. Each stops once it can only end worse than the other
+        // golden-section point when that one ran before, worse than the best run so far otherwise.
+        tune_probe probes[TUNE_PROBES];
+        int no_of_probes = 0;
+        for (int k = 0; k < no_of_points; k++)
+        {
+            for (int j = runs; j < runs + no_of_probes; j++)
+            {
+                found[k] = quanta[j] == points[k] ? j : found[k];
+            }
+            if (found[k] == -1 && runs + no_of_probes < TUNE_MAX_RUNS)
+            {
+                int other = no_of_points == 2 ? found[1 - k] : -1;
+                int known = other != -1 && other < runs ? other : best;
+                found[k] = runs + no_of_probes;
+                quanta[found[k]] = points[k];
+                probes[no_of_probes] = (tune_probe){
+                    .c = c,
+                    .ctx = c->ctx[no_of_probes],
+                    .quantum = points[k],
+                    .cuts = 1,
+                    .threshold = known != -1 && feasible[known] ? values[known] : HUGE_VAL,
+                };
+                no_of_probes++;
+            }
+        }
+        tune_step(probes, no_of_probes);
+        for (int k = 0; k < no_of_probes; k++, runs++)
+        {
+            feasible[runs] = probes[k].feasible;
+            values[runs] = probes[k].value;
+            thresholds[runs] = probes[k].threshold;
+            cut[runs] = probes[k].cut;
+            c->runs++;
+            c->work += probes[k].work;
+            c->failed |= cut[runs] == TUNE_FAILED;
+            if (cut[runs] == TUNE_DOMINATED || cut[runs] == TUNE_FAILED)
+            {
+                continue; // worse than best
+            }
+            // runs stopped over the budget only know they switch too much, the longer quantum switches less
+            int ahead = best == -1 || (!feasible[runs] && !feasible[best] && (cut[runs] || cut[best])
+                                           ? quanta[runs] > quanta[best]
+                                           : tune_better(feasible[runs], values[runs], feasible[best], values[best]));
+            best = ahead ? runs : best;
+        }
+        if (c->failed || b - a <= 3 || found[0] == -1 || found[1] == -1)
+        {
+            break;
+        }
+
+        int low = found[0], high = found[1];
+        if (!feasible[high])
+        {
+            a = points[1] + 1;
+        }
+        else if (!feasible[low])
+        {
+            a = points[0] + 1;
+        }
+        else if (cut[low] == TUNE_DOMINATED || cut[high] == TUNE_DOMINATED)
+        {
+            // a run stopped early ends above its threshold : the other point wins when it is within
+            // it, otherwise both are worse than the best run and the minimum lies on the best run's side
+            int stopped = cut[low] == TUNE_DOMINATED ? low : high, other = stopped == low ? high : low;
+            int side = cut[other] != TUNE_DOMINATED && values[other] <= thresholds[stopped] ? other
+                       : quanta[best] < points[1]                                      ? low
+                                                                                       : high;
+            if (side == high)
+            {
+                a = points[0];
+            }
+            else
+            {
+                b = points[1];
+            }
+        }
+        else if (tune_better(feasible[high], values[high], feasible[low], values[low]))
+        {
+            a = points[0];
+        }
+        else
+        {
+            b = points[1];
+        }
+    }
+
+    // nothing keeps to the budget : the best run may have stopped, it runs to its end for its switches
+    if (!c->failed && best != -1 && cut[best] != TUNE_RAN)
+    {
+        tune_evaluate(c, quanta[best], &feasible[best], &values[best]);
+    }
+    c->quantum = best != -1 ? quanta[best] : c->lo;
+    c->feasible = best != -1 && feasible[best];
+    c->value = best != -1 ? values[best] : 0;
+    return NULL;
+}
+
+// 0 when the run could not start for lack of memory, r then keeps no completed jobs.
+// ps is only read, the outcome is left in ctx->state. With a cache a repeated run is read
+// back instead of simulated, unless the run is traced or its time series is wanted.
+int run_policy(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e))
+{
+    if (ctx->cache_dir[0] == '\0' || ctx->trace_enabled || ctx->track_series)
+    {
+        return run_fresh(ctx, ps, n, time_quantum, pol, run);
+    }
+
+    unsigned long long key = run_key(ctx, ps, n, time_quantum, pol);
+    if (cache_load(ctx, key, pol->algorithm, n))
+    {
+        ctx->cache_hits++;
+        return 1;
+    }
+    if (!run_fresh(ctx, ps, n, time_quantum, pol, run))
+    {
+        return 0;
+    }
+    ctx->cache_misses++;
+    cache_store(ctx, key, pol->algorithm, n);
+    return 1;
+}
+
+int run_fresh(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e))
+{
+    result *r = &ctx->final_result[pol->algorithm];
+    engine e;
+
+    if (pol->algorithm == FCFS_POLICY.algorithm && !ctx->trace_enabled && !ctx->track_series && !SIM_COUNTERS &&
+        !workload_has_io(ps, n) && !run_has_costs(ctx))
+    {
+        return fcfs_scan(ctx, ps, n);
+    }
+
+    // the previous run's memory is released here rather than when it ended, its outcome
+    // in ctx->state stays readable till now
+    arena_reset(&ctx->memory);
+    if (!engine_init(&e, ctx, ps, n, time_quantum, pol))
+    {
+        return 0;
+    }
+    series_begin(ctx, r, pol->algorithm);
+    trace_begin(ctx, pol->algorithm);
+
+    run(&e);
+
+    series_finish(r, e.now);
+    trace_end(&ctx->tracer);
+    r->throughput = e.now > 0 ? (1.0) * e.completed / e.now : 0;
+    ctx->state = e.state;
+    return 1;
+}
+
+// entry k of the ready queue in queue order, FIFO entries carry only the index
+queue_entry checkpoint_queued(engine *e, int queue, int k)
+{
+    if (queue == QUEUE_FIFO)
+    {
+        return (queue_entry){0, 0, e->fifo[(e->fifo_head + k) % e->n]};
+    }
+    return e->heap[k];
+}
+
+// appends a snapshot of e to its baseline, a snapshot that finds no memory is skipped
+// (what-if runs then resume a little earlier)
+void checkpoint_take(engine *e, int queue)
+{
+    sim_checkpoints *c = e->recording;
+    if (c->no_of_points == c->points_size)
+    {
+        int size = c->points_size > 0 ? 2 * c->points_size : 16;
+        checkpoint *points = realloc(c->points, size * sizeof(checkpoint));
+        if (points == NULL)
+        {
+            return;
+        }
+        c->points = points;
+        c->points_size = size;
+    }
+    if (c->no_of_entries + e->ready > c->entries_size)
+    {
+        int size = c->entries_size > 0 ? 2 * c->entries_size : 1024;
+        while (size < c->no_of_entries + e->ready)
+        {
+            size *= 2;
+        }
+        checkpoint_entry *entries = realloc(c->entries, size * sizeof(checkpoint_entry));
+        if (entries == NULL)
+        {
+            return;
+        }
+        c->entries = entries;
+        c->entries_size = size;
+    }
+
+    run_state *s = &e->state;
+    checkpoint *cp = &c->points[c->no_of_points++];
+    cp->now = e->now;
+    cp->running = e->running;
+    cp->slice_start = e->slice_start;
+    cp->slice_end = e->slice_end;
+    cp->previous = e->previous;
+    cp->seq = e->seq;
+    cp->next_order = e->next_order;
+    cp->completed = e->completed;
+    cp->ready = e->ready;
+    cp->first_entry = c->no_of_entries;
+    cp->running_remaining = e->running != -1 ? s->remaining[e->running] : 0;
+    cp->running_first_run = e->running != -1 ? s->first_run[e->running] : -1;
+    for (int k = 0; k < e->ready; k++)
+    {
+        queue_entry entry = checkpoint_queued(e, queue, k);
+        c->entries[c->no_of_entries++] = (checkpoint_entry){entry, s->remaining[entry.index], s->first_run[entry.index]};
+    }
+
+    cp->context_switch = e->r->context_switch;
+    cp->decisions = e->r->decisions;
+    cp->busy_time = e->r->busy_time;
+    const latency_stats *stats[3] = {&e->r->wt_stats, &e->r->tat_stats, &e->r->rt_stats};
+    for (int m = 0; m < 3; m++)
+    {
+        cp->stats[m] = (checkpoint_stats){stats[m]->count, stats[m]->mean, stats[m]->m2, stats[m]->min, stats[m]->max};
+    }
+}
+
+// 1 when the rest of the what-if run would repeat the baseline from cp on : the same process
+// on the cpu, the same ready queue (seq counted from the last entry queued) with the same
+// remaining times, and every changed process completed in both runs
+int checkpoint_matches(engine *e, int queue, const checkpoint *cp)
+{
+    const sim_checkpoints *c = e->baseline;
+    const run_state *s = &e->state;
+    if (e->running != cp->running || e->previous != cp->previous || e->next_order != cp->next_order ||
+        e->ready != cp->ready)
+    {
+        return 0;
+    }
+    if (e->running != -1 &&
+        (e->slice_start != cp->slice_start || e->slice_end != cp->slice_end ||
+         s->remaining[e->running] != cp->running_remaining || s->first_run[e->running] != cp->running_first_run))
+    {
+        return 0;
+    }
+    for (int k = 0; k < e->no_of_changed; k++)
+    {
+        int j = e->changed[k];
+        if (s->remaining[j] != 0 || c->ct[j] >= cp->now)
+        {
+            return 0;
+        }
+    }
+
+    const checkpoint_entry *entries = &c->entries[cp->first_entry];
+    for (int k = 0; k < e->ready; k++)
+    {
+        queue_entry entry = checkpoint_queued(e, queue, k);
+        const checkpoint_entry *saved = &entries[k];
+        if (entry.index != saved->entry.index || entry.key != saved->entry.key ||
+            entry.seq - e->seq != saved->entry.seq - cp->seq || s->remaining[entry.index] != saved->remaining ||
+            s->first_run[entry.index] != saved->first_run)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// puts a freshly initialized what-if engine where the baseline was at cp
+void checkpoint_restore(engine *e, int queue, const checkpoint *cp)
+{
+    const sim_checkpoints *c = e->baseline;
+    run_state *s = &e->state;
+    result *r = e->r;
+
+    e->now = cp->now;
+    e->running = cp->running;
+    e->slice_start = cp->slice_start;
+    e->slice_end = cp->slice_end;
+    e->previous = cp->previous;
+    e->seq = cp->seq;
+    e->next_order = cp->next_order;
+    e->completed = cp->completed;
+
+    // everything admitted by then has completed unless it is in flight
+    for (int k = 0; k < cp->next_order; k++)
+    {
+        s->remaining[e->order[k].index] = 0;
+    }
+    const checkpoint_entry *entries = &c->entries[cp->first_entry];
+    for (int k = 0; k < cp->ready; k++)
+    {
+        int i = entries[k].entry.index;
+        s->remaining[i] = entries[k].remaining;
+        s->first_run[i] = entries[k].first_run;
+        if (queue == QUEUE_FIFO)
+        {
+            e->fifo[k] = i;
+        }
+        else
+        {
+            e->heap[k] = entries[k].entry;
+        }
+    }
+    e->fifo_head = 0;
+    e->ready = cp->ready;
+    if (cp->running != -1)
+    {
+        s->remaining[cp->running] = cp->running_remaining;
+        s->first_run[cp->running] = cp->running_first_run;
+    }
+    for (int k = 0; k < cp->next_order; k++)
+    {
+        int i = e->order[k].index;
+        if (s->remaining[i] == 0)
+        {
+            s->ct[i] = c->ct[i];
+            s->wt[i] = c->wt[i];
+            s->tat[i] = c->tat[i];
+            s->rt[i] = c->rt[i];
+        }
+    }
+
+    r->context_switch = cp->context_switch;
+    r->decisions = cp->decisions;
+    r->busy_time = cp->busy_time;
+    // histograms : every job admitted by then, less the ones in flight
+    latency_stats *stats[3] = {&r->wt_stats, &r->tat_stats, &r->rt_stats};
+    const double *outcome[3] = {c->wt, c->tat, c->rt};
+    for (int m = 0; m < 3; m++)
+    {
+        stats_init(stats[m]);
+        stats[m]->count = cp->stats[m].count;
+        stats[m]->mean = cp->stats[m].mean;
+        stats[m]->m2 = cp->stats[m].m2;
+        stats[m]->min = cp->stats[m].min;
+        stats[m]->max = cp->stats[m].max;
+        for (int k = 0; k < cp->next_order; k++)
+        {
+            stats_bucket_add(stats[m], outcome[m][e->order[k].index], 1);
+        }
+        for (int j = -1; j < cp->ready; j++)
+        {
+            int i = j == -1 ? cp->running : entries[j].entry.index;
+            if (i != -1)
+            {
+                stats_bucket_add(stats[m], outcome[m][i], -1);
+            }
+        }
+    }
+    r->awt = r->wt_stats.mean;
+    r->att = r->tat_stats.mean;
+    r->art = r->rt_stats.mean;
+}
+
+// the what-if run matched the baseline at cp : every job still in flight or yet to come
+// completes as it did there, and the counts gain what the baseline did after cp
+void checkpoint_converge(engine *e, int queue, const checkpoint *cp)
+{
+    const sim_checkpoints *c = e->baseline;
+    run_state *s = &e->state;
+    result *r = e->r;
+
+    // the rest of the baseline : its moments are the final ones less the snapshot's,
+    // its histogram and extremes come from the jobs themselves below
+    latency_stats part, rest[3];
+    const latency_stats *final[3] = {&c->final.wt_stats, &c->final.tat_stats, &c->final.rt_stats};
+    for (int m = 0; m < 3; m++)
+    {
+        stats_init(&part);
+        part.count = cp->stats[m].count;
+        part.mean = cp->stats[m].mean;
+        part.m2 = cp->stats[m].m2;
+        stats_subtract(&rest[m], final[m], &part);
+        rest[m].min = HUGE_VAL;
+        rest[m].max = -HUGE_VAL;
+    }
+
+    // what is still to come, then what is in flight
+    int tail = e->n - e->next_order + e->ready + (e->running != -1);
+    for (int k = -(e->ready + 1); k < e->n - e->next_order; k++)
+    {
+        int i = k >= 0 ? e->order[e->next_order + k].index : k == -1 ? e->running : checkpoint_queued(e, queue, -k - 2).index;
+        if (i == -1)
+        {
+            continue;
+        }
+        s->ct[i] = c->ct[i];
+        s->wt[i] = c->wt[i];
+        s->tat[i] = c->tat[i];
+        s->rt[i] = c->rt[i];
+        double sample[3] = {c->wt[i], c->tat[i], c->rt[i]};
+        for (int m = 0; m < 3; m++)
+        {
+            stats_bucket_add(&rest[m], sample[m], 1);
+            rest[m].min = sample[m] < rest[m].min ? sample[m] : rest[m].min;
+            rest[m].max = sample[m] > rest[m].max ? sample[m] : rest[m].max;
+        }
+    }
+    e->completed += tail;
+
+    latency_stats *stats[3] = {&r->wt_stats, &r->tat_stats, &r->rt_stats};
+    for (int m = 0; m < 3; m++)
+    {
+        stats_merge(stats[m], &rest[m]);
+    }
+    r->awt = r->wt_stats.mean;
+    r->att = r->tat_stats.mean;
+    r->art = r->rt_stats.mean;
+    r->context_switch += c->final.context_switch - cp->context_switch;
+    r->decisions += c->final.decisions - cp->decisions;
+    r->busy_time += c->final.busy_time - cp->busy_time;
+
+    e->running = -1;
+    e->ready = 0;
+    e->converged_at = e->now;
+    e->now = c->end;
+}
+
+// simulates like run_fresh while c collects snapshots, then keeps the outcome in c. Periodic,
+// Lottery and FCFS runs take no snapshots : a periodic process is in flight for its whole life,
+// the lottery queue cannot be listed and the FCFS scan is cheaper than resuming the engine.
+// Snapshots do not hold the I/O device or the cost model either. What-if runs of those are full runs.
+int run_baseline(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e), sim_checkpoints *c)
+{
+    result *r = &ctx->final_result[pol->algorithm];
+
+    c->algorithm = pol->algorithm;
+    c->time_quantum = time_quantum;
+    c->n = n;
+    c->seed = ctx->seed;
+    if (pol->periodic || pol->queue == QUEUE_LOTTERY || pol->algorithm == FCFS_POLICY.algorithm ||
+        workload_has_io(ps, n) || run_has_costs(ctx))
+    {
+        if (!run_fresh(ctx, ps, n, time_quantum, pol, run))
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        engine e;
+        arena_reset(&ctx->memory);
+        if (!engine_init(&e, ctx, ps, n, time_quantum, pol))
+        {
+            return 0;
+        }
+        e.recording = c;
+        e.next_checkpoint = c->interval;
+
+        run(&e);
+
+        series_finish(r, e.now);
+        r->throughput = e.now > 0 ? (1.0) * e.completed / e.now : 0;
+        ctx->state = e.state;
+    }
+
+    c->final = *r;
+    c->end = r->busy_time + r->overhead_time + r->idle_time;
+    if (n > 0)
+    {
+        memcpy(c->ct, ctx->state.ct, n * sizeof(int));
+        memcpy(c->wt, ctx->state.wt, n * sizeof(double));
+        memcpy(c->tat, ctx->state.tat, n * sizeof(double));
+        memcpy(c->rt, ctx->state.rt, n * sizeof(double));
+    }
+    return 1;
+}
+
+// runs the baseline's policy over ps, a changed copy of its workload : from the last snapshot
+// before the first change up to the first snapshot the run matches again. Without snapshots,
+// or when ps has another no. of processes, it is a full run.
+int run_whatif(sim_context *ctx, const process *ps, int n, const sim_checkpoints *c, sim_whatif_info *info)
+{
+    const policy *pol = policies[c->algorithm];
+    result *r = &ctx->final_result[c->algorithm];
+
+    info->changed = -1;
+    info->resumed_at = 0;
+    info->converged_at = -1;
+    if (n != c->n || c->no_of_points == 0 || workload_has_io(ps, n) || run_has_costs(ctx))
+    {
+        ctx->seed = c->seed; // Lottery draws what the baseline drew
+        return run_fresh(ctx, ps, n, c->time_quantum, pol, simulators[c->algorithm]);
+    }
+
+    arena_reset(&ctx->memory);
+    int *changed = arena_alloc(&ctx->memory, (n > 0 ? n : 1) * sizeof(int));
+    if (changed == NULL)
+    {
+        return 0;
+    }
+
+    // a change counts from the earlier of the old and the new arrival of the process
+    int no_of_changed = 0, first_change = INT_MAX;
+    for (int i = 0; i < n; i++)
+    {
+        const process *p = &ps[i], *q = &c->ps[i];
+        if (p->at != q->at || p->bt != q->bt || p->priority != q->priority || process_tickets(p) != process_tickets(q) ||
+            p->period != q->period || p->no_of_execution != q->no_of_execution || p->quantum != q->quantum ||
+            p->cpu_burst != q->cpu_burst || p->io_wait != q->io_wait)
+        {
+            changed[no_of_changed++] = i;
+            int from = p->at < q->at ? p->at : q->at;
+            first_change = from < first_change ? from : first_change;
+        }
+    }
+    info->changed = no_of_changed;
+
+    engine e;
+    if (!engine_init(&e, ctx, ps, n, c->time_quantum, pol))
+    {
+        return 0;
+    }
+    e.baseline = c;
+    e.changed = changed;
+    e.no_of_changed = no_of_changed;
+
+    // last snapshot strictly before the first change, the ones after it are only matched
+    int low = 0, high = c->no_of_points;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (c->points[mid].now < first_change)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if (low > 0)
+    {
+        checkpoint_restore(&e, pol->queue, &c->points[low - 1]);
+        info->resumed_at = c->points[low - 1].now;
+    }
+    e.next_checkpoint = low;
+
+    simulators[c->algorithm](&e);
+
+    series_finish(r, e.now);
+    r->throughput = e.now > 0 ? (1.0) * e.completed / e.now : 0;
+    ctx->state = e.state;
+    info->converged_at = e.converged_at;
+    return 1;
+}
+
+void sim_checkpoints_free(sim_checkpoints *baseline)
+{
+    if (baseline == NULL)
+    {
+        return;
+    }
+    free(baseline->ps);
+    free(baseline->ct);
+    free(baseline->wt);
+    free(baseline->tat);
+    free(baseline->rt);
+    free(baseline->points);
+    free(baseline->entries);
+    free(baseline);
+}
+
+// 64-bit hash of everything a run's outcome depends on : every column of ps, the policy, the
+// quantum (policies that use it), the seed (Lottery) and SIM_VERSION_TAG
+unsigned long long run_key(sim_context *ctx, const process *ps, int n, int time_quantum, const policy *pol)
+{
+    unsigned long long h = 0x9E3779B97F4A7C15ULL;
+#define KEY_MIX(v) (h = ((h ^ (unsigned long long)(v)) * 0xFF51AFD7ED558CCDULL), h ^= h >> 29, h = (h << 17) | (h >> 47))
+    KEY_MIX(n);
+    KEY_MIX(pol->algorithm);
+    KEY_MIX(pol->uses_quantum ? (time_quantum > 0 ? time_quantum : 1) : 0);
+    KEY_MIX(pol->algorithm == LOTTERY_POLICY.algorithm ? ctx->seed : 0);
+    KEY_MIX(((unsigned long long)(unsigned)ctx->switch_cost << 32) | (unsigned)ctx->warmup_cost);
+    KEY_MIX(ctx->warmup_time);
+    for (const char *c = SIM_VERSION_TAG; *c != '\0'; c++)
+    {
+        KEY_MIX(*c);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        const process *p = &ps[i];
+        KEY_MIX(((unsigned long long)(unsigned)p->id << 32) | (unsigned)p->at);
+        KEY_MIX(((unsigned long long)(unsigned)p->bt << 32) | (unsigned)p->priority);
+        KEY_MIX(((unsigned long long)(unsigned)process_tickets(p) << 32) | (unsigned)p->period);
+        // a process without a quantum of its own keys as it did before weighted RR
+        KEY_MIX(((unsigned long long)(unsigned)(pol->uses_quantum ? p->quantum : 0) << 32) | (unsigned)p->no_of_execution);
+        KEY_MIX(((unsigned long long)(unsigned)p->cpu_burst << 32) | (unsigned)p->io_wait);
+    }
+#undef KEY_MIX
+    // splitmix64 finalizer, every input bit reaches every output bit
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+void cache_path(sim_context *ctx, unsigned long long key, char *path, int size)
+{
+    snprintf(path, size, "%s/%016llx.res", ctx->cache_dir, key);
+}
+
+// 1 and final_result / ctx->state filled when an entry for key exists and was written by
+// this SIM_VERSION_TAG, 0 otherwise (the run then has to be simulated)
+int cache_load(sim_context *ctx, unsigned long long key, int algorithm, int n)
+{
+    char path[300];
+    cache_path(ctx, key, path, sizeof(path));
+    FILE *fptr = fopen(path, "rb");
+    if (fptr == NULL)
+    {
+        return 0;
+    }
+
+    cache_header header;
+    cache_result saved;
+    int found = fread(&header, sizeof(header), 1, fptr) == 1 && memcmp(header.magic, CACHE_MAGIC, 8) == 0 &&
+                strncmp(header.version, SIM_VERSION_TAG, sizeof(header.version)) == 0 && header.key == key &&
+                header.algorithm == algorithm && header.n == n && fread(&saved, sizeof(saved), 1, fptr) == 1;
+    // an entry without outputs cannot answer a run whose outputs are wanted
+    if (found && !header.has_outputs && ctx->cache_outputs)
+    {
+        found = 0;
+    }
+
+    run_state *s = &ctx->state;
+    if (found)
+    {
+        arena_reset(&ctx->memory);
+        *s = (run_state){0};
+        if (header.has_outputs && n > 0)
+        {
+            s->ct = arena_alloc(&ctx->memory, n * sizeof(int));
+            s->wt = arena_alloc(&ctx->memory, n * sizeof(double));
+            s->tat = arena_alloc(&ctx->memory, n * sizeof(double));
+            s->rt = arena_alloc(&ctx->memory, n * sizeof(double));
+            found = s->ct != NULL && s->wt != NULL && s->tat != NULL && s->rt != NULL &&
+                    fread(s->ct, sizeof(int), n, fptr) == (size_t)n &&
+                    fread(s->wt, sizeof(double), n, fptr) == (size_t)n &&
+                    fread(s->tat, sizeof(double), n, fptr) == (size_t)n &&
+                    fread(s->rt, sizeof(double), n, fptr) == (size_t)n;
+        }
+    }
+    fclose(fptr);
+    if (!found)
+    {
+        *s = (run_state){0};
+        return 0;
+    }
+
+    result *r = &ctx->final_result[algorithm];
+    r->awt = saved.awt;
+    r->att = saved.att;
+    r->art = saved.art;
+    r->context_switch = saved.context_switch;
+    r->throughput = saved.throughput;
+    r->decisions = saved.decisions;
+    r->wt_stats = saved.wt_stats;
+    r->tat_stats = saved.tat_stats;
+    r->rt_stats = saved.rt_stats;
+    r->busy_time = saved.busy_time;
+    r->idle_time = saved.idle_time;
+    r->cpu_utilization = saved.cpu_utilization;
+    r->burst_stats = saved.burst_stats;
+    r->io_busy = saved.io_busy;
+    r->io_utilization = saved.io_utilization;
+    r->overhead_time = saved.overhead_time;
+    r->overhead_share = saved.overhead_share;
+    r->series.tracked = 0;
+    r->series.count = 0;
+    ctx->seed = header.seed; // the generator continues as if the run had drawn from it
+    return 1;
+}
+
+// writes the run just simulated under key, a failed write only costs the next run a miss.
+// The entry goes to a file of its own first and is renamed into place when complete, so a
+// reader never sees half an entry.
+void cache_store(sim_context *ctx, unsigned long long key, int algorithm, int n)
+{
+    run_state *s = &ctx->state;
+    result *r = &ctx->final_result[algorithm];
+
+    cache_header header = {0};
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    strncpy(header.version, SIM_VERSION_TAG, sizeof(header.version) - 1);
+    header.key = key;
+    header.algorithm = algorithm;
+    header.n = n;
+    header.has_outputs = ctx->cache_outputs && s->ct != NULL;
+    header.seed = ctx->seed;
+
+    cache_result saved = {0};
+    saved.awt = r->awt;
+    saved.att = r->att;
+    saved.art = r->art;
+    saved.context_switch = r->context_switch;
+    saved.throughput = r->throughput;
+    saved.decisions = r->decisions;
+    saved.wt_stats = r->wt_stats;
+    saved.tat_stats = r->tat_stats;
+    saved.rt_stats = r->rt_stats;
+    saved.busy_time = r->busy_time;
+    saved.idle_time = r->idle_time;
+    saved.cpu_utilization = r->cpu_utilization;
+    saved.burst_stats = r->burst_stats;
+    saved.io_busy = r->io_busy;
+    saved.io_utilization = r->io_utilization;
+    saved.overhead_time = r->overhead_time;
+    saved.overhead_share = r->overhead_share;
+
+    char path[300], temporary[320];
+    cache_path(ctx, key, path, sizeof(path));
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int)getpid());
+    FILE *fptr = fopen(temporary, "wb");
+    if (fptr == NULL)
+    {
+        return;
+    }
+    int written = fwrite(&header, sizeof(header), 1, fptr) == 1 && fwrite(&saved, sizeof(saved), 1, fptr) == 1;
+    if (written && header.has_outputs && n > 0)
+    {
+        written = fwrite(s->ct, sizeof(int), n, fptr) == (size_t)n &&
+                  fwrite(s->wt, sizeof(double), n, fptr) == (size_t)n &&
+                  fwrite(s->tat, sizeof(double), n, fptr) == (size_t)n &&
+                  fwrite(s->rt, sizeof(double), n, fptr) == (size_t)n;
+    }
+    if (fclose(fptr) != 0 || !written)
+    {
+        remove(temporary);
+        return;
+    }
+#ifdef _WIN32
+    remove(path); // rename does not replace an existing file there
+#endif
+    if (rename(temporary, path) != 0)
+    {
+        remove(temporary);
+    }
+}
+
+// runs a policy over ps and copies the outcome into its ct / wt / tat / rt for the display
+// functions, the other fields are left as they were so ps can go through the next policy as is
+void run_records(sim_context *ctx, process *ps, int n, int time_quantum, const policy *pol, void (*run)(engine *e))
+{
+    run_state *s = &ctx->state;
+    if (!run_policy(ctx, ps, n, time_quantum, pol, run) || s->ct == NULL)
+    {
+        return; // s->ct is NULL after a cache hit on an entry without outputs
+    }
+    for (int i = 0; i < n; i++)
+    {
+        ps[i].ct = s->ct[i];
+        ps[i].wt = s->wt[i];
+        ps[i].tat = s->tat[i];
+        ps[i].rt = s->rt[i];
+    }
+}
+
+void scan_fold(scan_chunk *c)
+{
+    long long a = 0, b = 0; // arrivals are never negative, starting at 0 is starting at -infinity
+    for (int k = c->first; k < c->last; k++)
+    {
+        const process *p = &c->ps[c->order != NULL ? c->order[k].index : k];
+        a += p->bt;
+        b = (b > p->at ? b : p->at) + p->bt;
+    }
+    c->a = a;
+    c->b = b;
+}
+
+void scan_fill(scan_chunk *c)
+{
+    run_state *s = c->state;
+    long long t = c->carry;
+    stats_init(&c->wt_stats);
+    stats_init(&c->tat_stats);
+    stats_init(&c->rt_stats);
+    for (int k = c->first; k < c->last; k++)
+    {
+        int i = c->order != NULL ? c->order[k].index : k;
+        const process *p = &c->ps[i];
+        t = (t > p->at ? t : p->at) + p->bt;
+        double tat = t - p->at;
+        double wt = tat - p->bt;
+        s->ct[i] = (int)t;
+        s->tat[i] = tat;
+        s->wt[i] = wt;
+        s->rt[i] = wt; // a job runs to completion once started
+        stats_add(&c->wt_stats, wt);
+        stats_add(&c->tat_stats, tat);
+        stats_add(&c->rt_stats, wt);
+    }
+}
+
+#if SIM_PTHREADS
+void *scan_worker(void *arg)
+{
+    scan_chunk *c = arg;
+    if (c->fill)
+    {
+        scan_fill(c);
+    }
+    else
+    {
+        scan_fold(c);
+    }
+    return NULL;
+}
+#endif
+
+// runs fold (fill 0) or fill (fill 1) on every chunk, chunk 0 on the calling thread
+void scan_phase(scan_chunk *chunks, int no_of_chunks, int fill)
+{
+#if SIM_PTHREADS
+    pthread_t threads[MAX_SCAN_THREADS];
+    int started[MAX_SCAN_THREADS] = {0};
+    for (int t = 1; t < no_of_chunks; t++)
+    {
+        chunks[t].fill = fill;
+        started[t] = pthread_create(&threads[t], NULL, scan_worker, &chunks[t]) == 0;
+        if (!started[t])
+        {
+            scan_worker(&chunks[t]); // no thread to spare, the work still has to be done
+        }
+    }
+    chunks[0].fill = fill;
+    scan_worker(&chunks[0]);
+    for (int t = 1; t < no_of_chunks; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(threads[t], NULL);
+        }
+    }
+#else
+    for (int t = 0; t < no_of_chunks; t++)
+    {
+        if (fill)
+        {
+            scan_fill(&chunks[t]);
+        }
+        else
+        {
+            scan_fold(&chunks[t]);
+        }
+    }
+#endif
+}
+
+// FCFS without the event loop, same outcome and statistics as simulate_fcfs (merged per
+// chunk when there are several), 0 when the memory for the run could not be allocated
+int fcfs_scan(sim_context *ctx, const process *ps, int n)
+{
+    result *r = &ctx->final_result[FCFS_POLICY.algorithm];
+    arena *memory = &ctx->memory;
+    size_t size = n > 0 ? n : 1;
+
+    arena_reset(memory);
+    run_state *s = &ctx->state;
+    *s = (run_state){0};
+    s->ct = arena_alloc(memory, size * sizeof(int));
+    s->wt = arena_alloc(memory, size * sizeof(double));
+    s->tat = arena_alloc(memory, size * sizeof(double));
+    s->rt = arena_alloc(memory, size * sizeof(double));
+    if (s->ct == NULL || s->wt == NULL || s->tat == NULL || s->rt == NULL)
+    {
+        return 0;
+    }
+
+    // ties keep the index order, as in the engine
+    queue_entry *order = NULL;
+    long long busy = 0;
+    for (int i = 0; i < n; i++)
+    {
+        busy += ps[i].bt;
+        if (i > 0 && ps[i].at < ps[i - 1].at && order == NULL)
+        {
+            order = arena_alloc(memory, size * sizeof(queue_entry));
+            if (order == NULL)
+            {
+                return 0;
+            }
+        }
+    }
+    if (order != NULL)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            order[i] = (queue_entry){ps[i].at, i, i};
+        }
+        qsort(order, n, sizeof(queue_entry), compare_entry);
+    }
+
+    int no_of_chunks = 1;
+#if SIM_PTHREADS
+    no_of_chunks = ctx->threads < MAX_SCAN_THREADS ? ctx->threads : MAX_SCAN_THREADS;
+    if (no_of_chunks > n / SCAN_MIN_CHUNK)
+    {
+        no_of_chunks = n / SCAN_MIN_CHUNK > 0 ? n / SCAN_MIN_CHUNK : 1;
+    }
+#endif
+    scan_chunk *chunks = arena_alloc(memory, no_of_chunks * sizeof(scan_chunk));
+    if (chunks == NULL)
+    {
+        return 0;
+    }
+    for (int t = 0; t < no_of_chunks; t++)
+    {
+        scan_chunk *c = &chunks[t];
+        c->ps = ps;
+        c->order = order;
+        c->state = s;
+        c->first = (int)((long long)n * t / no_of_chunks);
+        c->last = (int)((long long)n * (t + 1) / no_of_chunks);
+    }
+
+    // every chunk starts after the completion the chunks before it compose to
+    if (no_of_chunks > 1)
+    {
+        scan_phase(chunks, no_of_chunks, 0);
+    }
+    long long carry = 0;
+    for (int t = 0; t < no_of_chunks; t++)
+    {
+        chunks[t].carry = carry;
+        if (t + 1 < no_of_chunks)
+        {
+            carry = carry + chunks[t].a > chunks[t].b ? carry + chunks[t].a : chunks[t].b;
+        }
+    }
+    scan_phase(chunks, no_of_chunks, 1);
+
+    stats_init(&r->wt_stats);
+    stats_init(&r->tat_stats);
+    stats_init(&r->rt_stats);
+    for (int t = 0; t < no_of_chunks; t++)
+    {
+        stats_merge(&r->wt_stats, &chunks[t].wt_stats);
+        stats_merge(&r->tat_stats, &chunks[t].tat_stats);
+        stats_merge(&r->rt_stats, &chunks[t].rt_stats);
+    }
+    r->awt = r->wt_stats.mean;
+    r->att = r->tat_stats.mean;
+    r->art = r->rt_stats.mean;
+
+    // every job is one decision and, but for the first, one context-switch
+    int end = 0;
+    if (n > 0)
+    {
+        end = s->ct[order != NULL ? order[n - 1].index : n - 1];
+    }
+    r->decisions = n;
+    r->context_switch = n > 1 ? n - 1 : 0;
+    r->busy_time = (int)busy;
+    r->idle_time = end - r->busy_time;
+    r->cpu_utilization = end > 0 ? (1.0) * r->busy_time / end : 0;
+    r->throughput = end > 0 ? (1.0) * n / end : 0;
+    r->series.tracked = 0;
+    r->series.count = 0;
+    return 1;
+}
+
+void round_robin(sim_context *ctx, process *ps, int time_quantum, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, time_quantum, &RR_POLICY, simulate_rr);
+}
+
+void priority_scheduling(sim_context *ctx, process *ps, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, 0, &PRIORITY_POLICY, simulate_priority);
+}
+
+void lottery_scheduling(sim_context *ctx, process *ps, int time_quantum, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, time_quantum, &LOTTERY_POLICY, simulate_lottery);
+}
+
+void fcfs_scheduling(sim_context *ctx, process *ps, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, 0, &FCFS_POLICY, simulate_fcfs);
+}
+
+void sjf_scheduling(sim_context *ctx, process *ps, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, 0, &SJF_POLICY, simulate_sjf);
+}
+
+void srtn_scheduling(sim_context *ctx, process *ps, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, 0, &SRTN_POLICY, simulate_srtn);
+}
+
+void hrrn_scheduling(sim_context *ctx, process *ps, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, 0, &HRRN_POLICY, simulate_hrrn);
+}
+
+// every EDF task releases its first job at 0, the deadlines follow from the periods
+void set_EDF_AT(process *ps, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        ps[i].at = 0;
+    }
+}
+
+void edf_scheduling(sim_context *ctx, process *ps, int no_of_process)
+{
+    run_records(ctx, ps, no_of_process, 0, &EDF_POLICY, simulate_edf);
+}
+
+void run_algorithm(sim_context *ctx, int algorithm, process *ps, int n, int time_quantum)
+{
+    switch (algorithm)
+    {
+    case 0:
+        round_robin(ctx, ps, time_quantum, n);
+        break;
+    case 1:
+        priority_scheduling(ctx, ps, n);
+        break;
+    case 2:
+        lottery_scheduling(ctx, ps, time_quantum, n);
+        break;
+    case 3:
+        fcfs_scheduling(ctx, ps, n);
+        break;
+    case 4:
+        sjf_scheduling(ctx, ps, n);
+        break;
+    case 5:
+        srtn_scheduling(ctx, ps, n);
+        break;
+    case 6:
+        hrrn_scheduling(ctx, ps, n);
+        break;
+    case 7:
+        edf_scheduling(ctx, ps, n);
+        break;
+    }
+}
+
+// 1 when a and b are the same columns (not only the same values)
+int same_columns(const sim_workload *a, const sim_workload *b)
+{
+    return a->n == b->n && a->id == b->id && a->at == b->at && a->bt == b->bt && a->priority == b->priority &&
+           a->tickets == b->tickets && a->period == b->period && a->executions == b->executions &&
+           a->quantum == b->quantum && a->cpu_burst == b->cpu_burst && a->io_wait == b->io_wait;
+}
+
+// turns the caller's columns into the context's process records,
+// the no. of processes or a SIM_ERROR_ code
+int load_columns(sim_context *ctx, const sim_workload *w)
+{
+    int n = w->n;
+    if (n < 0 || (n > 0 && (w->at == NULL || w->bt == NULL)))
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    if (n > 0 && same_columns(w, &ctx->loaded))
+    {
+        return n; // runs only read the records
+    }
+    ctx->loaded = (sim_workload){0};
+    if (n > ctx->rows_size)
+    {
+        free(ctx->rows);
+        ctx->rows = malloc(n * sizeof(process));
+        ctx->rows_size = ctx->rows != NULL ? n : 0;
+        if (ctx->rows == NULL)
+        {
+            return SIM_ERROR_MEMORY;
+        }
+    }
+
+    process *ps = ctx->rows;
+    int ticket = 1;
+    for (int i = 0; i < n; i++)
+    {
+        process *p = &ps[i];
+        p->id = w->id != NULL ? w->id[i] : i + 1;
+        p->at = w->at[i];
+        p->bt = w->bt[i];
+        p->priority = w->priority != NULL ? w->priority[i] : 1;
+        p->period = w->period != NULL ? w->period[i] : p->bt;
+        p->no_of_execution = w->executions != NULL ? w->executions[i] : 1;
+        p->quantum = w->quantum != NULL && w->quantum[i] > 0 ? w->quantum[i] : 0;
+        p->cpu_burst = w->cpu_burst != NULL ? w->cpu_burst[i] : 0;
+        p->io_wait = w->io_wait != NULL ? w->io_wait[i] : 0;
+
+        int tickets = w->tickets != NULL ? w->tickets[i] : 1;
+        if (p->at < 0 || p->bt <= 0 || tickets <= 0 || p->period <= 0 || p->no_of_execution <= 0 || p->cpu_burst < 0 ||
+            p->io_wait < 0)
+        {
+            return SIM_ERROR_ARGUMENT;
+        }
+        if (tickets > INT_MAX - ticket)
+        {
+            return SIM_ERROR_ARGUMENT; // Lottery numbers the tickets with an int
+        }
+        p->tickets[0] = ticket;
+        p->tickets[1] = ticket + tickets - 1;
+        ticket += tickets;
+
+        p->ct = 0;
+        p->wt = 0;
+        p->tat = 0;
+        p->rt = -1;
+    }
+    ctx->loaded = *w;
+    return n;
+}
+
+void sim_reload(sim_context *ctx)
+{
+    ctx->loaded = (sim_workload){0};
+}
+
+int sim_run(sim_context *ctx, const sim_workload *w, const sim_params *params, sim_output *out)
+{
+    if (ctx == NULL || w == NULL || params == NULL || out == NULL || params->algorithm < 0 || params->algorithm > 7)
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    int n = load_columns(ctx, w);
+    if (n < 0)
+    {
+        return n;
+    }
+
+    int algorithm = params->algorithm;
+    initialize_final_result(ctx->final_result);
+
+    // windows have no place in sim_output, so library runs never track them
+    int track_series = ctx->track_series;
+    ctx->track_series = 0;
+    int started = run_policy(ctx, ctx->rows, n, params->time_quantum, policies[algorithm], simulators[algorithm]);
+    ctx->track_series = track_series;
+    if (!started)
+    {
+        return SIM_ERROR_MEMORY;
+    }
+    write_output(ctx, algorithm, n, out);
+    return SIM_OK;
+}
+
+// Runs like sim_run and keeps, besides the outcome, snapshots of the run every interval arrivals
+// (0 : a default that gives a few hundred). sim_run_whatif then answers changed copies of the
+// workload from the snapshots instead of from time 0.
+int sim_run_baseline(sim_context *ctx, const sim_workload *w, const sim_params *params, int interval,
+                     sim_checkpoints **baseline, sim_output *out)
+{
+    if (ctx == NULL || w == NULL || params == NULL || baseline == NULL || out == NULL || params->algorithm < 0 ||
+        params->algorithm > 7)
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    *baseline = NULL;
+    int n = load_columns(ctx, w);
+    if (n < 0)
+    {
+        return n;
+    }
+
+    size_t size = n > 0 ? n : 1;
+    sim_checkpoints *c = calloc(1, sizeof(sim_checkpoints));
+    if (c == NULL)
+    {
+        return SIM_ERROR_MEMORY;
+    }
+    c->ps = malloc(size * sizeof(process));
+    c->ct = malloc(size * sizeof(int));
+    c->wt = malloc(size * sizeof(double));
+    c->tat = malloc(size * sizeof(double));
+    c->rt = malloc(size * sizeof(double));
+    if (c->ps == NULL || c->ct == NULL || c->wt == NULL || c->tat == NULL || c->rt == NULL)
+    {
+        sim_checkpoints_free(c);
+        return SIM_ERROR_MEMORY;
+    }
+    memcpy(c->ps, ctx->rows, n * sizeof(process));
+    c->interval = interval;
+    if (interval <= 0)
+    {
+        c->interval = n / CHECKPOINTS_DEFAULT > CHECKPOINT_MIN_INTERVAL ? n / CHECKPOINTS_DEFAULT : CHECKPOINT_MIN_INTERVAL;
+    }
+
+    int algorithm = params->algorithm;
+    initialize_final_result(ctx->final_result);
+    int track_series = ctx->track_series;
+    ctx->track_series = 0;
+    int started = run_baseline(ctx, c->ps, n, params->time_quantum, policies[algorithm], simulators[algorithm], c);
+    ctx->track_series = track_series;
+    if (!started)
+    {
+        sim_checkpoints_free(c);
+        return SIM_ERROR_MEMORY;
+    }
+    write_output(ctx, algorithm, n, out);
+    *baseline = c;
+    return SIM_OK;
+}
+
+// the baseline's policy and quantum over w, a copy of the baseline workload with some processes
+// changed. The outcome is the one sim_run would give. info (NULL : not wanted) tells how much of
+// the run was simulated.
+int sim_run_whatif(sim_context *ctx, const sim_checkpoints *baseline, const sim_workload *w, sim_output *out,
+                   sim_whatif_info *info)
+{
+    if (ctx == NULL || baseline == NULL || w == NULL || out == NULL)
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    int n = load_columns(ctx, w);
+    if (n < 0)
+    {
+        return n;
+    }
+
+    sim_whatif_info ignored;
+    initialize_final_result(ctx->final_result);
+    int track_series = ctx->track_series;
+    ctx->track_series = 0;
+    int started = run_whatif(ctx, ctx->rows, n, baseline, info != NULL ? info : &ignored);
+    ctx->track_series = track_series;
+    if (!started)
+    {
+        return SIM_ERROR_MEMORY;
+    }
+    write_output(ctx, baseline->algorithm, n, out);
+    return SIM_OK;
+}
+
+// copies the outcome of the last run of the context into the caller's arrays and summary
+void write_output(sim_context *ctx, int algorithm, int n, sim_output *out)
+{
+    result *r = &ctx->final_result[algorithm];
+
+    // the outputs are missing after a cache hit on an entry that only kept the summary
+    run_state *state = &ctx->state;
+    if (n > 0 && state->ct != NULL)
+    {
+        if (out->ct != NULL)
+        {
+            memcpy(out->ct, state->ct, n * sizeof(int));
+        }
+        if (out->wt != NULL)
+        {
+            memcpy(out->wt, state->wt, n * sizeof(double));
+        }
+        if (out->tat != NULL)
+        {
+            memcpy(out->tat, state->tat, n * sizeof(double));
+        }
+        if (out->rt != NULL)
+        {
+            memcpy(out->rt, state->rt, n * sizeof(double));
+        }
+    }
+
+    sim_summary *s = &out->summary;
+    s->completed = (int)r->tat_stats.count;
+    s->makespan = r->busy_time + r->overhead_time + r->idle_time; // a run ends with its last completion
+    s->awt = r->awt;
+    s->att = r->att;
+    s->art = r->art;
+    s->wt_p95 = stats_percentile(&r->wt_stats, 95);
+    s->tat_p95 = stats_percentile(&r->tat_stats, 95);
+    s->rt_p95 = stats_percentile(&r->rt_stats, 95);
+    s->context_switch = r->context_switch;
+    s->decisions = r->decisions;
+    s->throughput = r->throughput;
+    s->cpu_utilization = r->cpu_utilization;
+    s->io_utilization = r->io_utilization;
+    s->burst_wait = r->burst_stats.mean;
+    s->burst_wait_p95 = stats_percentile(&r->burst_stats, 95);
+    s->overhead_time = r->overhead_time;
+    s->overhead_share = r->overhead_share;
+}
+
+const char *sim_policy_name(int algorithm)
+{
+    return algorithm >= 0 && algorithm < 8 ? algorithm_names[algorithm] : NULL;
+}
+
+// Fits arrival rate and burst moments to ps and evaluates M/G/1 FCFS, processor sharing and
+// SRPT, 0 when the memory for the sorted bursts could not be allocated
+int estimate_workload(sim_context *ctx, const process *ps, int n, sim_estimate *est)
+{
+    *est = (sim_estimate){0};
+    est->stable = 1;
+    if (n == 0)
+    {
+        return 1;
+    }
+
+    int first = ps[0].at, last = ps[0].at;
+    double sum = 0, sum2 = 0;
+    for (int i = 0; i < n; i++)
+    {
+        first = ps[i].at < first ? ps[i].at : first;
+        last = ps[i].at > last ? ps[i].at : last;
+        sum += ps[i].bt;
+        sum2 += (double)ps[i].bt * ps[i].bt;
+    }
+    // n arrivals over the observed span are n - 1 inter-arrival gaps
+    double lambda = last > first ? (n - 1.0) / (last - first) : (n > 1 ? INFINITY : 0);
+    double es = sum / n, es2 = sum2 / n;
+    double rho = lambda * es;
+    est->arrival_rate = lambda;
+    est->mean_burst = es;
+    est->burst_moment2 = es2;
+    est->utilization = rho;
+    if (!(rho < 1))
+    {
+        est->stable = 0;
+        est->fcfs_wt = est->fcfs_tat = est->ps_wt = est->ps_tat = est->srpt_wt = est->srpt_tat = INFINITY;
+        return 1;
+    }
+
+    // Pollaczek-Khinchine : W = lambda E[S^2] / 2 (1 - rho)
+    est->fcfs_wt = lambda * es2 / (2 * (1 - rho));
+    est->fcfs_tat = est->fcfs_wt + es;
+
+    // processor sharing : T = E[S] / (1 - rho), independent of the burst distribution beyond its mean
+    est->ps_tat = es / (1 - rho);
+    est->ps_wt = est->ps_tat - es;
+
+    // SRPT, for a job of size x with load rho(x) = lambda * sum of the sizes <= x / n :
+    // T(x) = lambda (E[S^2 ; S <= x] + x^2 P(S > x)) / 2 (1 - rho(x))^2 + integral over [0, x] of dt / (1 - rho(t)),
+    // evaluated once per distinct size of the sorted bursts
+    arena_reset(&ctx->memory);
+    int *bursts = arena_alloc(&ctx->memory, n * sizeof(int));
+    if (bursts == NULL)
+    {
+        return 0;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        bursts[i] = ps[i].bt;
+    }
+    qsort(bursts, n, sizeof(int), compare_int);
+
+    double below = 0;     // rho(t) for t just below the current size
+    double m2_upto = 0;   // E[S^2 ; S <= x]
+    double residence = 0; // integral of dt / (1 - rho(t)) up to the current size
+    double total = 0;     // sum of T(x) over the jobs
+    int previous = 0;
+    for (int i = 0; i < n;)
+    {
+        int x = bursts[i], count = 0;
+        while (i < n && bursts[i] == x)
+        {
+            count++;
+            i++;
+        }
+        residence += (x - previous) / (1 - below);
+        double upto = below + lambda * (double)x * count / n; // rho(x)
+        m2_upto += (double)x * x * count / n;
+        double tail = (double)(n - i) / n; // P(S > x)
+        double waiting = lambda * (m2_upto + (double)x * x * tail) / (2 * (1 - upto) * (1 - upto));
+        total += count * (waiting + residence);
+        below = upto;
+        previous = x;
+    }
+    est->srpt_tat = total / n;
+    est->srpt_wt = est->srpt_tat - es;
+    return 1;
+}
+
+int sim_analyze(sim_context *ctx, const sim_workload *w, sim_estimate *est)
+{
+    if (ctx == NULL || w == NULL || est == NULL)
+    {
+        return SIM_ERROR_ARGUMENT;
+    }
+    int n = load_columns(ctx, w);
+    if (n < 0)
+    {
+        return n;
+    }
+    return estimate_workload(ctx, ctx->rows, n, est) ? SIM_OK : SIM_ERROR_MEMORY;
+}
+
+void display_algorithm_result(sim_context *ctx, process *ps, int n, int i, int with_histogram)
+{
+    result *final_result = ctx->final_result;
+    dotted_line(ctx);
+    report_printf(&ctx->rep, "\n\n-> Result of %s", algorithm_titles[i]);
+    sort_by_index(ps, n);
+    display2(ctx, ps, n);
+    report_algorithm(&ctx->rep, final_result, i, ps, n);
+#if SIM_COUNTERS
+    display_counters(ctx, i);
+#endif
+    if (with_histogram)
+    {
+        report_printf(&ctx->rep, "\n-> Histogram for %s\n", algorithm_titles[i]);
+        separate_results(ctx, i);
+    }
+    dotted_line(ctx);
+}
+
+void display_result(sim_context *ctx)
+{
+    dotted_line(ctx);
+    report_printf(&ctx->rep, "\n\nFinal Comparison");
+    display_AWT(ctx, 8);
+    dotted_line(ctx);
+    display_ATT(ctx, 8);
+    dotted_line(ctx);
+    display_ART(ctx, 8);
+    dotted_line(ctx);
+    display_Context_switch(ctx, 8);
+    dotted_line(ctx);
+    display_throughput(ctx, 8);
+    dotted_line(ctx);
+    display_cpu_utilization(ctx, 8);
+    dotted_line(ctx);
+    display_percentiles(ctx, 8);
+    dotted_line(ctx);
+}
+
+void display_AWT(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    double max = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (final_result[i].awt > max)
+        {
+            max = final_result[i].awt;
+        }
+    }
+
+    double scale = 100 / max;
+
+    report_printf(&ctx->rep, "\n--------------------------------\n");
+    report_printf(&ctx->rep, "Average Waiting Time Comparison\n");
+    report_printf(&ctx->rep, "--------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "\n%-12s|", algorithm_names[i]);
+        report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].awt));
+        report_printf(&ctx->rep, " (%.2f)\n", final_result[i].awt);
+    }
+}
+
+void display_ATT(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    double max = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (final_result[i].att > max)
+        {
+            max = final_result[i].att;
+        }
+    }
+
+    double scale = 100 / max;
+
+    report_printf(&ctx->rep, "\n------------------------------------\n");
+    report_printf(&ctx->rep, "Average Turn-Around Time Comparison\n");
+    report_printf(&ctx->rep, "------------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "\n%-12s|", algorithm_names[i]);
+        report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].att));
+        report_printf(&ctx->rep, " (%.2lf)\n", final_result[i].att);
+    }
+}
+
+void display_ART(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    double max = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (final_result[i].art > max)
+        {
+            max = final_result[i].art;
+        }
+    }
+
+    double scale = 100 / max;
+
+    report_printf(&ctx->rep, "\n------------------------------------\n");
+    report_printf(&ctx->rep, "Average Response-Time Comparison\n");
+    report_printf(&ctx->rep, "------------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "\n%-12s|", algorithm_names[i]);
+        report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].art) / 2);
+        report_printf(&ctx->rep, " (%.2lf)\n", final_result[i].art);
+    }
+}
+
+void display_Context_switch(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    double max = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (final_result[i].context_switch > max)
+        {
+            max = final_result[i].context_switch;
+        }
+    }
+
+    double scale = 100 / max;
+
+    report_printf(&ctx->rep, "\n------------------------------------\n");
+    report_printf(&ctx->rep, "Context-Switch Comparison\n");
+    report_printf(&ctx->rep, "------------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "\n%-12s|", algorithm_names[i]);
+        report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].context_switch));
+        report_printf(&ctx->rep, " (%d)\n", final_result[i].context_switch);
+    }
+}
+
+void display_throughput(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    double max = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (final_result[i].throughput > max)
+        {
+            max = final_result[i].throughput;
+        }
+    }
+
+    double scale = 100 / max;
+
+    report_printf(&ctx->rep, "\n------------------------------------\n");
+    report_printf(&ctx->rep, "Through-Put Comparison\n");
+    report_printf(&ctx->rep, "------------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "\n%-12s|", algorithm_names[i]);
+        report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].throughput));
+        report_printf(&ctx->rep, " (%0.4f)\n", final_result[i].throughput);
+    }
+}
+
+void display_percentiles(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    report_printf(&ctx->rep, "\n------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "Tail Latency Comparison\n");
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| Algorithm   | Metric |     p50 |     p95 |     p99 |   p99.9 |  Std-Dev  |\n");
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        latency_stats *stats[3] = {&final_result[i].wt_stats, &final_result[i].tat_stats, &final_result[i].rt_stats};
+        char *metrics[3] = {"WT", "TAT", "RT"};
+
+        for (int j = 0; j < 3; j++)
+        {
+            report_printf(&ctx->rep, "| %-11s | %-6s | %7.2f | %7.2f | %7.2f | %7.2f | %9.2f |\n", j == 0 ? algorithm_names[i] : "", metrics[j],
+                          stats_percentile(stats[j], 50), stats_percentile(stats[j], 95), stats_percentile(stats[j], 99),
+                          stats_percentile(stats[j], 99.9), stats_stddev(stats[j]));
+        }
+    }
+
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------\n");
+}
+
+void display_cpu_utilization(sim_context *ctx, int n)
+{
+    result *final_result = ctx->final_result;
+    report_printf(&ctx->rep, "\n------------------------------------\n");
+    report_printf(&ctx->rep, "CPU-Utilization Comparison\n");
+    report_printf(&ctx->rep, "------------------------------------\n");
+
+    for (int i = 0; i < n; i++)
+    {
+        report_printf(&ctx->rep, "\n%-12s|", algorithm_names[i]);
+        report_repeat(&ctx->rep, '#', (int)(100 * final_result[i].cpu_utilization));
+        report_printf(&ctx->rep, " (%0.2f%%, idle %d)\n", 100 * final_result[i].cpu_utilization, final_result[i].idle_time);
+    }
+}
+
+// analytic estimates next to the simulated averages of the policy each model stands for
+// (FCFS, RR, SRTN), simulated[k] says whether that policy's final_result holds a run
+void display_estimate(sim_context *ctx, sim_estimate *est, int simulated[3])
+{
+    result *final_result = ctx->final_result;
+    char *models[3] = {"M/G/1 FCFS", "Processor sharing", "SRPT"};
+    int policies_of_models[3] = {3, 0, 5};
+    double wt[3] = {est->fcfs_wt, est->ps_wt, est->srpt_wt};
+    double tat[3] = {est->fcfs_tat, est->ps_tat, est->srpt_tat};
+
+    report_printf(&ctx->rep, "\n------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "Analytic Estimate (arrival-rate %.4f, E[S] %.2f, E[S^2] %.2f, utilization %.2f%s)\n",
+                  est->arrival_rate, est->mean_burst, est->burst_moment2, est->utilization,
+                  est->stable ? "" : ", unstable");
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| Model             |   Est-WT |  Est-TAT | Policy      |   Sim-WT |  Sim-TAT |\n");
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------\n");
+    for (int k = 0; k < 3; k++)
+    {
+        result *r = &final_result[policies_of_models[k]];
+        report_printf(&ctx->rep, "| %-17s | %8.2f | %8.2f | %-11s |", models[k], wt[k], tat[k],
+                      algorithm_names[policies_of_models[k]]);
+        if (simulated[k] && r->tat_stats.count > 0)
+        {
+            report_printf(&ctx->rep, " %8.2f | %8.2f |\n", r->awt, r->att);
+        }
+        else
+        {
+            report_printf(&ctx->rep, " %8s | %8s |\n", "-", "-");
+        }
+    }
+    report_printf(&ctx->rep, "------------------------------------------------------------------------------\n");
+}
+
+// windowed view of the run, shows load transients that the averages hide
+void display_series(sim_context *ctx, int i)
+{
+    result *final_result = ctx->final_result;
+    time_series *s = &final_result[i].series;
+    if (s->count == 0)
+    {
+        return;
+    }
+
+    report_printf(&ctx->rep, "\nTime Series (window = %d, %lld older windows dropped)\n", ctx->series_width, s->dropped);
+    report_printf(&ctx->rep, "-------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "|   Window    | CPU-Utilization | Run-Queue | Through-Put | Context-Switches |\n");
+    report_printf(&ctx->rep, "-------------------------------------------------------------------------------\n");
+
+    for (int k = 0; k < s->count; k++)
+    {
+        series_window *w = &s->windows[(s->head + k) % SERIES_CAPACITY];
+        double utilization = 100.0 * w->busy / w->width;
+        double run_queue = (1.0) * w->queue_area / w->width;
+        double throughput = (1.0) * w->completions / w->width;
+
+        report_printf(&ctx->rep, "| %4d - %4d | %14.2f%% | %9.2f | %11.4f | %16d |\n", w->start, w->start + w->width,
+                      utilization, run_queue, throughput, w->context_switch);
+    }
+
+    report_printf(&ctx->rep, "-------------------------------------------------------------------------------\n");
+}
+
+#if SIM_COUNTERS
+// per call averages of every engine phase of one algorithm, - when a counter is not available
+void display_counters(sim_context *ctx, int algorithm)
+{
+    char *phases[NO_OF_PHASES] = {"Pick-Next", "Enqueue", "Metrics"};
+
+    report_printf(&ctx->rep, "\n-> Engine phases of %s (per call)\n", algorithm_titles[algorithm]);
+    report_printf(&ctx->rep, "-------------------------------------------------------------------------------------------------------\n");
+    report_printf(&ctx->rep, "| Phase     |     Calls |  ns p50 |  ns p99 |   Cycles | Instructions |  IPC | LLC-Miss | Branch-Miss |\n");
+    report_printf(&ctx->rep, "-------------------------------------------------------------------------------------------------------\n");
+
+    for (int j = 0; j < NO_OF_PHASES; j++)
+    {
+        phase_counters *p = &ctx->counters.phases[algorithm][j];
+        double per_call[NO_OF_COUNTERS];
+        for (int k = 0; k < NO_OF_COUNTERS; k++)
+        {
+            per_call[k] = p->calls > 0 ? (1.0) * p->totals[k] / p->calls : 0;
+        }
+
+        report_printf(&ctx->rep, "| %-9s | %9lld | %7.0f | %7.0f |", phases[j], p->calls, stats_percentile(&p->latency, 50),
+                      stats_percentile(&p->latency, 99));
+        if (ctx->counters.slot[COUNTER_CYCLES] == -1)
+        {
+            report_printf(&ctx->rep, " %8s | %12s | %4s | %8s | %11s |\n", "-", "-", "-", "-", "-");
+            continue;
+        }
+        report_printf(&ctx->rep, " %8.1f | %12.1f | %4.2f | %8.2f | %11.2f |\n", per_call[COUNTER_CYCLES],
+                      per_call[COUNTER_INSTRUCTIONS],
+                      per_call[COUNTER_CYCLES] > 0 ? per_call[COUNTER_INSTRUCTIONS] / per_call[COUNTER_CYCLES] : 0,
+                      per_call[COUNTER_LLC_MISSES], per_call[COUNTER_BRANCH_MISSES]);
+    }
+
+    report_printf(&ctx->rep, "-------------------------------------------------------------------------------------------------------\n");
+}
+#endif
+
+void separate_results(sim_context *ctx, int i)
+{
+    result *final_result = ctx->final_result;
+    double max;
+    if (final_result[i].awt > final_result[i].att && final_result[i].awt > final_result[i].art)
+    {
+        max = final_result[i].awt;
+    }
+    else if (final_result[i].att > final_result[i].art)
+    {
+        max = final_result[i].att;
+    }
+    else
+    {
+        max = final_result[i].art;
+    }
+
+    double scale = 100 / max;
+
+    // Average WT
+    report_printf(&ctx->rep, "\nAverage-Waiting-Time     |");
+    report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].awt));
+    report_printf(&ctx->rep, " (%0.2f)\n", final_result[i].awt);
+
+    // Average TAT
+    report_printf(&ctx->rep, "\nAverage-Turn-Around-Time |");
+    report_repeat(&ctx->rep, '#', (int)(scale * final_result[i].att));
+    report_printf(&ctx->rep, " (%0.2f)\n", final_result[i].att);
+
+    // Average RT
+    report_printf(&ctx->rep, "\nAverage-Response-Time    |");
+    report_repeat(&ctx->rep, '#', (int)ceil(scale * final_result[i].art));
+    report_printf(&ctx->rep, " (%0.2f)\n", final_result[i].art);
+
+    // Context Switch
+    report_printf(&ctx->rep, "\nContext-Switch           | (%d)\n", final_result[i].context_switch);
+
+    // Through-put
+    report_printf(&ctx->rep, "\nThrough-Put              | (%0.4f)\n", final_result[i].throughput);
+
+    // CPU utilization
+    report_printf(&ctx->rep, "\nCPU-Utilization          | (%0.2f%%, busy %d, idle %d)\n", 100 * final_result[i].cpu_utilization,
+                  final_result[i].busy_time, final_result[i].idle_time);
+
+    // Switch overhead, only shown when the run had a cost model
+    if (final_result[i].overhead_time > 0)
+    {
+        report_printf(&ctx->rep, "\nSwitch-Overhead          | (%0.2f%%, %d)\n", 100 * final_result[i].overhead_share,
+                      final_result[i].overhead_time);
+    }
+
+    // Tail latency
+    latency_stats *stats[3] = {&final_result[i].wt_stats, &final_result[i].tat_stats, &final_result[i].rt_stats};
+    char *labels[3] = {"\nWaiting-Time p50/p95/p99/p99.9     |", "\nTurn-Around-Time p50/p95/p99/p99.9 |", "\nResponse-Time p50/p95/p99/p99.9    |"};
+    for (int j = 0; j < 3; j++)
+    {
+        report_printf(&ctx->rep, "%s %0.2f / %0.2f / %0.2f / %0.2f\n", labels[j], stats_percentile(stats[j], 50), stats_percentile(stats[j], 95),
+                      stats_percentile(stats[j], 99), stats_percentile(stats[j], 99.9));
+    }
+
+    // I/O-bound processes, only shown when some process did I/O
+    if (final_result[i].io_busy > 0)
+    {
+        latency_stats *burst = &final_result[i].burst_stats;
+        report_printf(&ctx->rep, "\nIO-Utilization           | (%0.2f%%, busy %d)\n", 100 * final_result[i].io_utilization,
+                      final_result[i].io_busy);
+        report_printf(&ctx->rep, "\nBurst-Wait p50/p95/p99/p99.9       | %0.2f / %0.2f / %0.2f / %0.2f\n", stats_percentile(burst, 50),
+                      stats_percentile(burst, 95), stats_percentile(burst, 99), stats_percentile(burst, 99.9));
+    }
+
+    display_series(ctx, i);
+}
+
+void dotted_line(sim_context *ctx)
+{
+    report_repeat(&ctx->rep, '_', 140);
+}
+
+void generateProcesses(sim_context *ctx, process *processes, int n)
+{
+    int index = generate_random_number(ctx, 0, n);
+    processes[index].at = 0; // giving at = 0 to any process randomly
+
+    for (int i = 0; i < n; i++)
+    {
+        processes[i].id = i + 1;
+
+        if (i == index)
+        {
+            continue;
+        }
+
+        processes[i].at = generate_random_number(ctx, 0, 9); // Random arrival time between 0 and 9
+    }
+
+    int max_of_arrival = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (max_of_arrival < processes[i].at)
+        {
+            max_of_arrival = processes[i].at;
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        processes[i].bt = generate_random_number(ctx, max_of_arrival, 16); // Random burst time between 1 and 16
+    }
+}
+
+// bursts of 1 .. 16 arriving so that the cpu is about load busy, every field any
+// policy needs is filled (priority, tickets, one EDF job due four bursts after arrival)
+void generate_workload(sim_context *ctx, process *ps, int n, double load)
+{
+    int clock = 0;
+    int max_gap = (int)(17 / load);
+    for (int i = 0; i < n; i++)
+    {
+        ps[i].id = i + 1;
+        ps[i].at = clock;
+        ps[i].bt = generate_random_number(ctx, 1, 16);
+        ps[i].priority = generate_random_number(ctx, 1, 10);
+        ps[i].tickets[0] = i == 0 ? 1 : ps[i - 1].tickets[1] + 1;
+        ps[i].tickets[1] = ps[i].tickets[0] + generate_random_number(ctx, 0, 19);
+        ps[i].period = 4 * ps[i].bt;
+        ps[i].no_of_execution = 1;
+        ps[i].quantum = 0;
+        ps[i].cpu_burst = 0;
+        ps[i].io_wait = 0;
+        ps[i].ct = 0;
+        ps[i].wt = 0;
+        ps[i].tat = 0;
+        ps[i].rt = -1;
+
+        clock += generate_random_number(ctx, 0, max_gap);
+    }
+}
+
+// makes about a quarter of ps I/O-bound : cpu bursts of 1 .. 3 between requests of 2 .. 6, which
+// keeps the device well below saturation next to a generated workload
+void generate_io_behavior(sim_context *ctx, process *ps, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (generate_random_number(ctx, 0, 3) == 0)
+        {
+            ps[i].cpu_burst = generate_random_number(ctx, 1, 3);
+            ps[i].io_wait = generate_random_number(ctx, 2, 6);
+        }
+    }
+}
+
+void generate_tickets(sim_context *ctx, process *processes, int n)
+{
+    int lower = 1;
+    processes[0].tickets[0] = lower;
+
+    int upper = generate_random_number(ctx, lower + 1, lower + 20);
+    processes[0].tickets[1] = upper;
+
+    for (int i = 1; i < n; i++)
+    {
+        lower = processes[i - 1].tickets[1] + 1;
+        processes[i].tickets[0] = lower;
+
+        upper = generate_random_number(ctx, lower + 1, lower + 20);
+        processes[i].tickets[1] = generate_random_number(ctx, lower + 1, upper);
+    }
+
+    int ticket_range = processes[n - 1].tickets[1];
+}
+
+void set_Priority(sim_context *ctx, process *ps, int n)
+{
+    int priority;
+    int priority_given = 0;
+    int total_priority = n;
+    int flag;
+
+    int j = 0;
+    while (priority_given < total_priority)
+    {
+        flag = 0;
+
+        priority = generate_random_number(ctx, 1, n);
+
+        for (int i = 0; i < j; i++)
+        {
+            if (ps[i].priority == priority)
+            {
+                flag = 1;
+                break;
+            }
+        }
+
+        if (flag == 0)
+        {
+            ps[j].priority = priority;
+            // printf("\nProcess %d Priority: %d", ps[j].id, priority);
+            priority_given++;
+            j++;
+        }
+    }
+}
+
+// Batch mode : simulator --batch scenario.txt [--out file] [--format csv|json|text]
+// Runs every "run" line of the scenario in one process, results are streamed to
+// --out (default terminal) as they finish. Scenario lines :
+//
+//   # comment
+//   workload <name> default               the 3 built-in processes
+//   workload <name> random <n> [seed]     n generated processes (generate_workload)
+//   workload <name> interactive <n> [seed] the same with a quarter of them I/O-bound
+//   workload <name> file <path>           one process per line : at bt [priority [period no_of_execution [quantum [cpu_burst io_wait]]]]
+//   workload <name> packed <path>         the same file (in arrival order) held compressed, for traces too large to
+//                                         load as processes. Its runs are streamed and report no per-process rows,
+//                                         the policies of one run line share a single pass over it (fused)
+//   quantum <time-quantum>                used by RR and Lottery from here on (default 2)
+//   switch <cost> [<warmup> <time>]       from here on a context-switch takes cost on the cpu and a
+//                                         process loses up to warmup refilling caches that went cold
+//                                         over time off the cpu (default 0 : switches are free)
+//   seed <seed>                           reseeds the random no. generator (workloads, Lottery draws)
+//   run <workload> <policy>...            policies : rr priority lottery fcfs sjf srtn hrrn edf, or all
+//   cache <dir>                           keeps the results of the following runs in dir, a run
+//                                         repeated with the same workload and settings is read back
+//
+// A workload is loaded once, every run reads it without changing anything but its results.
+int batch_main(int argc, char *argv[])
+{
+    char *scenario = NULL;
+    char *output = NULL;
+    int kind = SINK_CSV;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            scenario = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            i++;
+            kind = strcmp(argv[i], "json") == 0 ? SINK_JSON : strcmp(argv[i], "text") == 0 ? SINK_TEXT : SINK_CSV;
+        }
+        else
+        {
+            fprintf(stderr, "Usage : %s --batch scenario.txt [--out file] [--format csv|json|text]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (scenario == NULL)
+    {
+        fprintf(stderr, "Usage : %s --batch scenario.txt [--out file] [--format csv|json|text]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *fptr_scenario = fopen(scenario, "r");
+    if (fptr_scenario == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", scenario);
+        return 1;
+    }
+    FILE *fptr_out = output != NULL ? fopen(output, "w") : stdout;
+    if (fptr_out == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", output);
+        fclose(fptr_scenario);
+        return 1;
+    }
+
+    sim_context *ctx = sim_create();
+    if (ctx == NULL)
+    {
+        fprintf(stderr, "Not enough memory\n");
+        fclose(fptr_scenario);
+        return 1;
+    }
+    ctx->track_series = 0; // reports never show the windows
+    sim_seed(ctx, time(NULL));
+    report_add_sink(&ctx->rep, kind, fptr_out);
+
+    workload workloads[MAX_WORKLOADS];
+    int no_of_workloads = 0;
+    int time_quantum = 2;
+    int errors = 0, runs = 0;
+
+    char line[1024];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fptr_scenario) != NULL)
+    {
+        line_no++;
+        char *words[16];
+        int no_of_words = 0;
+        for (char *word = strtok(line, " \t\r\n"); word != NULL && no_of_words < 16; word = strtok(NULL, " \t\r\n"))
+        {
+            if (word[0] == '#')
+            {
+                break;
+            }
+            words[no_of_words++] = word;
+        }
+        if (no_of_words == 0)
+        {
+            continue;
+        }
+
+        if (strcmp(words[0], "workload") == 0 && no_of_words >= 3)
+        {
+            if (no_of_workloads == MAX_WORKLOADS)
+            {
+                fprintf(stderr, "%s:%d : more than %d workloads\n", scenario, line_no, MAX_WORKLOADS);
+                errors++;
+                continue;
+            }
+            workload *w = &workloads[no_of_workloads];
+            snprintf(w->name, sizeof(w->name), "%s", words[1]);
+            w->ps = NULL;
+            w->n = 0;
+            w->packed = NULL;
+
+            if (strcmp(words[2], "default") == 0)
+            {
+                w->n = 3;
+                w->ps = malloc(w->n * sizeof(process));
+                set_processes(w->ps, w->n);
+                set_Priority(ctx, w->ps, w->n);
+                generate_tickets(ctx, w->ps, w->n);
+            }
+            else if ((strcmp(words[2], "random") == 0 || strcmp(words[2], "interactive") == 0) && no_of_words >= 4)
+            {
+                w->n = atoi(words[3]);
+                if (no_of_words >= 5)
+                {
+                    sim_seed(ctx, atoi(words[4]));
+                }
+                w->ps = w->n > 0 ? malloc(w->n * sizeof(process)) : NULL;
+                if (w->ps != NULL)
+                {
+                    generate_workload(ctx, w->ps, w->n, 0.9);
+                    if (strcmp(words[2], "interactive") == 0)
+                    {
+                        generate_io_behavior(ctx, w->ps, w->n);
+                    }
+                }
+            }
+            else if (strcmp(words[2], "file") == 0 && no_of_words >= 4)
+            {
+                w->n = load_workload_file(ctx, words[3], &w->ps);
+            }
+            else if (strcmp(words[2], "packed") == 0 && no_of_words >= 4)
+            {
+                w->packed = load_packed_file(ctx, words[3]);
+                if (w->packed != NULL)
+                {
+                    w->n = (int)w->packed->n;
+                    long long bytes = w->packed->no_of_words * sizeof(unsigned int) + w->packed->no_of_blocks * sizeof(pack_block);
+                    fprintf(stderr, "%s : %d processes packed in %lld bytes (%.2f per process)\n", w->name, w->n, bytes,
+                            (1.0) * bytes / w->n);
+                }
+            }
+
+            if ((w->ps == NULL && w->packed == NULL) || w->n <= 0)
+            {
+                fprintf(stderr, "%s:%d : could not load workload %s\n", scenario, line_no, words[1]);
+                free(w->ps);
+                errors++;
+                continue;
+            }
+            no_of_workloads++;
+        }
+        else if (strcmp(words[0], "quantum") == 0 && no_of_words >= 2)
+        {
+            time_quantum = atoi(words[1]);
+        }
+        else if (strcmp(words[0], "seed") == 0 && no_of_words >= 2)
+        {
+            sim_seed(ctx, atoi(words[1]));
+        }
+        else if (strcmp(words[0], "switch") == 0 && (no_of_words == 2 || no_of_words == 4))
+        {
+            sim_set_switch_cost(ctx, atoi(words[1]), no_of_words == 4 ? atoi(words[2]) : 0,
+                                no_of_words == 4 ? atoi(words[3]) : 0);
+        }
+        else if (strcmp(words[0], "cache") == 0 && no_of_words >= 2)
+        {
+            // reports list every process, so entries keep the per-process outputs too
+            if (sim_set_cache(ctx, words[1], 1) != SIM_OK)
+            {
+                fprintf(stderr, "%s:%d : cannot use %s as cache\n", scenario, line_no, words[1]);
+                errors++;
+            }
+        }
+        else if (strcmp(words[0], "run") == 0 && no_of_words >= 3)
+        {
+            workload *w = NULL;
+            for (int i = 0; i < no_of_workloads; i++)
+            {
+                if (strcmp(workloads[i].name, words[1]) == 0)
+                {
+                    w = &workloads[i];
+                }
+            }
+            if (w == NULL)
+            {
+                fprintf(stderr, "%s:%d : unknown workload %s\n", scenario, line_no, words[1]);
+                errors++;
+                continue;
+            }
+
+            int algorithms[8 * 16], no_of_algorithms = 0;
+            for (int j = 2; j < no_of_words; j++)
+            {
+                int first = 0, last = 7;
+                if (strcmp(words[j], "all") != 0)
+                {
+                    first = last = policy_index(words[j]);
+                    if (first == -1)
+                    {
+                        fprintf(stderr, "%s:%d : unknown policy %s\n", scenario, line_no, words[j]);
+                        errors++;
+                        continue;
+                    }
+                }
+                for (int k = first; k <= last; k++)
+                {
+                    algorithms[no_of_algorithms++] = k;
+                }
+            }
+
+            for (int a = 0; a < no_of_algorithms; a++)
+            {
+                int k = algorithms[a];
+                ctx->rep.workload = w->name;
+                if (w->packed != NULL && a % FUSE_MAX_LANES == 0)
+                {
+                    // the policies of the line share one pass over the packed workload
+                    int lanes = no_of_algorithms - a < FUSE_MAX_LANES ? no_of_algorithms - a : FUSE_MAX_LANES;
+                    initialize_final_result(ctx->final_result);
+                    if (!run_packed(ctx, algorithms + a, lanes, w->packed, time_quantum))
+                    {
+                        fprintf(stderr, "%s:%d : not enough memory to run %s\n", scenario, line_no, words[1]);
+                        errors++;
+                        break;
+                    }
+                }
+                else if (w->packed == NULL)
+                {
+                    // runs only write the results of w->ps, every policy sees the same workload
+                    initialize_final_result(ctx->final_result);
+                    run_algorithm(ctx, k, w->ps, w->n, time_quantum);
+                }
+                if (kind == SINK_TEXT && w->packed != NULL)
+                {
+                    report_printf(&ctx->rep, "\n\n-> Workload %s (%d packed processes, time-quantum %d)", w->name, w->n, time_quantum);
+                    report_printf(&ctx->rep, "\n\n-> Result of %s\n", algorithm_titles[k]);
+                    separate_results(ctx, k);
+                    report_flush(&ctx->rep);
+                }
+                else if (kind == SINK_TEXT)
+                {
+                    report_printf(&ctx->rep, "\n\n-> Workload %s (%d processes, time-quantum %d)", w->name, w->n, time_quantum);
+                    display_algorithm_result(ctx, w->ps, w->n, k, 0);
+                    report_flush(&ctx->rep);
+                }
+                else
+                {
+                    report_algorithm(&ctx->rep, ctx->final_result, k, w->ps, w->n);
+                    fflush(fptr_out);
+                }
+                runs++;
+            }
+        }
+        else
         {
-            max = final_result[i].art;
+            fprintf(stderr, "%s:%d : cannot read \"%s\"\n", scenario, line_no, words[0]);
+            errors++;
         }
     }
 
-    double scale = 100 / max;
-    if (result_on_terminal)
+    if (ctx->cache_dir[0] != '\0')
+    {
+        fprintf(stderr, "cache : %lld runs read back, %lld simulated\n", ctx->cache_hits, ctx->cache_misses);
+    }
+    sim_destroy(ctx);
+    fclose(fptr_scenario);
+    for (int i = 0; i < no_of_workloads; i++)
     {
-        printf("\n------------------------------------\n");
-        printf("Average Response-Time Comparison\n");
-        printf("------------------------------------\n");
+        free(workloads[i].ps);
+        pack_free(workloads[i].packed);
     }
 
-    if (result_in_file)
+    if (output != NULL)
     {
-        fputs("\n------------------------------------\n", fptr_write);
-        fputs("Average Response-Time Comparison\n", fptr_write);
-        fputs("------------------------------------\n", fptr_write);
+        printf("%d run(s) written to %s\n", runs, output);
     }
+    return errors > 0;
+}
 
-    for (int i = 0; i < n; i++)
+// Estimate mode : simulator --estimate workload.txt [--threshold tat] [--margin percent] [--quantum q]
+// Fits the workload file (same format as the batch "file" workloads) and prints the analytic
+// waiting and turn-around times in microseconds' worth of work. With --threshold, a model whose
+// turn-around estimate lies within --margin percent (default 10) of it is close enough to the
+// decision to be worth confirming : its policy is simulated and shown next to the estimate.
+int estimate_main(int argc, char *argv[])
+{
+    char *file = NULL;
+    double threshold = -1, margin = 10;
+    int time_quantum = 1; // the closest RR gets to processor sharing
+    for (int i = 1; i < argc; i++)
     {
-        if (result_on_terminal)
-        {
-            printf("\n");
-            if (i == 0)
-                printf("Round-Robin |");
-            else if (i == 1)
-                printf("Priority    |");
-            else if (i == 2)
-                printf("Lottery     |");
-            else if (i == 3)
-                printf("FCFS        |");
-            else if (i == 4)
-                printf("SJF         |");
-            else if (i == 5)
-                printf("SRTN        |");
-            else if (i == 6)
-                printf("HRRN        |");
-            else if (i == 7)
-                printf("EDF         |");
-        }
-        if (result_in_file)
-        {
-            fputs("\n", fptr_write);
-            if (i == 0)
-                fputs("Round-Robin |", fptr_write);
-            else if (i == 1)
-                fputs("Priority    |", fptr_write);
-            else if (i == 2)
-                fputs("Lottery     |", fptr_write);
-            else if (i == 3)
-                fputs("FCFS        |", fptr_write);
-            else if (i == 4)
-                fputs("SJF         |", fptr_write);
-            else if (i == 5)
-                fputs("SRTN        |", fptr_write);
-            else if (i == 6)
-                fputs("HRRN        |", fptr_write);
-            else if (i == 7)
-                fputs("EDF         |", fptr_write);
-        }
-
-        int attStars = (int)(scale * final_result[i].art);
-
-        for (int j = 0; j < attStars / 2; j++)
-        {
-            if (result_on_terminal)
-            {
-                printf("#");
-            }
-            if (result_in_file)
-            {
-                fputs("#", fptr_write);
-            }
+        if (strcmp(argv[i], "--estimate") == 0 && i + 1 < argc)
+        {
+            file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+        {
+            threshold = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--margin") == 0 && i + 1 < argc)
+        {
+            margin = atof(argv[++i]);
         }
-        if (result_on_terminal)
+        else if (strcmp(argv[i], "--quantum") == 0 && i + 1 < argc)
         {
-            printf(" (%.2lf)\n", final_result[i].art);
+            time_quantum = atoi(argv[++i]);
         }
-        if (result_in_file)
+        else
         {
-            fprintf(fptr_write, " (%.2lf)\n", final_result[i].art);
+            file = NULL;
+            break;
         }
     }
-}
+    if (file == NULL)
+    {
+        fprintf(stderr, "Usage : %s --estimate workload.txt [--threshold tat] [--margin percent] [--quantum q]\n", argv[0]);
+        return 2;
+    }
 
-void display_Context_switch(result *final_result, int n)
-{
-    double max = -1;
-    for (int i = 0; i < n; i++)
+    sim_context *ctx = sim_create();
+    if (ctx == NULL)
     {
-        if (final_result[i].context_switch > max)
-        {
-            max = final_result[i].context_switch;
-        }
+        fprintf(stderr, "Not enough memory\n");
+        return 1;
     }
+    ctx->track_series = 0;
+    sim_seed(ctx, time(NULL));
+    report_add_sink(&ctx->rep, SINK_TEXT, stdout);
 
-    double scale = 100 / max;
-    if (result_on_terminal)
+    process *ps = NULL;
+    int n = load_workload_file(ctx, file, &ps);
+    if (n <= 0)
     {
-        printf("\n------------------------------------\n");
-        printf("Context-Switch Comparison\n");
-        printf("------------------------------------\n");
+        fprintf(stderr, "Could not load %s\n", file);
+        sim_destroy(ctx);
+        return 1;
     }
 
-    if (result_in_file)
+    sim_estimate est;
+    if (!estimate_workload(ctx, ps, n, &est))
     {
-        fputs("\n------------------------------------\n", fptr_write);
-        fputs("Context-Switch Comparison\n", fptr_write);
-        fputs("------------------------------------\n", fptr_write);
+        fprintf(stderr, "Not enough memory\n");
+        free(ps);
+        sim_destroy(ctx);
+        return 1;
     }
 
-    for (int i = 0; i < n; i++)
+    // FCFS, RR and SRTN confirm the three models
+    int models[3] = {3, 0, 5};
+    double estimated[3] = {est.fcfs_tat, est.ps_tat, est.srpt_tat};
+    int simulated[3] = {0, 0, 0};
+    initialize_final_result(ctx->final_result);
+    for (int k = 0; threshold >= 0 && k < 3; k++)
+    {
+        if (fabs(estimated[k] - threshold) <= threshold * margin / 100)
+        {
+            run_algorithm(ctx, models[k], ps, n, time_quantum);
+            simulated[k] = 1;
+        }
+    }
+
+    report_printf(&ctx->rep, "\n-> Workload %s (%d processes)", file, n);
+    display_estimate(ctx, &est, simulated);
+    report_close(&ctx->rep);
+    free(ps);
+    sim_destroy(ctx);
+    return 0;
+}
+
+// Stream mode : simulator --stream <file|-> [--policy name[,name...]|all] [--quantum q] [--every t] [--follow]
+//                                   [--no-completions] [--switch cost] [--warmup cost time] [--out file]
+// Runs a policy (default fcfs) over arrivals read as the run goes, from a file, a pipe or
+// stdin ("-"). With several policies the feed is read once for all of them (a fused run) and
+// every record names its policy after the record type, records of different policies interleave.
+// Lines are in the workload file format and come in order of arrival time, an
+// arrival read after simulated time has passed it is run as arriving at the current time.
+// Simulated time moves up to each arrival as it is read. Every completed process is written as
+// it leaves the system and its memory goes to the next arrival, every --every units of simulated
+// time (default 1000) the metrics so far are written. With --follow the end of the file is
+// waited at for more lines (a log being written, like tail -f), the run then ends on an interrupt.
+// --switch and --warmup charge context-switches and cache warmup as in a batch "switch" line.
+int stream_main(int argc, char *argv[])
+{
+    char *file = NULL, *output = NULL;
+    int algorithms[FUSE_MAX_LANES] = {3}, no_of_algorithms = 1;
+    int time_quantum = 2, every = 1000, follow = 0, completions = 1;
+    int switch_cost = 0, warmup_cost = 0, warmup_time = 0;
+    for (int i = 1; i < argc; i++)
     {
-        if (result_on_terminal)
-        {
-            printf("\n");
-            if (i == 0)
-                printf("Round-Robin |");
-            else if (i == 1)
-                printf("Priority    |");
-            else if (i == 2)
-                printf("Lottery     |");
-            else if (i == 3)
-                printf("FCFS        |");
-            else if (i == 4)
-                printf("SJF         |");
-            else if (i == 5)
-                printf("SRTN        |");
-            else if (i == 6)
-                printf("HRRN        |");
-            else if (i == 7)
-                printf("EDF         |");
-        }
-        if (result_in_file)
-        {
-            fputs("\n", fptr_write);
-            if (i == 0)
-                fputs("Round-Robin |", fptr_write);
-            else if (i == 1)
-                fputs("Priority    |", fptr_write);
-            else if (i == 2)
-                fputs("Lottery     |", fptr_write);
-            else if (i == 3)
-                fputs("FCFS        |", fptr_write);
-            else if (i == 4)
-                fputs("SJF         |", fptr_write);
-            else if (i == 5)
-                fputs("SRTN        |", fptr_write);
-            else if (i == 6)
-                fputs("HRRN        |", fptr_write);
-            else if (i == 7)
-                fputs("EDF         |", fptr_write);
-        }
-
-        int attStars = (scale * final_result[i].context_switch);
-
-        for (int j = 0; j < attStars; j++)
-        {
-            if (result_on_terminal)
+        if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+        {
+            file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc)
+        {
+            no_of_algorithms = 0;
+            for (char *name = strtok(argv[++i], ","); name != NULL; name = strtok(NULL, ","))
             {
-                printf("#");
+                for (int k = 0; k < 8; k++)
+                {
+                    if ((strcmp(name, "all") == 0 || k == policy_index(name)) && no_of_algorithms < FUSE_MAX_LANES)
+                    {
+                        algorithms[no_of_algorithms++] = k;
+                    }
+                }
+                if (strcmp(name, "all") != 0 && policy_index(name) == -1)
+                {
+                    no_of_algorithms = 0; // unknown policy
+                    break;
+                }
             }
-            if (result_in_file)
+            if (no_of_algorithms == 0)
             {
-                fputs("#", fptr_write);
+                file = NULL;
+                break;
             }
         }
-
-        if (result_on_terminal)
+        else if (strcmp(argv[i], "--quantum") == 0 && i + 1 < argc)
         {
-            printf(" (%d)\n", final_result[i].context_switch);
+            time_quantum = atoi(argv[++i]);
         }
-
-        if (result_in_file)
+        else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc && (every = atoi(argv[++i])) > 0)
         {
-            fprintf(fptr_write, " (%d)\n", final_result[i].context_switch);
+            continue;
         }
-    }
-}
-
-void display_throughput(result *final_result, int n)
-{
-    double max = -1;
-    for (int i = 0; i < n; i++)
-    {
-        if (final_result[i].throughput > max)
+        else if (strcmp(argv[i], "--follow") == 0)
         {
-            max = final_result[i].throughput;
+            follow = 1;
+        }
+        else if (strcmp(argv[i], "--no-completions") == 0)
+        {
+            completions = 0;
+        }
+        else if (strcmp(argv[i], "--switch") == 0 && i + 1 < argc)
+        {
+            switch_cost = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 2 < argc)
+        {
+            warmup_cost = atoi(argv[++i]);
+            warmup_time = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            file = NULL;
+            break;
         }
     }
-
-    double scale = 100 / max;
-    if (result_on_terminal)
+    if (file == NULL)
     {
-        printf("\n------------------------------------\n");
-        printf("Through-Put Comparison\n");
-        printf("------------------------------------\n");
+        fprintf(stderr,
+                "Usage : %s --stream <file|-> [--policy name[,name...]|all] [--quantum q] [--every t] [--follow] [--no-completions] "
+                "[--switch cost] [--warmup cost time] [--out file]\n",
+                argv[0]);
+        return 2;
     }
 
-    if (result_in_file)
+    FILE *fptr = strcmp(file, "-") == 0 ? stdin : fopen(file, "r");
+    if (fptr == NULL)
     {
-        fputs("\n------------------------------------\n", fptr_write);
-        fputs("Through-Put Comparison\n", fptr_write);
-        fputs("------------------------------------\n", fptr_write);
+        fprintf(stderr, "Could not open %s\n", file);
+        return 1;
     }
-
-    for (int i = 0; i < n; i++)
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+    sim_context *ctx = sim_create();
+    if (out == NULL || ctx == NULL)
     {
-        if (result_on_terminal)
-        {
-            printf("\n");
-            if (i == 0)
-                printf("Round-Robin |");
-            else if (i == 1)
-                printf("Priority    |");
-            else if (i == 2)
-                printf("Lottery     |");
-            else if (i == 3)
-                printf("FCFS        |");
-            else if (i == 4)
-                printf("SJF         |");
-            else if (i == 5)
-                printf("SRTN        |");
-            else if (i == 6)
-                printf("HRRN        |");
-            else if (i == 7)
-                printf("EDF         |");
-        }
-        if (result_in_file)
-        {
-            fputs("\n", fptr_write);
-            if (i == 0)
-                fputs("Round-Robin |", fptr_write);
-            else if (i == 1)
-                fputs("Priority    |", fptr_write);
-            else if (i == 2)
-                fputs("Lottery     |", fptr_write);
-            else if (i == 3)
-                fputs("FCFS        |", fptr_write);
-            else if (i == 4)
-                fputs("SJF         |", fptr_write);
-            else if (i == 5)
-                fputs("SRTN        |", fptr_write);
-            else if (i == 6)
-                fputs("HRRN        |", fptr_write);
-            else if (i == 7)
-                fputs("EDF         |", fptr_write);
-        }
-
-        int attStars = (scale * final_result[i].throughput);
-
-        for (int j = 0; j < attStars; j++)
-        {
-            if (result_on_terminal)
-            {
-                printf("#");
-            }
-            if (result_in_file)
-            {
-                fputs("#", fptr_write);
-            }
-        }
-
-        if (result_on_terminal)
+        fprintf(stderr, out == NULL ? "Could not create %s\n" : "Not enough memory\n", output);
+        if (fptr != stdin)
         {
-            printf(" (%0.4f)\n", final_result[i].throughput);
+            fclose(fptr);
         }
-
-        if (result_in_file)
+        sim_destroy(ctx);
+        return 1;
+    }
+    sim_seed(ctx, time(NULL));
+    sim_set_switch_cost(ctx, switch_cost, warmup_cost, warmup_time);
+    initialize_final_result(ctx->final_result);
+
+    fused_run f;
+    int ok = fused_open(&f, ctx, algorithms, no_of_algorithms, time_quantum, out, completions, every);
+    const char *column = no_of_algorithms > 1 ? "policy," : "";
+    fprintf(out, "# completion,%sct,pid,at,bt,tat,wt,rt\n", column);
+    fprintf(out, "# metrics,%stime,arrived,completed,active,awt,att,art,wt_p95,tat_p95,context_switch,cpu_utilization,overhead\n",
+            column);
+
+    // a line followed is run as soon as it is read, not once a batch is full
+    int batch = follow ? 1 : FUSE_BATCH, count = 0;
+    char line[256];
+    long long next_id = 1;
+    while (ok && stream_next(fptr, follow, line, sizeof(line), &f.filling[count], out))
+    {
+        // ids follow the feed, the ticket range of a process only sets how many it holds
+        process *p = &f.filling[count++];
+        p->id = (int)next_id++;
+        p->tickets[0] = 1;
+        p->tickets[1] = 1 + generate_random_number(ctx, 0, 19);
+        if (count == batch)
         {
-            fprintf(fptr_write, " (%0.4f)\n", final_result[i].throughput);
+            fused_feed(&f, count);
+            count = 0;
         }
     }
-}
-
-void separate_results(result *final_result, int i)
-{
-    double max;
-    if (final_result[i].awt > final_result[i].att && final_result[i].awt > final_result[i].art)
+    if (ok)
     {
-        max = final_result[i].awt;
+        fused_feed(&f, count);
+        ok = fused_finish(&f);
     }
-    else if (final_result[i].att > final_result[i].art)
+    if (!ok)
     {
-        max = final_result[i].att;
+        fprintf(stderr, "Not enough memory\n");
     }
-    else
+    for (int l = 0; ok && l < f.no_of_lanes; l++)
     {
-        max = final_result[i].art;
+        fused_lane *lane = &f.lanes[l];
+        fprintf(stderr, "%s%s%lld process(es) streamed with at most %d slot(s), %lld late arrival(s)\n",
+                no_of_algorithms > 1 ? algorithm_names[algorithms[l]] : "", no_of_algorithms > 1 ? " : " : "",
+                lane->st.arrived, lane->st.capacity, lane->st.late);
     }
 
-    double scale = 100 / max;
-    // printf("Scale : %f", scale);
-    // Average WT
-    if (result_on_terminal)
+    fused_close(&f);
+    sim_destroy(ctx);
+    if (fptr != stdin)
     {
-        printf("\nAverage-Waiting-Time     |");
+        fclose(fptr);
     }
-    if (result_in_file)
+    if (out != stdout)
     {
-        fputs("\nAverage-Waiting-Time     |", fptr_write);
+        fclose(out);
     }
+    return !ok;
+}
 
-    int attStars = (int)((scale * final_result[i].awt));
-    for (int j = 0; j < attStars; j++)
+// Tune mode : simulator --tune workload.txt [--policy rr|lottery] [--objective name] [--budget switches]
+//                                [--range lo hi] [--tickets] [--switch cost] [--warmup cost time] [--grid]
+//                                [--out file] [--format text|csv|json]
+// Finds the time quantum (default range 1 to the longest burst) with the best objective : art
+// (default), awt, att or the 99th percentile rt_p99, wt_p99, tat_p99. --budget keeps to at most
+// that many context-switches per job on average. With --tickets Lottery also tunes a scaling of
+// every process's tickets by (mean burst / burst)^s for a few s. --switch and --warmup charge
+// dispatching as in a batch "switch" line, without them the shortest quantum is rarely beaten.
+// --grid also runs every quantum (and scaling) on the whole workload, to check the search.
+// The search goes to --out (default terminal) as text, or as a CSV / JSON record per candidate
+// and rung (rung 0 : the grid).
+int tune_main(int argc, char *argv[])
+{
+    char *file = NULL;
+    int algorithm = 0, objective = OBJECTIVE_ART, lo = 1, hi = 0, tickets = 0, grid = 0;
+    int switch_cost = 0, warmup_cost = 0, warmup_time = 0;
+    int kind = SINK_TEXT;
+    char *output = NULL;
+    double budget = 0;
+    for (int i = 1; i < argc; i++)
     {
-        if (result_on_terminal)
+        if (strcmp(argv[i], "--tune") == 0 && i + 1 < argc)
         {
-            printf("#");
+            file = argv[++i];
         }
-        if (result_in_file)
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc &&
+                 ((algorithm = policy_index(argv[++i])) == 0 || algorithm == 2))
         {
-            fputs("#", fptr_write);
+            continue;
         }
-    }
-
-    // Average TAT
-    if (result_on_terminal)
-    {
-        printf(" (%0.2f)\n", final_result[i].awt);
-        printf("\nAverage-Turn-Around-Time |");
-    }
-    if (result_in_file)
-    {
-        fprintf(fptr_write, " (%0.2f)\n", final_result[i].awt);
-        fputs("\nAverage-Turn-Around-Time |", fptr_write);
-    }
-    attStars = (int)(scale * final_result[i].att);
-    for (int j = 0; j < attStars; j++)
-    {
-        if (result_on_terminal)
+        else if (strcmp(argv[i], "--objective") == 0 && i + 1 < argc && (objective = tune_objective(argv[++i])) != -1)
         {
-            printf("#");
+            continue;
         }
-        if (result_in_file)
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
         {
-            fputs("#", fptr_write);
+            budget = atof(argv[++i]);
         }
-    }
-
-    // Average RT
-    if (result_on_terminal)
-    {
-        printf(" (%0.2f)\n", final_result[i].att);
-        printf("\nAverage-Response-Time    |");
-    }
-    if (result_in_file)
-    {
-        fprintf(fptr_write, " (%0.2f)\n", final_result[i].att);
-        fputs("\nAverage-Response-Time    |", fptr_write);
-    }
-    attStars = (int)ceil(scale * final_result[i].art);
-    for (int j = 0; j < attStars; j++)
-    {
-        if (result_on_terminal)
+        else if (strcmp(argv[i], "--range") == 0 && i + 2 < argc)
         {
-            printf("#");
+            lo = atoi(argv[++i]);
+            hi = atoi(argv[++i]);
         }
-        if (result_in_file)
+        else if (strcmp(argv[i], "--tickets") == 0)
         {
-            fputs("#", fptr_write);
+            tickets = 1;
+        }
+        else if (strcmp(argv[i], "--switch") == 0 && i + 1 < argc)
+        {
+            switch_cost = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 2 < argc)
+        {
+            warmup_cost = atoi(argv[++i]);
+            warmup_time = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--grid") == 0)
+        {
+            grid = 1;
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            i++;
+            kind = strcmp(argv[i], "json") == 0 ? SINK_JSON : strcmp(argv[i], "csv") == 0 ? SINK_CSV : SINK_TEXT;
+        }
+        else
+        {
+            file = NULL;
+            break;
         }
     }
-
-    // Context Switch
-    if (result_on_terminal)
-    {
-        printf(" (%0.2f)\n", final_result[i].art);
-        printf("\nContext-Switch           |");
-    }
-    if (result_in_file)
+    if (file == NULL || lo < 1 || (hi != 0 && hi < lo))
     {
-        fprintf(fptr_write, " (%0.2f)\n", final_result[i].art);
-        fputs("\nContext-Switches         |", fptr_write);
+        fprintf(stderr,
+                "Usage : %s --tune workload.txt [--policy rr|lottery] [--objective art|awt|att|rt_p99|wt_p99|tat_p99] "
+                "[--budget switches] [--range lo hi] [--tickets] [--switch cost] [--warmup cost time] [--grid] "
+                "[--out file] [--format text|csv|json]\n",
+                argv[0]);
+        return 2;
     }
 
-    if (result_on_terminal)
+    sim_context *ctx = sim_create();
+    if (ctx == NULL)
     {
-        printf(" (%d)\n", final_result[i].context_switch);
+        fprintf(stderr, "Not enough memory\n");
+        return 1;
     }
-    if (result_in_file)
+    sim_seed(ctx, time(NULL));
+    process *ps = NULL;
+    int n = load_workload_file(ctx, file, &ps);
+    if (n <= 0)
     {
-        fprintf(fptr_write, " (%d)\n", final_result[i].context_switch);
+        fprintf(stderr, "Could not load %s\n", file);
+        sim_destroy(ctx);
+        return 1;
     }
-
-    // Through-put
-    if (result_on_terminal)
+    qsort(ps, n, sizeof(process), compare_arrival); // prefixes are the first arrivals
+    FILE *fptr_out = output != NULL ? fopen(output, "w") : stdout;
+    if (fptr_out == NULL)
     {
-        printf("\nThrough-Put              |");
+        fprintf(stderr, "Could not open %s\n", output);
+        free(ps);
+        sim_destroy(ctx);
+        return 1;
     }
-    if (result_in_file)
+    ctx->rep.tuning = 1;
+    ctx->rep.workload = file;
+    report_add_sink(&ctx->rep, kind, fptr_out);
+
+    tune_settings settings = {
+        .algorithm = algorithm, .objective = objective, .budget = budget, .seed = ctx->seed, .mean_bt = 0};
+    int longest = lo;
+    for (int i = 0; i < n; i++)
     {
-        fputs("\nThrough-Put Value        |", fptr_write);
+        settings.mean_bt += (1.0) * ps[i].bt / n;
+        longest = ps[i].bt > longest ? ps[i].bt : longest;
     }
-    if (result_on_terminal)
+    hi = hi == 0 ? longest : hi; // a quantum past the longest burst runs every burst in one go
+
+    // the scalings raced, the workload's own tickets first
+    double scalings[5] = {0, 0.5, 1, 1.5, 2};
+    int no_of_candidates = algorithm == 2 && tickets ? 5 : 1;
+    tune_candidate candidates[TUNE_MAX_CANDIDATES];
+    tune_candidate *alive[TUNE_MAX_CANDIDATES];
+    int ok = 1;
+    for (int k = 0; k < no_of_candidates; k++)
     {
-        printf(" (%0.4f)\n", final_result[i].throughput);
+        tune_candidate *c = &candidates[k];
+        *c = (tune_candidate){0};
+        c->scaling = scalings[k];
+        c->lo = lo;
+        c->hi = hi;
+        c->settings = &settings;
+        c->ps = ps;
+        c->rows = malloc(n * sizeof(process));
+        ok &= c->rows != NULL;
+        for (int j = 0; j < TUNE_PROBES; j++)
+        {
+            c->ctx[j] = sim_create();
+            ok &= c->ctx[j] != NULL;
+            if (c->ctx[j] != NULL)
+            {
+                c->ctx[j]->track_series = 0;
+                sim_set_switch_cost(c->ctx[j], switch_cost, warmup_cost, warmup_time);
+            }
+        }
+        alive[k] = c;
     }
-    if (result_in_file)
+
+    char *objectives[6] = {"art", "rt_p99", "awt", "wt_p99", "att", "tat_p99"};
+    report_printf(&ctx->rep, "-> Tuning the quantum of %s on %s (%d processes) in [%d, %d] for %s",
+                  algorithm_names[algorithm], file, n, lo, hi, objectives[objective]);
+    if (budget > 0)
     {
-        fprintf(fptr_write, " (%0.4f)\n", final_result[i].throughput);
+        report_printf(&ctx->rep, ", at most %.2f context-switches per job", budget);
     }
-}
+    report_printf(&ctx->rep, "\n");
 
-void dotted_line()
-{
-    for (int i = 0; i < 70; i++)
+    // the prefixes only race candidates, a single one is tuned on the whole workload
+    int no_of_alive = no_of_candidates;
+    for (int rung = no_of_candidates > 1 ? 0 : TUNE_RUNGS - 1; ok && rung < TUNE_RUNGS; rung++)
     {
-        printf("__");
+        int prefix = rung == TUNE_RUNGS - 1 ? n : n >> (TUNE_RUNGS - 1 - rung);
+        prefix = prefix < 1 ? 1 : prefix;
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            alive[k]->n = prefix;
+        }
+#if SIM_PTHREADS
+        pthread_t workers[TUNE_MAX_CANDIDATES];
+        int started[TUNE_MAX_CANDIDATES];
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            started[k] = no_of_alive > 1 && pthread_create(&workers[k], NULL, tune_search, alive[k]) == 0;
+            if (!started[k])
+            {
+                tune_search(alive[k]);
+            }
+        }
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            if (started[k])
+            {
+                pthread_join(workers[k], NULL);
+            }
+        }
+#else
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            tune_search(alive[k]);
+        }
+#endif
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            ok &= !alive[k]->failed;
+        }
+        if (!ok)
+        {
+            break; // a run found no memory, its quantum would only look best
+        }
+
+        // best first (insertion sort, a handful of candidates)
+        for (int k = 1; k < no_of_alive; k++)
+        {
+            tune_candidate *c = alive[k];
+            int j = k;
+            for (; j > 0 && tune_better(c->feasible, c->value, alive[j - 1]->feasible, alive[j - 1]->value); j--)
+            {
+                alive[j] = alive[j - 1];
+            }
+            alive[j] = c;
+        }
+        if (no_of_candidates > 1)
+        {
+            report_printf(&ctx->rep, "\nRung %d : first %d processes\n", rung + 1, prefix);
+        }
+        else
+        {
+            report_printf(&ctx->rep, "\nWhole workload\n");
+        }
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            tune_candidate *c = alive[k];
+            int dropped = k >= (no_of_alive + 1) / 2 && rung < TUNE_RUNGS - 1;
+            report_printf(&ctx->rep, "  ticket scaling %.2f | quantum %6d | %s %12.2f | %2d runs in [%d, %d]%s\n",
+                          c->scaling, c->quantum, c->feasible ? objectives[objective] : "switches", c->value, c->runs,
+                          c->lo, c->hi, dropped ? " (dropped)" : "");
+            report_tuning(&ctx->rep, algorithm, rung + 1, prefix, c, c->feasible ? objectives[objective] : "switches",
+                          dropped);
+        }
+        report_flush(&ctx->rep); // a rung at a time, long searches show how they go
+
+        // the better half goes on, searching around the quantum it found
+        no_of_alive = (no_of_alive + 1) / 2;
+        for (int k = 0; k < no_of_alive; k++)
+        {
+            tune_candidate *c = alive[k];
+            c->lo = c->quantum / 2 > lo ? c->quantum / 2 : lo;
+            c->hi = 2 * c->quantum + 1 < hi ? 2 * c->quantum + 1 : hi;
+        }
     }
-}
 
-void dotted_line_in_file()
-{
-    for (int i = 0; i < 57; i++)
+    long long work = 0;
+    for (int k = 0; k < no_of_candidates; k++)
     {
-        fputs("__", fptr_write);
+        work += candidates[k].work;
     }
-}
-
-void generateProcesses(process *processes, int n)
-{
-    int index = generate_random_number(0, n);
-    processes[index].at = 0; // giving at = 0 to any process randomly
-
-    for (int i = 0; i < n; i++)
+    long long grid_runs = (long long)(hi - lo + 1) * no_of_candidates;
+    if (ok)
     {
-        processes[i].id = i + 1;
-
-        if (i == index)
+        tune_candidate *c = alive[0];
+        report_printf(&ctx->rep, "\n-> Tuned : quantum %d", c->quantum);
+        if (no_of_candidates > 1)
         {
-            continue;
+            report_printf(&ctx->rep, ", ticket scaling %.2f", c->scaling);
         }
-
-        processes[i].at = generate_random_number(0, 9); // Random arrival time between 0 and 9
+        report_printf(&ctx->rep,
+                      c->feasible ? ", %s %.2f\n" : ", no setting keeps to the budget (%s : %.2f switches per job)\n",
+                      objectives[objective], c->value);
+        report_printf(&ctx->rep, "   simulated %.1f workloads' worth of processes, a grid takes %lld\n",
+                      (1.0) * work / n, grid_runs);
     }
 
-    int max_of_arrival = 0;
-    for (int i = 0; i < n; i++)
+    // the same candidates over the whole range, for comparison
+    for (int k = 0; ok && grid && k < no_of_candidates; k++)
     {
-        if (max_of_arrival < processes[i].at)
+        tune_candidate *c = &candidates[k];
+        int best = lo, best_feasible = 0;
+        double best_value = 0;
+        c->n = n;
+        c->failed = 0;
+        tune_prepare(c);
+        for (int q = lo; q <= hi && !c->failed; q++)
         {
-            max_of_arrival = processes[i].at;
+            int feasible;
+            double value;
+            tune_evaluate(c, q, &feasible, &value);
+            if (q == lo || tune_better(feasible, value, best_feasible, best_value))
+            {
+                best = q;
+                best_feasible = feasible;
+                best_value = value;
+            }
         }
+        ok = !c->failed;
+        if (!ok)
+        {
+            break;
+        }
+        report_printf(&ctx->rep, "-> Grid, ticket scaling %.2f : quantum %d, %s %.2f\n", c->scaling, best,
+                      best_feasible ? objectives[objective] : "switches", best_value);
+        tune_candidate g = *c;
+        g.quantum = best;
+        g.value = best_value;
+        g.runs = hi - lo + 1;
+        g.lo = lo;
+        g.hi = hi;
+        report_tuning(&ctx->rep, algorithm, 0, n, &g, best_feasible ? objectives[objective] : "switches", 0);
     }
 
-    for (int i = 0; i < n; i++)
+    if (!ok)
     {
-        processes[i].bt = generate_random_number(max_of_arrival, 16); // Random burst time between 1 and 16
-        processes[i].rbt = processes[i].bt;
+        fprintf(stderr, "Not enough memory\n");
     }
-}
-
-void generate_tickets(process *processes, int n)
-{
-    int lower = 1;
-    processes[0].tickets[0] = lower;
-
-    int upper = generate_random_number(lower + 1, lower + 20);
-    processes[0].tickets[1] = upper;
-
-    for (int i = 1; i < n; i++)
+    for (int k = 0; k < no_of_candidates; k++)
     {
-        lower = processes[i - 1].tickets[1] + 1;
-        processes[i].tickets[0] = lower;
-
-        upper = generate_random_number(lower + 1, lower + 20);
-        processes[i].tickets[1] = generate_random_number(lower + 1, upper);
+        for (int j = 0; j < TUNE_PROBES; j++)
+        {
+            sim_destroy(candidates[k].ctx[j]);
+        }
+        free(candidates[k].rows);
     }
-
-    int ticket_range = processes[n - 1].tickets[1];
+    report_close(&ctx->rep);
+    free(ps);
+    sim_destroy(ctx);
+    return !ok;
 }
 
-void set_RBT_RT(process *ps, int n)
+// index into final_result of a policy name used in scenarios, -1 when unknown
+int policy_index(char *name)
 {
-    for (int i = 0; i < n; i++)
+    char *keys[8] = {"rr", "priority", "lottery", "fcfs", "sjf", "srtn", "hrrn", "edf"};
+    for (int i = 0; i < 8; i++)
     {
-        ps[i].rbt = ps[i].bt;
-        ps[i].rt = -1;
+        if (strcmp(name, keys[i]) == 0)
+        {
+            return i;
+        }
     }
+    return -1;
 }
 
-void set_Priority(process *ps, int n)
+// returns the no. of processes read, *ps is malloc'd (NULL when nothing could be read)
+int load_workload_file(sim_context *ctx, char *file, process **ps)
 {
-    int priority;
-    int priority_given = 0;
-    int total_priority = n;
-    int flag;
-
-    int j = 0;
-    while (priority_given < total_priority)
+    *ps = NULL;
+    FILE *fptr = fopen(file, "r");
+    if (fptr == NULL)
     {
-        flag = 0;
+        return 0;
+    }
 
-        priority = generate_random_number(1, n);
+    int n = 0, capacity = 0;
+    char line[256];
+    process read;
+    while (fgets(line, sizeof(line), fptr) != NULL)
+    {
+        if (!read_process(line, &read))
+        {
+            continue;
+        }
 
-        for (int i = 0; i < j; i++)
+        if (n == capacity)
         {
-            if (ps[i].priority == priority)
+            capacity = capacity > 0 ? 2 * capacity : 1024;
+            process *grown = realloc(*ps, capacity * sizeof(process));
+            if (grown == NULL)
             {
-                flag = 1;
                 break;
             }
+            *ps = grown;
         }
 
-        if (flag == 0)
+        process *p = &(*ps)[n];
+        *p = read;
+        p->id = n + 1;
+        p->tickets[0] = n == 0 ? 1 : (*ps)[n - 1].tickets[1] + 1;
+        p->tickets[1] = p->tickets[0] + generate_random_number(ctx, 0, 19);
+        n++;
+    }
+    fclose(fptr);
+
+    if (n == 0)
+    {
+        free(*ps);
+        *ps = NULL;
+    }
+    return n;
+}
+
+// one line of a workload file : at bt [priority [period [executions [quantum [cpu_burst io_wait]]]]].
+// Returns 0 for a comment or a line without at and bt, the id and tickets are left to the caller.
+int read_process(char *line, process *p)
+{
+    // leading numbers of the line, as sscanf would read them but without parsing a format per line
+    int values[8];
+    int count = 0;
+    for (char *next = line, *end; count < 8; next = end)
+    {
+        long value = strtol(next, &end, 10);
+        if (end == next)
         {
-            ps[j].priority = priority;
-            // printf("\nProcess %d Priority: %d", ps[j].id, priority);
-            priority_given++;
-            j++;
+            break;
         }
+        values[count++] = (int)value;
     }
-}
\ No newline at end of file
+    if (count < 2 || line[0] == '#')
+    {
+        return 0;
+    }
+    p->at = values[0];
+    p->bt = values[1];
+    p->priority = count >= 3 ? values[2] : 1;
+    // without a period every process runs once, due one burst after its arrival
+    p->period = count >= 4 ? values[3] : p->bt;
+    p->no_of_execution = count >= 5 ? values[4] : 1;
+    p->quantum = count >= 6 && values[5] > 0 ? values[5] : 0;
+    p->cpu_burst = count >= 8 && values[6] > 0 ? values[6] : 0;
+    p->io_wait = count >= 8 && values[7] > 0 ? values[7] : 0;
+    p->ct = 0;
+    p->wt = 0;
+    p->tat = 0;
+    p->rt = -1;
+    return 1;
+}
+
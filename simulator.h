@@ -0,0 +1,177 @@
+// OS PROJECT
+// Embeddable interface of the scheduling simulator
+
+// Build the library by compiling simulator.c without its main :
+//   gcc -O2 -c -DSIMULATOR_NO_MAIN simulator.c -o simulator.o
+// then include this header and link simulator.o (and -lm) into the program.
+// The workload comes in as columns the caller owns and results are written into
+// arrays the caller owns, nothing is printed and no text has to be parsed.
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SIM_API_VERSION 4
+
+// Names the simulated numbers this build produces. Change it with any change that moves a
+// result, cached results written under another tag are then ignored.
+#define SIM_VERSION_TAG "sim-2026.10-3"
+
+// policies, the same index the simulator uses in its results
+#define SIM_RR 0
+#define SIM_PRIORITY 1
+#define SIM_LOTTERY 2
+#define SIM_FCFS 3
+#define SIM_SJF 4
+#define SIM_SRTN 5
+#define SIM_HRRN 6
+#define SIM_EDF 7
+#define SIM_POLICIES 8
+
+// what sim_run returns
+#define SIM_OK 0
+#define SIM_ERROR_ARGUMENT -1 // unknown policy, negative count, missing column or a bad value in a column
+#define SIM_ERROR_MEMORY -2   // the context could not allocate the memory of the run
+
+typedef struct sim_context sim_context;
+typedef struct sim_checkpoints sim_checkpoints; // snapshots of a baseline run, see sim_run_baseline
+
+// Row i of every column describes process i. Only at and bt are required,
+// a NULL column takes the default written next to it.
+struct sim_workload
+{
+    int n;                 // no. of processes
+    const int *id;         // NULL : i + 1
+    const int *at;         // arrival time (>= 0), first release for EDF
+    const int *bt;         // burst time (> 0)
+    const int *priority;   // NULL : 1, smaller number runs first
+    const int *tickets;    // NULL : 1 ticket each (Lottery)
+    const int *period;     // NULL : bt, deadline of a job is its release + period (EDF)
+    const int *executions; // NULL : 1, jobs released per process (EDF)
+    const int *quantum;    // NULL or a value below 1 : the run's time_quantum, RR and Lottery (weighted RR)
+    const int *cpu_burst;  // NULL : 0, cpu time between I/O requests, 0 (or >= bt) : bt in one go
+    const int *io_wait;    // NULL : 0, device time of each I/O request, 0 : no I/O
+};
+typedef struct sim_workload sim_workload;
+
+struct sim_params
+{
+    int algorithm;    // SIM_RR ... SIM_EDF
+    int time_quantum; // RR and Lottery, values below 1 count as 1
+};
+typedef struct sim_params sim_params;
+
+struct sim_summary
+{
+    int completed;          // jobs completed (every EDF release is a job)
+    int makespan;           // completion time of the last job
+    double awt;             // average waiting-time
+    double att;             // average turn-around time
+    double art;             // average response time
+    double wt_p95;          // 95th percentile of waiting-time
+    double tat_p95;         // 95th percentile of turn-around time
+    double rt_p95;          // 95th percentile of response time
+    int context_switch;     // context-switches
+    long long decisions;    // times the scheduler picked a process to run
+    double throughput;      // jobs completed per unit time
+    double cpu_utilization; // busy time / makespan
+    double io_utilization;  // time the I/O device was serving / makespan
+    double burst_wait;      // average wait of an I/O-bound process from a served request to the cpu
+    double burst_wait_p95;  // 95th percentile of that wait
+    int overhead_time;      // time the cpu spent on context-switches and cache warmup (sim_set_switch_cost)
+    double overhead_share;  // overhead_time / makespan
+};
+typedef struct sim_summary sim_summary;
+
+// Arrays of n entries the caller owns, NULL when a column is not wanted.
+// EDF writes the average over the jobs of a process and the ct of its last job.
+struct sim_output
+{
+    int *ct;     // completion time
+    double *wt;  // waiting time
+    double *tat; // turn-around time
+    double *rt;  // response time
+    sim_summary summary;
+};
+typedef struct sim_output sim_output;
+
+// Queueing-theory answers fitted to a workload instead of simulated : arrivals are taken as
+// Poisson at the observed rate, bursts as independent draws from the observed ones.
+// The times compare with the simulated averages of FCFS, RR and SRTN.
+struct sim_estimate
+{
+    int stable;           // 0 when utilization >= 1, the queues grow without bound and the times are infinite
+    double arrival_rate;  // processes per unit time
+    double mean_burst;    // E[S]
+    double burst_moment2; // E[S^2]
+    double utilization;   // arrival_rate * mean_burst
+    double fcfs_wt;       // M/G/1 FCFS (Pollaczek-Khinchine)
+    double fcfs_tat;      // fcfs_wt + mean_burst
+    double ps_wt;         // processor sharing, RR as its quantum goes to 0
+    double ps_tat;        // mean_burst / (1 - utilization)
+    double srpt_wt;       // shortest remaining processing time first (Schrage-Miller), SRTN
+    double srpt_tat;      // srpt_wt + mean_burst
+};
+typedef struct sim_estimate sim_estimate;
+
+// what sim_run_whatif simulated itself, the rest of the outcome was taken from the baseline
+struct sim_whatif_info
+{
+    int changed;      // processes that differ from the baseline, -1 : not compared (a full run)
+    int resumed_at;   // time the run started from, 0 : from the start
+    int converged_at; // time from which the schedule was the baseline's again, -1 : simulated to the end
+};
+typedef struct sim_whatif_info sim_whatif_info;
+
+// a context with default settings, NULL when out of memory. One context runs one
+// simulation at a time, separate contexts can be used from separate threads.
+sim_context *sim_create(void);
+void sim_destroy(sim_context *ctx);
+void sim_seed(sim_context *ctx, unsigned long long seed); // Lottery draws from the context's generator
+void sim_set_threads(sim_context *ctx, int threads);      // FCFS may split a run over threads (-DSIM_PTHREADS=1)
+
+// charges dispatching on the simulated timeline : a context-switch takes switch_cost, and a process
+// getting the cpu loses warmup_cost * (time since it last ran) / warmup_time refilling its caches,
+// all of warmup_cost past warmup_time or on its first run. 0, 0, 0 (the default) : dispatching is free.
+void sim_set_switch_cost(sim_context *ctx, int switch_cost, int warmup_cost, int warmup_time);
+
+// keeps results in dir (created if missing, NULL or "" turns the cache off) keyed by a hash of
+// the workload, the params, the seed and SIM_VERSION_TAG. A repeated run reads its result back.
+// per_process 0 stores only the summary, sim_output arrays then stay untouched on a hit.
+int sim_set_cache(sim_context *ctx, const char *dir, int per_process);
+
+// writes a binary trace of every later run to path (see trace_export.c), NULL or "" turns it off
+int sim_set_trace(sim_context *ctx, const char *path);
+
+// simulates one policy over the workload, SIM_OK or a SIM_ERROR_ code. The tickets of all the
+// processes together must stay below INT_MAX. A context keeps its own copy of the last workload
+// and reuses it when a run gets the same column pointers again, so columns changed in place since
+// need a sim_reload first. The same goes for sim_run_baseline, sim_run_whatif and sim_analyze.
+int sim_run(sim_context *ctx, const sim_workload *w, const sim_params *params, sim_output *out);
+void sim_reload(sim_context *ctx); // the next run copies its columns again
+const char *sim_policy_name(int algorithm); // NULL for an unknown policy
+
+// Incremental what-if runs : sim_run_baseline runs like sim_run and keeps snapshots of the run
+// every interval arrivals (0 : a default). sim_run_whatif runs the same policy over a changed
+// copy of the workload, resuming from the last snapshot before the first change and stopping
+// once its schedule matches the baseline again. Its outcome is the one sim_run gives, averages
+// may differ in the last digits. EDF and Lottery what-if runs always start from time 0.
+// A baseline is only read by sim_run_whatif and can serve many contexts at once.
+int sim_run_baseline(sim_context *ctx, const sim_workload *w, const sim_params *params, int interval,
+                     sim_checkpoints **baseline, sim_output *out);
+int sim_run_whatif(sim_context *ctx, const sim_checkpoints *baseline, const sim_workload *w, sim_output *out,
+                   sim_whatif_info *info);
+void sim_checkpoints_free(sim_checkpoints *baseline);
+
+// fits and evaluates the models in O(n log n) without running a policy, SIM_OK or a SIM_ERROR_ code
+int sim_analyze(sim_context *ctx, const sim_workload *w, sim_estimate *est);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
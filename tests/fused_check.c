@@ -0,0 +1,193 @@
+// Regression check of the fused runs of simulator.c
+// A fused run steps every policy over the same arrivals, a lane each. Random workloads (arrivals
+// in bursts, ties, I/O bursts, idle gaps) are streamed through a run fusing every policy and through
+// runs of a single policy, fed in batches of random sizes, and every policy has to write the same
+// completion and metrics records in both (the fused ones naming their policy). Workloads are also
+// replayed packed through all the lanes but Lottery's at once, and every policy's results have to
+// be those of a run over the workload itself.
+//
+// Fused runs are internal to the simulator, so this includes simulator.c instead of linking it :
+// gcc -O2 -I. tests/fused_check.c -o fused_check -lm
+// gcc -O2 -I. -DSIM_PTHREADS=1 -pthread tests/fused_check.c -o fused_check -lm (a thread per lane)
+// ./fused_check [workloads]
+//
+// workloads : random workloads (default 100). The exit code is 1 on a difference.
+
+#define SIMULATOR_NO_MAIN
+#include "../simulator.c"
+
+#define CHECK_PROCESSES 3000
+
+unsigned int check_seed = 49;
+
+int check_random(int bound)
+{
+    check_seed = check_seed * 1103515245u + 12345u;
+    return (int)((check_seed >> 16) % (unsigned int)bound);
+}
+
+void check_workload(process *ps, int n)
+{
+    int at = 0;
+    int gap = 1 + check_random(12);
+    for (int i = 0; i < n; i++)
+    {
+        process *p = &ps[i];
+        memset(p, 0, sizeof(process));
+        p->id = i + 1;
+        at += check_random(20) == 0 ? check_random(200) : check_random(gap); // now and then the cpu idles
+        p->at = at;
+        p->bt = 1 + check_random(check_random(4) == 0 ? 60 : 10);
+        p->priority = check_random(10);
+        p->period = p->bt + check_random(30);
+        p->no_of_execution = 1;
+        p->quantum = check_random(3);
+        p->cpu_burst = check_random(4) == 0 ? 1 + check_random(p->bt) : 0;
+        p->io_wait = p->cpu_burst > 0 ? 1 + check_random(6) : 0;
+        p->tickets[0] = 1;
+        p->tickets[1] = 1 + check_random(20);
+        p->rt = -1;
+    }
+}
+
+// streams ps through a fused run of the k algorithms, records to out
+int check_stream(sim_context *ctx, const int *algorithms, int k, const process *ps, int n, int quantum, int every,
+                 FILE *out)
+{
+    fused_run f;
+    int ok = fused_open(&f, ctx, algorithms, k, quantum, out, 1, every);
+    int i = 0;
+    while (ok && i < n)
+    {
+        int count = 1 + check_random(FUSE_BATCH);
+        count = count > n - i ? n - i : count;
+        memcpy(f.filling, ps + i, count * sizeof(process));
+        fused_feed(&f, count);
+        i += count;
+    }
+    ok = ok && fused_finish(&f);
+    fused_close(&f);
+    return ok;
+}
+
+// 1 when the records of policy name in fused, its column taken out, are the lines of single
+int check_records(FILE *fused, FILE *single, const char *name)
+{
+    char line[512], other[512];
+    size_t length = strlen(name);
+    rewind(fused);
+    rewind(single);
+    while (fgets(line, sizeof(line), fused) != NULL)
+    {
+        char *column = strchr(line, ',');
+        if (column == NULL || strncmp(column + 1, name, length) != 0 || column[1 + length] != ',')
+        {
+            continue;
+        }
+        memmove(column, column + 1 + length, strlen(column + 1 + length) + 1);
+        if (fgets(other, sizeof(other), single) == NULL || strcmp(line, other) != 0)
+        {
+            printf("\n%s : fused \"%.60s\", alone \"%.60s\"", name, line, other);
+            return 0;
+        }
+    }
+    return fgets(other, sizeof(other), single) == NULL;
+}
+
+int same_result(result *x, result *y)
+{
+    return x->awt == y->awt && x->att == y->att && x->art == y->art && x->context_switch == y->context_switch &&
+           x->throughput == y->throughput && x->busy_time == y->busy_time && x->idle_time == y->idle_time &&
+           x->wt_stats.count == y->wt_stats.count && x->wt_stats.max == y->wt_stats.max &&
+           stats_percentile(&x->wt_stats, 99) == stats_percentile(&y->wt_stats, 99) &&
+           stats_percentile(&x->rt_stats, 50) == stats_percentile(&y->rt_stats, 50);
+}
+
+int main(int argc, char *argv[])
+{
+    int workloads = argc > 1 ? atoi(argv[1]) : 100;
+    process *ps = malloc(CHECK_PROCESSES * sizeof(process));
+    sim_context *ctx = sim_create(), *direct = sim_create();
+    FILE *fused = tmpfile(), *single = tmpfile();
+    if (ps == NULL || ctx == NULL || direct == NULL || fused == NULL || single == NULL)
+    {
+        printf("\nOut of memory");
+        return 1;
+    }
+    direct->track_series = 0;
+    int all[8] = {0, 1, 2, 3, 4, 5, 6, 7}, packed[7], no_of_packed = 0;
+    for (int a = 0; a < 8; a++)
+    {
+        if (a != LOTTERY_POLICY.algorithm)
+        {
+            packed[no_of_packed++] = a; // Lottery draws differently when streamed
+        }
+    }
+    long long processes = 0;
+    int bad = 0;
+
+    for (int k = 0; k < workloads && bad == 0; k++)
+    {
+        int n = k % 10 == 0 ? check_random(3) : 1 + check_random(CHECK_PROCESSES);
+        int quantum = 1 + k % 4;
+        int every = k % 3 == 0 ? 0 : 1 + check_random(500);
+        check_workload(ps, n);
+        processes += n;
+        sim_seed(ctx, k);
+        sim_set_switch_cost(ctx, k % 2, k % 5 == 0 ? 2 : 0, k % 5 == 0 ? 10 : 0);
+        sim_set_switch_cost(direct, k % 2, k % 5 == 0 ? 2 : 0, k % 5 == 0 ? 10 : 0);
+
+        // every policy fused, against a run of each alone
+        fused = freopen(NULL, "w+", fused);
+        int ok = fused != NULL && check_stream(ctx, all, 8, ps, n, quantum, every, fused);
+        for (int a = 0; ok && bad == 0 && a < 8; a++)
+        {
+            single = freopen(NULL, "w+", single);
+            ok = single != NULL && check_stream(ctx, &a, 1, ps, n, quantum, every, single);
+            if (ok && !check_records(fused, single, algorithm_names[a]))
+            {
+                printf("\nworkload %d (%d processes, quantum %d, metrics every %d) : %s streams other records fused", k,
+                       n, quantum, every, algorithm_names[a]);
+                bad++;
+            }
+        }
+
+        // packed through the lanes at once, against the runs over the workload
+        packed_workload w = {0};
+        for (int i = 0; ok && i < n; i++)
+        {
+            ok = pack_add(&w, &ps[i]);
+        }
+        ok = ok && pack_flush(&w);
+        initialize_final_result(ctx->final_result);
+        ok = ok && run_packed(ctx, packed, no_of_packed, &w, quantum);
+        for (int l = 0; ok && bad == 0 && l < no_of_packed; l++)
+        {
+            int a = packed[l];
+            sim_seed(direct, k);
+            initialize_final_result(direct->final_result);
+            ok = run_policy(direct, ps, n, quantum, policies[a], simulators[a]);
+            if (ok && !same_result(&direct->final_result[a], &ctx->final_result[a]))
+            {
+                printf("\nworkload %d (%d processes) : %s awt %f from the workload, %f fused", k, n, algorithm_names[a],
+                       direct->final_result[a].awt, ctx->final_result[a].awt);
+                bad++;
+            }
+        }
+        free(w.blocks);
+        free(w.words);
+        if (!ok)
+        {
+            printf("\nOut of memory");
+            return 1;
+        }
+    }
+
+    printf("\n%d workloads, %lld processes, %s\n", workloads, processes, bad ? "a workload differs" : "all the same");
+    fclose(fused);
+    fclose(single);
+    free(ps);
+    sim_destroy(ctx);
+    sim_destroy(direct);
+    return bad > 0;
+}
@@ -0,0 +1,285 @@
+// Regression check of the trace import of workload_tools.c
+// The traces in tests/data (an ftrace text trace and the same schedule as perf script prints it)
+// have to import to the workloads next to them. Random traces of 4 cpus are then generated along
+// with the jobs they hold : a task's job starts with its wakeup, collects the cpu time of its
+// slices (a preempted task stays runnable) and ends when it leaves the cpu asleep, the trace end
+// closes the jobs that ran. Every trace is imported with blocks of 4 KB on 1 to 4 threads, in
+// microseconds and in coarser units, and has to give exactly those jobs.
+//
+// gcc -O2 -I. tests/import_check.c -o import_check
+// gcc -O2 -I. -DSIM_PTHREADS=1 -pthread tests/import_check.c -o import_check (threaded)
+// ./import_check [traces] [data directory]
+//
+// traces : random traces (default 100), data directory : where the fixtures are (default tests/data).
+// Traces and workloads go to the current directory as import_check.*, and are removed.
+// The exit code is 1 when an import differs.
+
+#define IMPORT_BLOCK 4096 // many blocks, lines cut at every place
+#define WORKLOAD_TOOLS_NO_MAIN
+#include "../workload_tools.c"
+
+#define CHECK_CPUS 4
+#define CHECK_TASKS 400
+#define CHECK_FIRST_PID 1000
+
+unsigned int check_seed = 48;
+
+int check_random(int bound)
+{
+    check_seed = check_seed * 1103515245u + 12345u;
+    return (int)((check_seed >> 16) % (unsigned int)bound);
+}
+
+struct check_task
+{
+    long long arrival;   // wakeup of the job in progress, -1 : asleep
+    long long run_start; // -1 : not on a cpu
+    long long cpu;
+};
+typedef struct check_task check_task;
+
+// 1 when the two files hold the same bytes
+int check_same(const char *path, const char *other)
+{
+    FILE *x = fopen(path, "rb"), *y = fopen(other, "rb");
+    int same = x != NULL && y != NULL;
+    while (same)
+    {
+        int a = fgetc(x), b = fgetc(y);
+        same = a == b;
+        if (a == EOF)
+        {
+            break;
+        }
+    }
+    if (x != NULL)
+    {
+        fclose(x);
+    }
+    if (y != NULL)
+    {
+        fclose(y);
+    }
+    return same;
+}
+
+// imports trace into import_check.out, 1 when that is the workload in expected
+int check_import(const char *trace, const char *expected, int threads, int unit)
+{
+    FILE *in = fopen(trace, "r"), *out = fopen("import_check.out", "w");
+    import_state s = {0};
+    s.start = -1;
+    int ok = in != NULL && out != NULL && import_trace(in, out, threads, unit, &s) == 1;
+    if (in != NULL)
+    {
+        fclose(in);
+    }
+    if (out != NULL && fclose(out) != 0)
+    {
+        ok = 0;
+    }
+    free(s.tasks);
+    free(s.jobs);
+    return ok && check_same("import_check.out", expected);
+}
+
+// a task as the trace names it : "comm=task 1000 pid=1000 prio=140" or "task 1000:1000 [140]"
+void check_wakeup(FILE *fptr, int style, int cpu, long long t, int pid)
+{
+    if (style == 0)
+    {
+        fprintf(fptr, "          <idle>-0       [%03d] dNh3.  %lld.%06lld: sched_wakeup: comm=task %d pid=%d prio=%d target_cpu=%03d\n",
+                cpu, t / 1000000, t % 1000000, pid, pid, 100 + pid % 40, cpu);
+    }
+    else
+    {
+        fprintf(fptr, "         swapper     0 [%03d]  %lld.%06lld:       sched:sched_wakeup: task %d:%d [%d] CPU:%03d\n", cpu,
+                t / 1000000, t % 1000000, pid, pid, 100 + pid % 40, cpu);
+    }
+}
+
+void check_switch(FILE *fptr, int style, int cpu, long long t, int prev, const char *state, int next)
+{
+    int prev_prio = prev > 0 ? 100 + prev % 40 : 120, next_prio = next > 0 ? 100 + next % 40 : 120;
+    if (style == 0)
+    {
+        fprintf(fptr, "          task-%d     [%03d] d..2.  %lld.%06lld: sched_switch: prev_comm=task %d prev_pid=%d "
+                      "prev_prio=%d prev_state=%s ==> next_comm=task %d next_pid=%d next_prio=%d\n",
+                prev, cpu, t / 1000000, t % 1000000, prev, prev, prev_prio, state, next, next, next_prio);
+    }
+    else
+    {
+        fprintf(fptr, "            task %5d [%03d]  %lld.%06lld:       sched:sched_switch: task %d:%d [%d] %s ==> task %d:%d [%d]\n",
+                prev, cpu, t / 1000000, t % 1000000, prev, prev, prev_prio, state, next, next, next_prio);
+    }
+}
+
+// writes a random trace of records and the workload it holds in units of unit, as the import writes it
+void check_trace(const char *trace, const char *expected, int records, int unit)
+{
+    check_task tasks[CHECK_TASKS];
+    int running[CHECK_CPUS] = {0}; // pid on every cpu, 0 : idle
+    int queue[CHECK_TASKS], queued = 0; // runnable tasks, oldest first
+    long long *jobs = malloc((2 * records + CHECK_TASKS + 1) * 3 * sizeof(long long)); // at bt prio of every job
+    int no_of_jobs = 0;
+    FILE *fptr = fopen(trace, "w");
+    if (jobs == NULL || fptr == NULL)
+    {
+        printf("\nCould not write %s", trace);
+        exit(1);
+    }
+    for (int k = 0; k < CHECK_TASKS; k++)
+    {
+        tasks[k] = (check_task){-1, -1, 0};
+    }
+
+    int style = check_random(3); // 0 : ftrace, 1 : perf script, 2 : both line by line
+    long long t = 5000000000LL + check_random(1000000), start = -1, last = -1;
+    for (int r = 0; r < records; r++)
+    {
+        t += check_random(20);
+        int cpu = check_random(CHECK_CPUS);
+        int line_style = style == 2 ? check_random(2) : style;
+        int sleeper = check_random(CHECK_TASKS);
+        if (tasks[sleeper].arrival == -1 && check_random(100) < 45)
+        {
+            // a wakeup of an asleep task starts its job
+            int pid = CHECK_FIRST_PID + sleeper;
+            tasks[sleeper].arrival = t;
+            queue[queued++] = sleeper;
+            check_wakeup(fptr, line_style, cpu, t, pid);
+        }
+        else
+        {
+            int prev = running[cpu];
+            int next = queued > 0 ? queue[0] : -1;
+            if (prev == 0 && next == -1)
+            {
+                fprintf(fptr, "          <idle>-0       [%03d] d..3.  %lld.%06lld: sched_stat_runtime: nothing to run\n",
+                        cpu, t / 1000000, t % 1000000);
+                continue;
+            }
+            if (next != -1)
+            {
+                memmove(queue, queue + 1, --queued * sizeof(int));
+            }
+            const char *state = "R";
+            if (prev > 0)
+            {
+                check_task *task = &tasks[prev - CHECK_FIRST_PID];
+                task->cpu += t - task->run_start;
+                task->run_start = -1;
+                if (check_random(10) < 6)
+                {
+                    state = check_random(2) ? "S" : "D";
+                    if (task->cpu > 0)
+                    {
+                        jobs[3 * no_of_jobs] = task->arrival;
+                        jobs[3 * no_of_jobs + 1] = task->cpu;
+                        jobs[3 * no_of_jobs + 2] = 100 + prev % 40;
+                        no_of_jobs++;
+                    }
+                    task->arrival = -1;
+                    task->cpu = 0;
+                }
+                else
+                {
+                    state = "R+"; // preempted, its job goes on
+                    queue[queued++] = prev - CHECK_FIRST_PID;
+                }
+            }
+            int next_pid = next != -1 ? CHECK_FIRST_PID + next : 0;
+            if (next != -1)
+            {
+                tasks[next].run_start = t;
+            }
+            running[cpu] = next_pid;
+            check_switch(fptr, line_style, cpu, t, prev, state, next_pid);
+        }
+        start = start == -1 ? t : start;
+        last = t;
+    }
+    fclose(fptr);
+
+    // the trace end closes the jobs that ran, by pid
+    for (int k = 0; k < CHECK_TASKS; k++)
+    {
+        check_task *task = &tasks[k];
+        if (task->arrival != -1)
+        {
+            long long cpu = task->cpu + (task->run_start != -1 ? last - task->run_start : 0);
+            if (cpu > 0)
+            {
+                jobs[3 * no_of_jobs] = task->arrival;
+                jobs[3 * no_of_jobs + 1] = cpu;
+                jobs[3 * no_of_jobs + 2] = 100 + (CHECK_FIRST_PID + k) % 40;
+                no_of_jobs++;
+            }
+        }
+    }
+
+    // arrival order, a tie in the order the jobs ended
+    unsigned long long *keys = malloc((no_of_jobs > 0 ? no_of_jobs : 1) * sizeof(unsigned long long));
+    FILE *out = fopen(expected, "w");
+    if (keys == NULL || out == NULL)
+    {
+        printf("\nCould not write %s", expected);
+        exit(1);
+    }
+    for (int j = 0; j < no_of_jobs; j++)
+    {
+        keys[j] = (unsigned long long)((jobs[3 * j] - start) / unit) << 32 | (unsigned int)j;
+    }
+    qsort(keys, no_of_jobs, sizeof(unsigned long long), compare_key);
+    for (int k = 0; k < no_of_jobs; k++)
+    {
+        long long *job = &jobs[3 * (keys[k] & 0xFFFFFFFFu)];
+        long long bt = (job[1] + unit / 2) / unit;
+        fprintf(out, "%lld %lld %lld\n", (job[0] - start) / unit, bt < 1 ? 1 : bt, job[2]);
+    }
+    fclose(out);
+    free(keys);
+    free(jobs);
+}
+
+int main(int argc, char *argv[])
+{
+    int traces = argc > 1 ? atoi(argv[1]) : 100;
+    const char *data = argc > 2 ? argv[2] : "tests/data";
+    const char *fixtures[2] = {"ftrace_sched", "perf_sched"};
+    int bad = 0;
+
+    for (int k = 0; k < 2; k++)
+    {
+        char trace[300], expected[300];
+        snprintf(trace, sizeof(trace), "%s/%s.txt", data, fixtures[k]);
+        snprintf(expected, sizeof(expected), "%s/%s.workload", data, fixtures[k]);
+        for (int threads = 1; threads <= 2; threads++)
+        {
+            if (!check_import(trace, expected, threads, 1))
+            {
+                printf("\n%s does not import to %s", trace, expected);
+                bad++;
+            }
+        }
+    }
+
+    for (int k = 0; k < traces; k++)
+    {
+        int records = k % 10 == 0 ? check_random(4) : check_random(20000);
+        int unit = k % 4 == 3 ? 1 + check_random(50) : 1;
+        int threads = 1 + k % 4;
+        check_trace("import_check.trace", "import_check.expected", records, unit);
+        if (!check_import("import_check.trace", "import_check.expected", threads, unit))
+        {
+            printf("\ntrace %d (%d records, unit %d, %d threads) imports to other jobs", k, records, unit, threads);
+            bad++;
+        }
+    }
+    remove("import_check.trace");
+    remove("import_check.expected");
+    remove("import_check.out");
+
+    printf("\n2 fixtures and %d random traces, %d differ\n", traces, bad);
+    return bad > 0;
+}
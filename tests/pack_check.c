@@ -0,0 +1,167 @@
+// Regression check of the packed workloads of simulator.c
+// Random workloads in arrival order are packed and every block decoded back, column by column,
+// with values of every width (constant columns, full 32-bit ranges, gaps between arrivals up to
+// INT_MAX). Smaller workloads are then replayed from their packed form by every policy but Lottery,
+// which draws differently when streamed, and the results have to be the ones of a run over the
+// workload itself.
+//
+// Packing is internal to the simulator, so this includes simulator.c instead of linking it :
+// gcc -O2 -I. tests/pack_check.c -o pack_check -lm
+// ./pack_check [workloads]
+//
+// workloads : random workloads to pack (default 300). The exit code is 1 on a difference.
+
+#define SIMULATOR_NO_MAIN
+#include "../simulator.c"
+
+#define CHECK_PROCESSES 5000
+
+unsigned int check_seed = 47;
+
+int check_random(int bound)
+{
+    check_seed = check_seed * 1103515245u + 12345u;
+    return (int)((check_seed >> 16) % (unsigned int)bound);
+}
+
+// a value of about bits bits, any int when bits is 32
+int check_value(int bits)
+{
+    unsigned int v = (unsigned int)check_random(1 << 16) << 16 | (unsigned int)check_random(1 << 16);
+    return bits >= 32 ? (int)v : (int)(v & ((1u << bits) - 1));
+}
+
+// n processes in arrival order, every column drawn with a width of its own
+void check_workload(process *ps, int n, int simulated)
+{
+    int width[PACK_COLUMNS];
+    for (int c = 0; c < PACK_COLUMNS; c++)
+    {
+        width[c] = simulated ? 1 + check_random(4) : check_random(33);
+    }
+    int gap = simulated ? 1 + check_random(8) : 1 + check_random(1 << 20);
+    int at = 0;
+    for (int i = 0; i < n; i++)
+    {
+        process *p = &ps[i];
+        memset(p, 0, sizeof(process));
+        p->id = i + 1;
+        int step = check_random(gap);
+        at = at > INT_MAX - step ? INT_MAX : at + step;
+        p->at = at;
+        p->bt = 1 + check_value(simulated ? 3 + width[1] : width[1] > 30 ? 30 : width[1]);
+        p->priority = check_value(width[2]);
+        p->period = p->bt + (simulated ? 0 : check_value(width[3] > 30 ? 30 : width[3]));
+        p->no_of_execution = 1 + (simulated ? 0 : check_value(width[4] > 30 ? 30 : width[4]));
+        p->quantum = simulated ? check_random(3) : check_value(width[5] > 30 ? 30 : width[5]);
+        p->cpu_burst = simulated && width[6] > 2 ? 1 + check_random(p->bt) : simulated ? 0 : check_value(width[6]);
+        p->io_wait = p->cpu_burst > 0 ? 1 + check_random(simulated ? 6 : INT_MAX) : 0;
+        p->tickets[0] = 1;
+        p->tickets[1] = 1 + check_value(width[8] > 30 ? 30 : width[8]);
+        p->rt = -1;
+    }
+}
+
+// 1 when every block decodes to the processes packed into it
+int check_decode(const packed_workload *w, const process *ps, int n)
+{
+    process rows[PACK_BLOCK];
+    for (int b = 0; b < w->no_of_blocks; b++)
+    {
+        pack_decode(w, b, rows);
+        for (int j = 0; j < PACK_BLOCK && b * PACK_BLOCK + j < n; j++)
+        {
+            const process *p = &ps[b * PACK_BLOCK + j], *q = &rows[j];
+            if (p->id != q->id || p->at != q->at || p->bt != q->bt || p->priority != q->priority ||
+                p->period != q->period || p->no_of_execution != q->no_of_execution || p->quantum != q->quantum ||
+                p->cpu_burst != q->cpu_burst || p->io_wait != q->io_wait || process_tickets(p) != process_tickets(q))
+            {
+                printf("\nprocess %d of %d decodes as at %d bt %d priority %d, packed at %d bt %d priority %d", p->id, n,
+                       q->at, q->bt, q->priority, p->at, p->bt, p->priority);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int same_result(result *x, result *y)
+{
+    return x->awt == y->awt && x->att == y->att && x->art == y->art && x->context_switch == y->context_switch &&
+           x->throughput == y->throughput && x->busy_time == y->busy_time && x->idle_time == y->idle_time &&
+           x->wt_stats.count == y->wt_stats.count && x->wt_stats.max == y->wt_stats.max &&
+           stats_percentile(&x->wt_stats, 99) == stats_percentile(&y->wt_stats, 99) &&
+           stats_percentile(&x->rt_stats, 50) == stats_percentile(&y->rt_stats, 50);
+}
+
+int main(int argc, char *argv[])
+{
+    int workloads = argc > 1 ? atoi(argv[1]) : 300;
+    process *ps = malloc(CHECK_PROCESSES * sizeof(process));
+    sim_context *direct = sim_create(), *packed = sim_create();
+    if (ps == NULL || direct == NULL || packed == NULL)
+    {
+        printf("\nOut of memory");
+        return 1;
+    }
+    direct->track_series = 0;
+    long long processes = 0, words = 0, runs = 0;
+    int bad = 0;
+
+    for (int k = 0; k < workloads && bad == 0; k++)
+    {
+        int simulated = k % 2;
+        int n = simulated ? 1 + check_random(400) : check_random(CHECK_PROCESSES + 1);
+        check_workload(ps, n, simulated);
+
+        packed_workload w = {0};
+        int ok = 1;
+        for (int i = 0; ok && i < n; i++)
+        {
+            ok = pack_add(&w, &ps[i]);
+        }
+        if (!ok || !pack_flush(&w))
+        {
+            printf("\nOut of memory");
+            return 1;
+        }
+        bad += !check_decode(&w, ps, n);
+        processes += n;
+        words += w.no_of_words;
+
+        for (int a = 0; simulated && bad == 0 && a < 8; a++)
+        {
+            if (a == LOTTERY_POLICY.algorithm)
+            {
+                continue;
+            }
+            int quantum = 1 + k % 4;
+            sim_seed(direct, k);
+            sim_seed(packed, k);
+            initialize_final_result(direct->final_result);
+            initialize_final_result(packed->final_result);
+            if (!run_policy(direct, ps, n, quantum, policies[a], simulators[a]) ||
+                !run_packed(packed, &a, 1, &w, quantum))
+            {
+                printf("\nOut of memory");
+                return 1;
+            }
+            if (!same_result(&direct->final_result[a], &packed->final_result[a]))
+            {
+                printf("\nworkload %d (%d processes) : %s awt %f from the workload, %f packed", k, n, algorithm_names[a],
+                       direct->final_result[a].awt, packed->final_result[a].awt);
+                bad++;
+            }
+            runs++;
+        }
+        free(w.blocks);
+        free(w.words);
+    }
+
+    printf("\n%lld processes packed at %.2f bytes each, %lld packed runs, %s\n", processes,
+           processes > 0 ? 4.0 * words / processes : 0, runs, bad ? "a workload differs" : "all the same");
+    free(ps);
+    sim_destroy(direct);
+    sim_destroy(packed);
+    return bad > 0;
+}
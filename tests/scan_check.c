@@ -0,0 +1,96 @@
+// Regression check of the FCFS scan of simulator.c
+// FCFS runs without the event loop (fcfs_scan) whenever nothing needs the loop. Every workload
+// here runs both ways, the event loop being forced by tracking the time series, and the two have
+// to agree on every process and on the statistics. Some workloads come in shuffled (the scan
+// sorts them), a few large ones are split over threads when built with -DSIM_PTHREADS=1 -pthread.
+//
+// The scan is internal to the simulator, so this includes simulator.c instead of linking it :
+// gcc -O2 -I. tests/scan_check.c -o scan_check -lm
+// ./scan_check [workloads]
+//
+// workloads : small random workloads (default 2000), the exit code is 1 when one differs.
+
+#define SIMULATOR_NO_MAIN
+#include "../simulator.c"
+
+#define SHOWN 10 // the check stops after this many mismatches
+
+int close_to(double x, double y)
+{
+    return fabs(x - y) <= 1e-9 * (1 + fabs(y));
+}
+
+// 1 when the scan gives what the event loop gives
+int check(int n, int threads, int shuffle, unsigned int seed)
+{
+    sim_context *loop = sim_create(), *scan = sim_create();
+    process *ps = malloc((n > 0 ? n : 1) * sizeof(process));
+    if (loop == NULL || scan == NULL || ps == NULL)
+    {
+        printf("\nOut of memory");
+        exit(1);
+    }
+
+    sim_seed(loop, seed);
+    generate_workload(loop, ps, n, 0.5 + (seed % 10) * 0.1);
+    for (int i = 0; shuffle && i < n; i++)
+    {
+        int j = (int)(sim_random(loop) % n);
+        process p = ps[i];
+        ps[i] = ps[j];
+        ps[j] = p;
+    }
+
+    loop->track_series = 1; // keeps run_fresh on the event loop
+    scan->track_series = 0;
+    sim_set_threads(scan, threads);
+    initialize_final_result(loop->final_result);
+    initialize_final_result(scan->final_result);
+    if (!run_policy(loop, ps, n, 0, &FCFS_POLICY, simulate_fcfs) ||
+        !run_policy(scan, ps, n, 0, &FCFS_POLICY, simulate_fcfs))
+    {
+        printf("\nOut of memory");
+        exit(1);
+    }
+
+    int differ = 0;
+    for (int i = 0; i < n; i++)
+    {
+        differ += loop->state.ct[i] != scan->state.ct[i] || loop->state.wt[i] != scan->state.wt[i] ||
+                  loop->state.tat[i] != scan->state.tat[i] || loop->state.rt[i] != scan->state.rt[i];
+    }
+    result *x = &loop->final_result[FCFS_POLICY.algorithm], *y = &scan->final_result[FCFS_POLICY.algorithm];
+    int same = differ == 0 && x->context_switch == y->context_switch && x->decisions == y->decisions &&
+               x->busy_time == y->busy_time && x->idle_time == y->idle_time && close_to(x->awt, y->awt) &&
+               close_to(x->att, y->att) && close_to(x->art, y->art) && close_to(x->throughput, y->throughput) &&
+               close_to(x->cpu_utilization, y->cpu_utilization) &&
+               stats_percentile(&x->wt_stats, 99) == stats_percentile(&y->wt_stats, 99) &&
+               stats_percentile(&x->tat_stats, 50) == stats_percentile(&y->tat_stats, 50) &&
+               fabs(stats_stddev(&x->wt_stats) - stats_stddev(&y->wt_stats)) <= 1e-6 * (1 + stats_stddev(&x->wt_stats));
+    if (!same)
+    {
+        printf("\n%d processes (threads %d, shuffled %d, seed %u) : %d differ, awt %f / %f, idle %d / %d", n, threads,
+               shuffle, seed, differ, x->awt, y->awt, x->idle_time, y->idle_time);
+    }
+
+    free(ps);
+    sim_destroy(loop);
+    sim_destroy(scan);
+    return same;
+}
+
+int main(int argc, char *argv[])
+{
+    int workloads = argc > 1 ? atoi(argv[1]) : 2000;
+    int tried = 0, bad = 0;
+    for (int s = 1; s <= workloads && bad < SHOWN; s++, tried++)
+    {
+        bad += !check(1 + s % 50, 1, s % 3 == 0, s);
+    }
+    for (int s = 1; s <= 3 && bad < SHOWN; s++, tried++)
+    {
+        bad += !check(200000 + s, 1 + s, s % 2, s);
+    }
+    printf("\n%d workloads, %d differ\n", tried, bad);
+    return bad > 0;
+}
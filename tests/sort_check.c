@@ -0,0 +1,160 @@
+// Regression check of the external sort of workload_tools.c
+// Random workload files (comments, lines that are not a process, rows of 2 to 8 columns, negative
+// and equal arrivals) are sorted with budgets small enough to give many runs and several merge
+// passes, and compared with a stable sort of the same records done in memory : arrival time, then
+// the order the lines were read in, written in the workload file format.
+//
+// gcc -O2 -I. tests/sort_check.c -o sort_check
+// gcc -O2 -I. -DSIM_PTHREADS=1 -pthread tests/sort_check.c -o sort_check (threaded)
+// ./sort_check [files]
+//
+// files : random workload files to sort (default 40). The sort's runs and output go to the current
+// directory as sort_check.*, and are removed. The exit code is 1 when a sort differs.
+
+#define WORKLOAD_TOOLS_NO_MAIN
+#include "../workload_tools.c"
+
+unsigned int check_seed = 46;
+
+int check_random(int bound)
+{
+    check_seed = check_seed * 1103515245u + 12345u;
+    return (int)((check_seed >> 16) % (unsigned int)bound);
+}
+
+// the expected output, as the simulator's workload file format writes a record
+void check_line(FILE *fptr, const sort_record *record)
+{
+    const int *v = record->values;
+    fprintf(fptr, "%d %d %d %d %d %d %d %d\n", v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+}
+
+// writes a random workload of lines to input and the sorted processes to expected, the no. of processes
+int check_files(const char *input, const char *expected, int lines)
+{
+    FILE *in = fopen(input, "w");
+    sort_record *records = malloc((lines > 0 ? lines : 1) * sizeof(sort_record));
+    unsigned long long *keys = malloc((lines > 0 ? lines : 1) * sizeof(unsigned long long));
+    if (in == NULL || records == NULL || keys == NULL)
+    {
+        printf("\nCould not write %s", input);
+        exit(1);
+    }
+
+    int count = 0, spread = 1 + check_random(5000);
+    for (int i = 0; i < lines; i++)
+    {
+        char line[200];
+        int kind = check_random(100);
+        if (kind == 0)
+        {
+            snprintf(line, sizeof(line), "# %d comment\n", i);
+        }
+        else if (kind == 1)
+        {
+            snprintf(line, sizeof(line), "not a process\n");
+        }
+        else
+        {
+            int v[8] = {check_random(spread) - 20, 1 + check_random(50), check_random(10), check_random(80),
+                        1 + check_random(4), check_random(8) - 2, check_random(11) - 1, check_random(10)};
+            int columns = 2 + check_random(7);
+            int length = 0;
+            for (int c = 0; c < columns; c++)
+            {
+                length += snprintf(line + length, sizeof(line) - length, c > 0 ? " %d" : "%d", v[c]);
+            }
+            snprintf(line + length, sizeof(line) - length, "\n");
+        }
+        fputs(line, in);
+
+        line[strlen(line) - 1] = '\0';
+        if (sort_read(line, &records[count]))
+        {
+            unsigned int at = (unsigned int)records[count].values[0] ^ 0x80000000u;
+            keys[count] = (unsigned long long)at << 32 | (unsigned int)count;
+            count++;
+        }
+    }
+    fclose(in);
+
+    qsort(keys, count, sizeof(unsigned long long), compare_key);
+    FILE *out = fopen(expected, "w");
+    if (out == NULL)
+    {
+        printf("\nCould not write %s", expected);
+        exit(1);
+    }
+    for (int k = 0; k < count; k++)
+    {
+        check_line(out, &records[keys[k] & 0xFFFFFFFFu]);
+    }
+    fclose(out);
+    free(records);
+    free(keys);
+    return count;
+}
+
+// 1 when the two files hold the same bytes
+int check_same(const char *path, const char *other)
+{
+    FILE *x = fopen(path, "rb"), *y = fopen(other, "rb");
+    int same = x != NULL && y != NULL;
+    while (same)
+    {
+        int a = fgetc(x), b = fgetc(y);
+        same = a == b;
+        if (a == EOF)
+        {
+            break;
+        }
+    }
+    if (x != NULL)
+    {
+        fclose(x);
+    }
+    if (y != NULL)
+    {
+        fclose(y);
+    }
+    return same;
+}
+
+int main(int argc, char *argv[])
+{
+    int files = argc > 1 ? atoi(argv[1]) : 40;
+    long long sorted = 0;
+    int bad = 0;
+
+    for (int f = 0; f < files; f++)
+    {
+        int lines = f % 10 == 0 ? check_random(3) : 1 + check_random(60000);
+        int processes = check_files("sort_check.in", "sort_check.expected", lines);
+
+        // 64 KB : runs of 1024 records merged 2 at a time, 1 MB : 16 at a time
+        long long memory = f % 3 == 0 ? 64 << 10 : f % 3 == 1 ? 1 << 20 : (long long)SORT_DEFAULT_MEMORY << 20;
+        int threads = 1 + f % 3;
+        long long records, skipped;
+        FILE *in = fopen("sort_check.in", "r");
+        int ok = in != NULL && sort_workload(in, "sort_check.out", memory, threads, &records, &skipped);
+        if (in != NULL)
+        {
+            fclose(in);
+        }
+
+        if (!ok || records != processes || records + skipped != lines ||
+            !check_same("sort_check.out", "sort_check.expected"))
+        {
+            printf("\nfile %d (%d lines, budget %lld bytes, %d threads) : %s, %lld of %d processes", f, lines, memory,
+                   threads, ok ? "sorted differently" : "not sorted", records, processes);
+            bad++;
+        }
+        sorted += records;
+    }
+    remove("sort_check.in");
+    remove("sort_check.expected");
+    remove("sort_check.out");
+
+    printf("\n%d files, %lld processes sorted, %d differ\n", files, sorted, bad);
+    return bad > 0;
+}
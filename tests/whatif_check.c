@@ -0,0 +1,147 @@
+// Regression check of the incremental what-if runs of simulator.c
+// Every case runs a random workload as a baseline, changes a few processes of its second half
+// and runs the change with sim_run_whatif. The same changed workload then runs from scratch with
+// sim_run and both outcomes have to be the same : every process' ct, wt and rt, and the summary
+// (averages may differ in the last digits, see simulator.h).
+//
+// gcc -O2 -c -DSIMULATOR_NO_MAIN simulator.c -o simulator.o
+// gcc -O2 -I. tests/whatif_check.c simulator.o -o whatif_check -lm
+// ./whatif_check [cases]
+//
+// cases : random workloads to try (default 1500), every one runs under all 8 policies.
+// The exit code is 1 when a what-if run differs from the run from scratch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "simulator.h"
+
+#define MAX_PROCESSES 300
+#define SHOWN 10 // mismatches printed, the rest are only counted
+
+unsigned int check_seed = 5;
+
+int check_random(int bound)
+{
+    check_seed = check_seed * 1103515245u + 12345u;
+    return (int)((check_seed >> 16) % (unsigned int)bound);
+}
+
+int same_average(double x, double y)
+{
+    return fabs(x - y) <= 1e-9 * (1 + fabs(y));
+}
+
+int same_summary(const sim_summary *x, const sim_summary *y)
+{
+    return x->completed == y->completed && x->makespan == y->makespan && x->context_switch == y->context_switch &&
+           x->decisions == y->decisions && same_average(x->awt, y->awt) && same_average(x->att, y->att) &&
+           same_average(x->art, y->art) && x->wt_p95 == y->wt_p95 && x->tat_p95 == y->tat_p95 &&
+           x->rt_p95 == y->rt_p95 && same_average(x->throughput, y->throughput) &&
+           same_average(x->cpu_utilization, y->cpu_utilization);
+}
+
+int main(int argc, char *argv[])
+{
+    int cases = argc > 1 ? atoi(argv[1]) : 1500;
+    int at[MAX_PROCESSES], bt[MAX_PROCESSES], priority[MAX_PROCESSES];
+    int changed_at[MAX_PROCESSES], changed_bt[MAX_PROCESSES], changed_priority[MAX_PROCESSES];
+    int ct[2][MAX_PROCESSES];
+    double wt[2][MAX_PROCESSES], rt[2][MAX_PROCESSES];
+    int runs = 0, resumed = 0, converged = 0, bad = 0;
+
+    for (int c = 0; c < cases; c++)
+    {
+        int n = 1 + check_random(MAX_PROCESSES);
+        int t = 0, gap = 1 + check_random(6);
+        for (int i = 0; i < n; i++)
+        {
+            t += check_random(gap);
+            // some arrivals come out of order
+            at[i] = i > 0 && check_random(10) == 0 ? at[i - 1] + check_random(3) : t;
+            bt[i] = 1 + check_random(8);
+            priority[i] = check_random(5);
+        }
+        memcpy(changed_at, at, n * sizeof(int));
+        memcpy(changed_bt, bt, n * sizeof(int));
+        memcpy(changed_priority, priority, n * sizeof(int));
+
+        int changes = 1 + check_random(3);
+        for (int k = 0; k < changes; k++)
+        {
+            int j = n / 2 + check_random(n - n / 2);
+            switch (check_random(3))
+            {
+            case 0:
+                changed_bt[j] = 1 + check_random(8);
+                break;
+            case 1:
+                changed_priority[j] = check_random(5);
+                break;
+            default:
+                changed_at[j] = at[j] + check_random(5) - 2;
+                if (changed_at[j] < 0)
+                {
+                    changed_at[j] = 0;
+                }
+                break;
+            }
+        }
+
+        sim_workload original = {.n = n, .at = at, .bt = bt, .priority = priority};
+        sim_workload changed = {.n = n, .at = changed_at, .bt = changed_bt, .priority = changed_priority};
+        int interval = 1 + check_random(8);
+
+        for (int a = 0; a < SIM_POLICIES; a++)
+        {
+            sim_context *incremental = sim_create(), *scratch = sim_create();
+            if (incremental == NULL || scratch == NULL)
+            {
+                printf("\nOut of memory");
+                return 1;
+            }
+            sim_seed(incremental, c);
+            sim_seed(scratch, c);
+            sim_params params = {.algorithm = a, .time_quantum = 1 + c % 4};
+            sim_output baseline_out = {0};
+            sim_output whatif_out = {.ct = ct[0], .wt = wt[0], .rt = rt[0]};
+            sim_output scratch_out = {.ct = ct[1], .wt = wt[1], .rt = rt[1]};
+            sim_checkpoints *baseline = NULL;
+            sim_whatif_info info;
+
+            if (sim_run_baseline(incremental, &original, &params, interval, &baseline, &baseline_out) != SIM_OK ||
+                sim_run_whatif(incremental, baseline, &changed, &whatif_out, &info) != SIM_OK ||
+                sim_run(scratch, &changed, &params, &scratch_out) != SIM_OK)
+            {
+                printf("\ncase %d (%d processes) : %s did not run", c, n, sim_policy_name(a));
+                return 1;
+            }
+            runs++;
+            resumed += info.resumed_at > 0;
+            converged += info.converged_at >= 0;
+
+            if (memcmp(ct[0], ct[1], n * sizeof(int)) != 0 || memcmp(wt[0], wt[1], n * sizeof(double)) != 0 ||
+                memcmp(rt[0], rt[1], n * sizeof(double)) != 0 ||
+                !same_summary(&whatif_out.summary, &scratch_out.summary))
+            {
+                if (bad < SHOWN)
+                {
+                    printf("\ncase %d (%d processes) : %s what-if differs, makespan %d / %d, awt %f / %f, "
+                           "resumed at %d, converged at %d",
+                           c, n, sim_policy_name(a), whatif_out.summary.makespan, scratch_out.summary.makespan,
+                           whatif_out.summary.awt, scratch_out.summary.awt, info.resumed_at, info.converged_at);
+                }
+                bad++;
+            }
+            sim_checkpoints_free(baseline);
+            sim_destroy(incremental);
+            sim_destroy(scratch);
+        }
+    }
+
+    printf("\n%d what-if runs, %d resumed from a snapshot, %d converged with the baseline, %d differ\n", runs,
+           resumed, converged, bad);
+    return bad > 0;
+}
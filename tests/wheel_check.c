@@ -0,0 +1,138 @@
+// Regression check of the timing wheel that holds the periodic EDF releases in simulator.c
+// The wheel is driven the way the engine drives it, every timer it hands out is checked against
+// a binary heap on (time, seq) fed the same timers. Some timers are set before the wheel's clock
+// (a job released after its deadline, the overdue heap), many share a time (seq order) and some
+// are far ahead (the upper levels).
+//
+// The wheel is internal to the simulator, so this includes simulator.c instead of linking it :
+// gcc -O2 -I. tests/wheel_check.c -o wheel_check -lm
+// ./wheel_check [workloads]
+//
+// workloads : runs of random timers (default 200). The exit code is 1 when the wheel and the
+// heap disagree.
+
+#define SIMULATOR_NO_MAIN
+#include "../simulator.c"
+
+#define CHECK_TIMERS 512 // processes of a run, every one has at most one timer
+#define CHECK_STEPS 20000
+
+unsigned int check_seed = 43;
+
+int check_random(int bound)
+{
+    check_seed = check_seed * 1103515245u + 12345u;
+    return (int)((check_seed >> 16) % (unsigned int)bound);
+}
+
+// next time of a process' timer, 'now' is the time of the timer just taken out
+int check_time(int now, int spread)
+{
+    switch (check_random(8))
+    {
+    case 0:
+        return now; // same time as others
+    case 1:
+    {
+        int back = check_random(4 * WHEEL_SLOTS); // before the clock : overdue
+        return now > back ? now - back : 0;
+    }
+    case 2:
+        return now + check_random(1 << 24); // upper levels
+    default:
+        return now + check_random(spread);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int workloads = argc > 1 ? atoi(argv[1]) : 200;
+    arena memory = {0};
+    timer_wheel wheel;
+    queue_entry reference[CHECK_TIMERS];
+    int pending[CHECK_TIMERS]; // 1 : the process has a timer
+    long long popped = 0, overdue = 0, ties = 0;
+    int bad = 0;
+
+    for (int w = 0; w < workloads && !bad; w++)
+    {
+        int n = 1 + check_random(CHECK_TIMERS);
+        int spread = 1 + check_random(w % 2 ? 64 : 100000);
+        int start = w % 3 == 0 ? check_random(1 << 28) : 0;
+        int count = 0, seq = 0, now = start, last = -1;
+
+        arena_reset(&memory);
+        if (!wheel_alloc(&wheel, &memory, n))
+        {
+            printf("\nOut of memory");
+            return 1;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            pending[i] = check_random(2);
+            if (pending[i])
+            {
+                queue_entry timer = {start + check_random(spread), seq++, i};
+                wheel_insert(&wheel, timer);
+                heap_push(reference, &count, timer);
+            }
+        }
+
+        for (int step = 0; step < CHECK_STEPS && !bad; step++)
+        {
+            // a process without a timer gets one, as a completed job's next release
+            int i = check_random(n);
+            if (!pending[i])
+            {
+                queue_entry timer = {check_time(now, spread), seq++, i};
+                overdue += timer.key < wheel.clock;
+                wheel_insert(&wheel, timer);
+                heap_push(reference, &count, timer);
+                pending[i] = 1;
+            }
+            if (wheel.count != count || wheel_next(&wheel) != (count > 0 ? reference[0].key : INT_MAX))
+            {
+                printf("\nworkload %d step %d : %d timers, earliest %d, the heap has %d, earliest %lld", w, step,
+                       wheel.count, wheel_next(&wheel), count, count > 0 ? reference[0].key : -1LL);
+                bad = 1;
+                break;
+            }
+            if (count == 0 || check_random(3) == 0)
+            {
+                continue;
+            }
+
+            queue_entry got = wheel_pop(&wheel), expected = heap_pop(reference, &count);
+            if (got.key != expected.key || got.seq != expected.seq || got.index != expected.index)
+            {
+                printf("\nworkload %d step %d : the wheel gave (%lld, %d, %d), the heap (%lld, %d, %d)", w, step,
+                       got.key, got.seq, got.index, expected.key, expected.seq, expected.index);
+                bad = 1;
+                break;
+            }
+            ties += got.key == last;
+            last = (int)got.key;
+            popped++;
+            pending[got.index] = 0;
+            if (got.key > now)
+            {
+                now = (int)got.key;
+            }
+
+            // the popped process is released again right away in most cases
+            if (check_random(4) != 0)
+            {
+                queue_entry timer = {check_time(now, spread), seq++, got.index};
+                overdue += timer.key < wheel.clock;
+                wheel_insert(&wheel, timer);
+                heap_push(reference, &count, timer);
+                pending[got.index] = 1;
+            }
+        }
+    }
+    arena_free(&memory);
+
+    printf("\n%lld timers taken out, %lld set before the clock, %lld at the time of the one before, %s\n", popped,
+           overdue, ties, bad ? "the wheel differs from the heap" : "same order as the heap");
+    return bad;
+}
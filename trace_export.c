@@ -0,0 +1,98 @@
+// Converts trace.bin written by simulator.c (trace_enabled = 1) into the Chrome
+// trace event format, open the output in chrome://tracing or ui.perfetto.dev.
+// Every scheduling algorithm becomes one process row and every cpu one thread,
+// so the run shows up as a Gantt chart. One simulator time unit = 1 microsecond.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC "SCHTRC01"
+#define BLOCK 65536 // records read at a time
+
+#define TRACE_RUN 0
+#define TRACE_SLICE 1
+#define TRACE_COMPLETE 2
+
+struct trace_record
+{
+    int time;     // when the event happened
+    int duration; // length of a slice, 0 for the other events
+    short cpu;    // cpu the event happened on
+    short event;  // TRACE_RUN, TRACE_SLICE or TRACE_COMPLETE
+    int pid;      // process id
+};
+typedef struct trace_record trace_record;
+
+char *algorithm_names[8] = {"Round-Robin", "Priority", "Lottery", "FCFS", "SJF", "SRTN", "HRRN", "EDF"};
+
+int main(int argc, char *argv[])
+{
+    char *input = argc > 1 ? argv[1] : "trace.bin";
+    char *output = argc > 2 ? argv[2] : "trace.json";
+
+    FILE *fptr_read = fopen(input, "rb");
+    if (fptr_read == NULL)
+    {
+        printf("\nCould not open %s", input);
+        return 1;
+    }
+
+    char magic[8];
+    int record_size;
+    if (fread(magic, 1, 8, fptr_read) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+        fread(&record_size, sizeof(int), 1, fptr_read) != 1 || record_size != sizeof(trace_record))
+    {
+        printf("\n%s is not a trace written by this version of the simulator", input);
+        fclose(fptr_read);
+        return 1;
+    }
+
+    FILE *fptr_write = fopen(output, "w");
+    if (fptr_write == NULL)
+    {
+        printf("\nCould not open %s", output);
+        fclose(fptr_read);
+        return 1;
+    }
+
+    trace_record *records = malloc(BLOCK * sizeof(trace_record));
+    int algorithm = 0;
+    long long events = 0;
+    size_t count;
+
+    fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", fptr_write);
+    while ((count = fread(records, sizeof(trace_record), BLOCK, fptr_read)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            trace_record *r = &records[i];
+            fputs(events > 0 ? ",\n" : "\n", fptr_write);
+
+            if (r->event == TRACE_RUN)
+            {
+                algorithm = r->pid;
+                fprintf(fptr_write, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"%s\"}}",
+                        algorithm, algorithm >= 0 && algorithm < 8 ? algorithm_names[algorithm] : "Unknown");
+            }
+            else if (r->event == TRACE_SLICE)
+            {
+                fprintf(fptr_write, "{\"name\": \"P%d\", \"cat\": \"slice\", \"ph\": \"X\", \"ts\": %d, \"dur\": %d, \"pid\": %d, \"tid\": %d}",
+                        r->pid, r->time, r->duration, algorithm, r->cpu);
+            }
+            else
+            {
+                fprintf(fptr_write, "{\"name\": \"P%d done\", \"cat\": \"complete\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %d, \"pid\": %d, \"tid\": %d}",
+                        r->pid, r->time, algorithm, r->cpu);
+            }
+            events++;
+        }
+    }
+    fputs("\n]}\n", fptr_write);
+
+    printf("\nWrote %lld events to %s\n", events, output);
+    free(records);
+    fclose(fptr_read);
+    fclose(fptr_write);
+    return 0;
+}
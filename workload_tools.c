@@ -0,0 +1,1089 @@
+// Offline workload tools of simulator.c : they turn files into workload files and never simulate,
+// so they are a program of their own, built and run like trace_export.c.
+//
+// gcc -O2 workload_tools.c -o workload_tools
+// gcc -O2 -DSIM_PTHREADS=1 -pthread workload_tools.c -o workload_tools (threaded)
+//
+// ./workload_tools --sort <file|-> --out <file> [--memory MB] [--threads t]
+// ./workload_tools --import <trace|-> [--out file] [--threads t] [--unit us]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#ifndef SIM_PTHREADS
+#define SIM_PTHREADS 0 // 1 : the external sort sorts its runs and the trace import parses its blocks on
+                       // threads of their own, build with -pthread
+#endif
+
+#if SIM_PTHREADS
+#include <pthread.h>
+#endif
+
+// External sort : puts a workload file of any size in arrival order within a memory budget. The
+// input is cut into runs that fit the budget, every run is sorted on its own (on a thread of its
+// own with SIM_PTHREADS, while the next one is read) and spilled to a file of fixed-size records.
+// The runs are then merged through a heap, at most as many at a time as the budget has read
+// buffers for, until the last merge writes the workload file format a stream can read.
+#define SORT_DEFAULT_MEMORY 256      // MB of records and read buffers a sort holds at most
+#define SORT_MAX_THREADS 64
+#define SORT_MERGE_BUFFER (1 << 16)  // bytes read ahead from every run being merged
+#define SORT_MAX_FAN_IN 256          // runs open at a time
+#define SORT_LINE_BYTES 24           // text read per record of a run
+
+struct sort_record
+{
+    int values[8]; // at bt priority period no_of_execution quantum cpu_burst io_wait
+};
+typedef struct sort_record sort_record;
+
+struct sort_run
+{
+    char *text;           // lines of the run as read, at most SORT_LINE_BYTES per record on average
+    size_t length;        // bytes of text that belong to the run, what follows goes to the next one
+    sort_record *records; // a budget's share of records, reused by every run read into it
+    unsigned long long *keys; // per record : arrival time above, index below, sorted in place of the records
+    int count;
+    long long skipped;    // lines that are not a process
+    char path[300];       // where the sorted run goes
+    int ok;               // [1 : written, 0 : the write failed]
+};
+typedef struct sort_run sort_run;
+
+struct sort_entry
+{
+    int key; // arrival time of the run's head record
+    int run; // index of the run, a tie goes to the earlier one
+};
+typedef struct sort_entry sort_entry;
+
+
+// Trace import : turns the sched_switch / sched_wakeup records of an ftrace text trace (or perf script
+// output of the same events) into a workload file. A task's job arrives with its wakeup and ends at
+// the switch that takes it off the cpu asleep, its burst is the cpu time it got in between (a
+// preempted task stays runnable, its job goes on). The trace is cut into blocks at line ends, every
+// block is parsed on a thread of its own with SIM_PTHREADS and its records are replayed in trace order.
+#ifndef IMPORT_BLOCK
+#define IMPORT_BLOCK (16 << 20) // bytes of trace a thread parses at a time, tests/import_check.c cuts it short
+#endif
+#define IMPORT_MAX_THREADS 64
+#define IMPORT_SWITCH 0
+#define IMPORT_WAKEUP 1
+
+struct import_event
+{
+    long long time; // microseconds
+    int kind;       // IMPORT_SWITCH or IMPORT_WAKEUP
+    int pid;        // switch : prev_pid, wakeup : the task woken
+    int next_pid;   // switch
+    int prio;       // switch : next_prio, wakeup : prio
+    int asleep;     // switch : prev_state is not R, prev leaves the cpu blocked
+};
+typedef struct import_event import_event;
+
+struct import_block
+{
+    char *text;
+    size_t length;        // bytes that belong to the block, what follows goes to the next one
+    import_event *events; // records of the block in trace order
+    int count;
+    int capacity;
+    long long skipped;    // lines without a scheduling record
+    int ok;               // [1 : parsed, 0 : out of memory]
+};
+typedef struct import_block import_block;
+
+struct import_task
+{
+    long long arrival;   // wakeup of the job in progress, -1 : none
+    long long run_start; // when it got the cpu, -1 : not running
+    long long cpu;       // time the job ran so far
+    int prio;
+};
+typedef struct import_task import_task;
+
+struct import_job
+{
+    long long at;
+    long long bt;
+    int priority;
+};
+typedef struct import_job import_job;
+
+struct import_state
+{
+    import_task *tasks;     // by pid
+    int no_of_tasks;
+    import_job *jobs;       // in the order they ended
+    long long no_of_jobs;
+    long long jobs_capacity;
+    long long start;        // time of the first record, -1 before it
+    long long last;         // time of the last record
+    long long records;      // sched_switch and sched_wakeup records replayed
+    long long skipped;      // lines without one
+};
+typedef struct import_state import_state;
+
+// the process of a workload file line as 8 values, the columns a line leaves out take the
+// defaults read_process of simulator.c gives them. 0 when the line is not a process
+int sort_read(char *line, sort_record *record)
+{
+    int values[8];
+    int count = 0;
+    for (char *next = line, *end; count < 8; next = end)
+    {
+        long value = strtol(next, &end, 10);
+        if (end == next)
+        {
+            break;
+        }
+        values[count++] = (int)value;
+    }
+    if (count < 2 || line[0] == '#')
+    {
+        return 0;
+    }
+    int *v = record->values;
+    v[0] = values[0];
+    v[1] = values[1];
+    v[2] = count >= 3 ? values[2] : 1;
+    v[3] = count >= 4 ? values[3] : values[1];
+    v[4] = count >= 5 ? values[4] : 1;
+    v[5] = count >= 6 && values[5] > 0 ? values[5] : 0;
+    v[6] = count >= 8 && values[6] > 0 ? values[6] : 0;
+    v[7] = count >= 8 && values[7] > 0 ? values[7] : 0;
+    return 1;
+}
+
+int sort_before(sort_entry x, sort_entry y)
+{
+    return x.key < y.key || (x.key == y.key && x.run < y.run);
+}
+
+// binary heap of the runs being merged, earliest head first
+void sort_push(sort_entry *heap, int *count, sort_entry entry)
+{
+    int i = (*count)++;
+    while (i > 0 && sort_before(entry, heap[(i - 1) / 2]))
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = entry;
+}
+
+sort_entry sort_pop(sort_entry *heap, int *count)
+{
+    sort_entry top = heap[0];
+    sort_entry last = heap[--(*count)];
+    int i = 0;
+    while (2 * i + 1 < *count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < *count && sort_before(heap[child + 1], heap[child]))
+        {
+            child++;
+        }
+        if (!sort_before(heap[child], last))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// sort keys of a run : arrival time, then the order the records were read in
+int compare_key(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return (x > y) - (x < y);
+}
+
+// parses, sorts and spills a run, the start routine of a run's thread
+void *sort_run_write(void *arg)
+{
+    sort_run *run = arg;
+    run->count = 0;
+    run->skipped = 0;
+    for (char *line = run->text, *end = run->text + run->length; line < end;)
+    {
+        char *newline = memchr(line, '\n', end - line);
+        char *next = newline != NULL ? newline + 1 : end;
+        *(newline != NULL ? newline : end) = '\0'; // sort_read reads one line
+        if (sort_read(line, &run->records[run->count]))
+        {
+            // the sign bit flipped, so negative times order before the others as unsigned
+            unsigned int at = (unsigned int)run->records[run->count].values[0];
+            run->keys[run->count] = ((unsigned long long)(at ^ 0x80000000u) << 32) | (unsigned int)run->count;
+            run->count++;
+        }
+        else
+        {
+            run->skipped++;
+        }
+        line = next;
+    }
+
+    // 8 bytes a record move instead of the whole record
+    qsort(run->keys, run->count, sizeof(unsigned long long), compare_key);
+    FILE *fptr = fopen(run->path, "wb");
+    run->ok = fptr != NULL;
+    for (int k = 0; run->ok && k < run->count; k++)
+    {
+        run->ok = fwrite(&run->records[run->keys[k] & 0xFFFFFFFFu], sizeof(sort_record), 1, fptr) == 1;
+    }
+    if (fptr != NULL && fclose(fptr) != 0)
+    {
+        run->ok = 0;
+    }
+    return NULL;
+}
+
+// writes value in decimal at s, the no. of characters written
+int sort_format(char *s, int value)
+{
+    char digits[12];
+    int count = 0, length = 0;
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do
+    {
+        digits[count++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (value < 0)
+    {
+        s[length++] = '-';
+    }
+    while (count > 0)
+    {
+        s[length++] = digits[--count];
+    }
+    return length;
+}
+
+// merges the sorted runs in paths into out, as records or (text) in the workload file format.
+// Runs are in input order, so a tie goes to the earlier run. 0 when a run cannot be read or out written.
+int sort_merge(char (*paths)[300], int k, FILE *out, int text)
+{
+    size_t size = k > 0 ? k : 1;
+    FILE **runs = calloc(size, sizeof(FILE *));
+    sort_record *heads = malloc(size * sizeof(sort_record));
+    sort_entry *heap = malloc(size * sizeof(sort_entry));
+    int count = 0, ok = runs != NULL && heads != NULL && heap != NULL;
+
+    for (int j = 0; ok && j < k; j++)
+    {
+        runs[j] = fopen(paths[j], "rb");
+        ok = runs[j] != NULL;
+        if (ok)
+        {
+            setvbuf(runs[j], NULL, _IOFBF, SORT_MERGE_BUFFER);
+            if (fread(&heads[j], sizeof(sort_record), 1, runs[j]) == 1)
+            {
+                sort_push(heap, &count, (sort_entry){heads[j].values[0], j});
+            }
+        }
+    }
+    while (ok && count > 0)
+    {
+        int j = sort_pop(heap, &count).run;
+        const int *v = heads[j].values;
+        if (text)
+        {
+            // printf would take longer than the merge itself
+            char line[8 * 12];
+            int length = 0;
+            for (int c = 0; c < 8; c++)
+            {
+                length += sort_format(line + length, v[c]);
+                line[length++] = c < 7 ? ' ' : '\n';
+            }
+            ok = fwrite(line, 1, length, out) == (size_t)length;
+        }
+        else
+        {
+            ok = fwrite(&heads[j], sizeof(sort_record), 1, out) == 1;
+        }
+        if (fread(&heads[j], sizeof(sort_record), 1, runs[j]) == 1)
+        {
+            sort_push(heap, &count, (sort_entry){heads[j].values[0], j});
+        }
+    }
+
+    for (int j = 0; runs != NULL && j < k; j++)
+    {
+        if (runs[j] != NULL)
+        {
+            ok &= !ferror(runs[j]);
+            fclose(runs[j]);
+        }
+    }
+    free(runs);
+    free(heads);
+    free(heap);
+    return ok;
+}
+
+// writes the processes of in to output in arrival order holding about memory bytes, lines that
+// are not a process are left out. Runs go next to output and are removed when merged.
+// 0 when out of memory or a file could not be written
+int sort_workload(FILE *in, const char *output, long long memory, int threads, long long *records, long long *skipped)
+{
+    *records = 0;
+    *skipped = 0;
+#if SIM_PTHREADS
+    threads = threads < 1 ? 1 : threads > SORT_MAX_THREADS ? SORT_MAX_THREADS : threads;
+    pthread_t workers[SORT_MAX_THREADS];
+    int started[SORT_MAX_THREADS] = {0};
+#else
+    threads = 1;
+#endif
+
+    // every thread parses and sorts a share of the budget : its text, its records and their keys
+    // (twice, qsort may take a copy)
+    long long share = memory / threads / (long long)(SORT_LINE_BYTES + sizeof(sort_record) + 2 * sizeof(unsigned long long));
+    int capacity = share < 1024 ? 1024 : share > INT_MAX / SORT_LINE_BYTES ? INT_MAX / SORT_LINE_BYTES : (int)share;
+    size_t text_size = (size_t)capacity * SORT_LINE_BYTES;
+    sort_run runs[SORT_MAX_THREADS] = {0};
+    char (*paths)[300] = NULL;
+    int no_of_runs = 0, paths_size = 0, ok = 1, next_name = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        runs[t].text = malloc(text_size + 1);
+        runs[t].records = malloc(capacity * sizeof(sort_record));
+        runs[t].keys = malloc(capacity * sizeof(unsigned long long));
+        ok &= runs[t].text != NULL && runs[t].records != NULL && runs[t].keys != NULL;
+    }
+
+    // run generation : the input is read in blocks, a run is the complete lines of a block (no
+    // more than it has records for) and the rest begins the next one. While a run is parsed and
+    // sorted on its thread the next block is read.
+    size_t filled = 0;
+    int t = 0, at_end = 0;
+    while (ok)
+    {
+        sort_run *run = &runs[t];
+        if (!at_end)
+        {
+            filled += fread(run->text + filled, 1, text_size - filled, in);
+            at_end = filled < text_size;
+        }
+        if (filled == 0)
+        {
+            break;
+        }
+        size_t length = 0;
+        for (int lines = 0; length < filled && lines < capacity; lines++)
+        {
+            char *newline = memchr(run->text + length, '\n', filled - length);
+            if (newline == NULL)
+            {
+                if (at_end || length == 0)
+                {
+                    length = filled; // the last line, or one longer than a block (cut)
+                }
+                break;
+            }
+            length = newline - run->text + 1;
+        }
+        run->length = length;
+
+        if (no_of_runs == paths_size)
+        {
+            paths_size = paths_size > 0 ? 2 * paths_size : 64;
+            char (*grown)[300] = realloc(paths, paths_size * sizeof(*paths));
+            if (grown == NULL)
+            {
+                ok = 0;
+                break;
+            }
+            paths = grown;
+        }
+        snprintf(run->path, sizeof(run->path), "%s.run%d", output, next_name++);
+        memcpy(paths[no_of_runs++], run->path, sizeof(run->path));
+
+        int next = t;
+#if SIM_PTHREADS
+        started[t] = pthread_create(&workers[t], NULL, sort_run_write, run) == 0;
+        next = (t + 1) % threads;
+        if (!started[t])
+        {
+            sort_run_write(run);
+            ok &= run->ok;
+            *records += run->count;
+            *skipped += run->skipped;
+        }
+        // the next block goes where the run before last was, once it is written
+        if (started[next])
+        {
+            pthread_join(workers[next], NULL);
+            started[next] = 0;
+            ok &= runs[next].ok;
+            *records += runs[next].count;
+            *skipped += runs[next].skipped;
+        }
+#else
+        sort_run_write(run);
+        ok &= run->ok;
+        *records += run->count;
+        *skipped += run->skipped;
+#endif
+        // the run's thread only reads up to its length, what follows starts the next block
+        filled -= length;
+        memmove(runs[next].text, run->text + length, filled);
+        t = next;
+    }
+#if SIM_PTHREADS
+    for (int u = 0; u < threads; u++)
+    {
+        if (started[u])
+        {
+            pthread_join(workers[u], NULL);
+            ok &= runs[u].ok;
+            *records += runs[u].count;
+            *skipped += runs[u].skipped;
+        }
+    }
+#endif
+    for (int u = 0; u < threads; u++)
+    {
+        free(runs[u].text);
+        free(runs[u].records);
+        free(runs[u].keys);
+    }
+    ok &= !ferror(in);
+
+    // merge passes : consecutive runs k at a time, so ties still go to the earlier input
+    long long buffers = memory / SORT_MERGE_BUFFER;
+    int fan_in = buffers < 2 ? 2 : buffers > SORT_MAX_FAN_IN ? SORT_MAX_FAN_IN : (int)buffers;
+    while (ok && no_of_runs > fan_in)
+    {
+        int merged = 0;
+        for (int first = 0; ok && first < no_of_runs; first += fan_in)
+        {
+            int k = no_of_runs - first < fan_in ? no_of_runs - first : fan_in;
+            char path[300];
+            snprintf(path, sizeof(path), "%s.run%d", output, next_name++);
+            FILE *fptr = fopen(path, "wb");
+            ok = fptr != NULL && sort_merge(paths + first, k, fptr, 0);
+            if (fptr != NULL && fclose(fptr) != 0)
+            {
+                ok = 0;
+            }
+            for (int j = first; j < first + k; j++)
+            {
+                remove(paths[j]);
+            }
+            if (!ok)
+            {
+                // what is left goes, the runs merged so far are removed below
+                remove(path);
+                for (int j = first + k; j < no_of_runs; j++)
+                {
+                    remove(paths[j]);
+                }
+                break;
+            }
+            memcpy(paths[merged++], path, sizeof(path));
+        }
+        no_of_runs = merged;
+    }
+
+    FILE *out = ok ? fopen(output, "w") : NULL;
+    ok = out != NULL && sort_merge(paths, no_of_runs, out, 1);
+    if (out != NULL && fclose(out) != 0)
+    {
+        ok = 0;
+    }
+    for (int j = 0; j < no_of_runs; j++)
+    {
+        remove(paths[j]);
+    }
+    free(paths);
+    return ok;
+}
+
+// realloc keeping *array when it fails, 0 then
+int import_resize(void **array, size_t size)
+{
+    void *grown = realloc(*array, size);
+    if (grown == NULL)
+    {
+        return 0;
+    }
+    *array = grown;
+    return 1;
+}
+
+// pid and prio of a task written "comm:pid [prio]" between start and end, the last " [" opens the
+// prio (a comm may hold spaces and ':'). Where the task ends, NULL when it is not written so
+char *import_short_task(char *start, char *end, int *pid, int *prio)
+{
+    char *open = NULL;
+    for (char *c = start; c + 1 < end; c++)
+    {
+        if (c[0] == ' ' && c[1] == '[')
+        {
+            open = c;
+        }
+    }
+    if (open == NULL)
+    {
+        return NULL;
+    }
+    char *digits = open;
+    while (digits > start && digits[-1] >= '0' && digits[-1] <= '9')
+    {
+        digits--;
+    }
+    char *close = memchr(open, ']', end - open);
+    if (digits == open || digits == start || digits[-1] != ':' || close == NULL)
+    {
+        return NULL;
+    }
+    *pid = atoi(digits);
+    *prio = atoi(open + 2);
+    return close + 1;
+}
+
+// the fields of a record in the short form trace-cmd report and perf script print (libtraceevent's
+// sched plugin) : "prev_comm:prev_pid [prev_prio] prev_state ==> next_comm:next_pid [next_prio]"
+// and "comm:pid [prio] CPU:001" (with "success=1" before CPU on older kernels). 0 when it is not one
+int import_short_record(char *fields, import_event *ev)
+{
+    char *end = fields + strlen(fields);
+    int prio;
+    ev->next_pid = 0;
+    ev->asleep = 0;
+    if (ev->kind == IMPORT_WAKEUP)
+    {
+        return import_short_task(fields, end, &ev->pid, &ev->prio) != NULL;
+    }
+
+    char *arrow = strstr(fields, " ==> ");
+    char *state = arrow != NULL ? import_short_task(fields, arrow, &ev->pid, &prio) : NULL;
+    if (state == NULL || import_short_task(arrow + 5, end, &ev->next_pid, &ev->prio) == NULL)
+    {
+        return 0;
+    }
+    while (*state == ' ')
+    {
+        state++;
+    }
+    ev->asleep = *state != 'R';
+    return 1;
+}
+
+// the scheduling record of one trace line, 0 for any other line
+int import_record(char *line, import_event *ev)
+{
+    char *event = strstr(line, "sched_");
+    while (event != NULL && strncmp(event + 6, "switch:", 7) != 0 && strncmp(event + 6, "wakeup", 6) != 0)
+    {
+        event = strstr(event + 6, "sched_");
+    }
+    if (event == NULL)
+    {
+        return 0;
+    }
+    ev->kind = event[6] == 's' ? IMPORT_SWITCH : IMPORT_WAKEUP; // sched_wakeup_new is a wakeup too
+
+    // the timestamp is the token before the event's ("1234.567890:" or "1234.567890: sched:")
+    char *stamp = event;
+    while (stamp > line && stamp[-1] != ' ')
+    {
+        stamp--;
+    }
+    while (stamp > line && stamp[-1] == ' ')
+    {
+        stamp--;
+    }
+    while (stamp > line && stamp[-1] != ' ' && stamp[-1] != ']')
+    {
+        stamp--;
+    }
+    char *fraction;
+    long long seconds = strtoll(stamp, &fraction, 10);
+    if (fraction == stamp || *fraction != '.')
+    {
+        return 0;
+    }
+    long long micro = 0;
+    int digits = 0;
+    for (fraction++; digits < 6 && *fraction >= '0' && *fraction <= '9'; fraction++, digits++)
+    {
+        micro = 10 * micro + (*fraction - '0');
+    }
+    for (; digits < 6; digits++)
+    {
+        micro *= 10;
+    }
+    ev->time = seconds * 1000000 + micro;
+
+    // fields are looked up by name, a comm may hold spaces
+    char *pid = strstr(event, ev->kind == IMPORT_SWITCH ? " prev_pid=" : " pid=");
+    char *prio = strstr(event, ev->kind == IMPORT_SWITCH ? " next_prio=" : " prio=");
+    if (pid == NULL || prio == NULL)
+    {
+        char *fields = strchr(event, ':');
+        return fields != NULL && import_short_record(fields + 1, ev);
+    }
+    ev->pid = atoi(strchr(pid, '=') + 1);
+    ev->prio = atoi(strchr(prio, '=') + 1);
+    ev->next_pid = 0;
+    ev->asleep = 0;
+    if (ev->kind == IMPORT_SWITCH)
+    {
+        char *next = strstr(event, " next_pid=");
+        char *state = strstr(event, " prev_state=");
+        if (next == NULL || state == NULL)
+        {
+            return 0;
+        }
+        ev->next_pid = atoi(next + 10);
+        ev->asleep = state[12] != 'R';
+    }
+    return 1;
+}
+
+// parses the records of a block, the start routine of a block's thread
+void *import_parse(void *arg)
+{
+    import_block *block = arg;
+    block->count = 0;
+    block->skipped = 0;
+    block->ok = 1;
+    for (char *line = block->text, *end = block->text + block->length; line < end;)
+    {
+        char *newline = memchr(line, '\n', end - line);
+        char *next = newline != NULL ? newline + 1 : end;
+        *(newline != NULL ? newline : end) = '\0';
+        if (block->count == block->capacity)
+        {
+            int size = block->capacity > 0 ? 2 * block->capacity : 1 << 16;
+            if (!import_resize((void **)&block->events, size * sizeof(import_event)))
+            {
+                block->ok = 0;
+                return NULL;
+            }
+            block->capacity = size;
+        }
+        if (import_record(line, &block->events[block->count]))
+        {
+            block->count++;
+        }
+        else
+        {
+            block->skipped++;
+        }
+        line = next;
+    }
+    return NULL;
+}
+
+// the state of pid, the table grows to the largest pid seen. NULL when out of memory
+import_task *import_find(import_state *s, int pid)
+{
+    if (pid >= s->no_of_tasks)
+    {
+        int size = s->no_of_tasks > 0 ? s->no_of_tasks : 1024;
+        while (size <= pid)
+        {
+            size *= 2;
+        }
+        if (!import_resize((void **)&s->tasks, size * sizeof(import_task)))
+        {
+            return NULL;
+        }
+        for (int i = s->no_of_tasks; i < size; i++)
+        {
+            s->tasks[i] = (import_task){-1, -1, 0, 0};
+        }
+        s->no_of_tasks = size;
+    }
+    return &s->tasks[pid];
+}
+
+// ends the job of task, a job that never ran is dropped. 0 when out of memory
+int import_close(import_state *s, import_task *task)
+{
+    if (task->cpu > 0)
+    {
+        if (s->no_of_jobs == s->jobs_capacity)
+        {
+            long long size = s->jobs_capacity > 0 ? 2 * s->jobs_capacity : 1 << 16;
+            if (!import_resize((void **)&s->jobs, size * sizeof(import_job)))
+            {
+                return 0;
+            }
+            s->jobs_capacity = size;
+        }
+        s->jobs[s->no_of_jobs++] = (import_job){task->arrival, task->cpu, task->prio};
+    }
+    task->arrival = -1;
+    task->cpu = 0;
+    return 1;
+}
+
+// applies the records of a parsed block to the tasks, 0 when out of memory. The idle task (pid 0)
+// is not a job, a task found on the cpu without a wakeup arrives when it gets there.
+int import_replay(import_state *s, import_block *block)
+{
+    s->records += block->count;
+    s->skipped += block->skipped;
+    for (int k = 0; k < block->count; k++)
+    {
+        const import_event *ev = &block->events[k];
+        if (s->start == -1)
+        {
+            s->start = ev->time;
+        }
+        s->last = ev->time;
+        if (ev->kind == IMPORT_WAKEUP)
+        {
+            import_task *task = ev->pid > 0 ? import_find(s, ev->pid) : NULL;
+            if (ev->pid > 0 && task == NULL)
+            {
+                return 0;
+            }
+            if (task != NULL && task->arrival == -1)
+            {
+                task->arrival = ev->time;
+                task->prio = ev->prio;
+            }
+            continue;
+        }
+
+        import_task *prev = ev->pid > 0 ? import_find(s, ev->pid) : NULL;
+        import_task *next = ev->next_pid > 0 ? import_find(s, ev->next_pid) : NULL;
+        if ((ev->pid > 0 && prev == NULL) || (ev->next_pid > 0 && next == NULL))
+        {
+            return 0;
+        }
+        if (prev != NULL && prev->run_start != -1)
+        {
+            prev->cpu += ev->time - prev->run_start;
+            prev->run_start = -1;
+        }
+        if (prev != NULL && ev->asleep && prev->arrival != -1 && !import_close(s, prev))
+        {
+            return 0;
+        }
+        if (next != NULL)
+        {
+            if (next->arrival == -1)
+            {
+                next->arrival = ev->time;
+            }
+            next->run_start = ev->time;
+            next->prio = ev->prio;
+        }
+    }
+    block->count = 0;
+    block->skipped = 0;
+    return block->ok;
+}
+
+// ends the jobs the trace cut off and writes all of them in arrival order, times from the first
+// record in units of unit microseconds (a burst takes at least 1). 1 when written, 0 when out of
+// memory or the file could not be written, -1 when a time does not fit the workload format.
+int import_write(import_state *s, FILE *out, int unit)
+{
+    for (int pid = 0; pid < s->no_of_tasks; pid++)
+    {
+        import_task *task = &s->tasks[pid];
+        if (task->arrival != -1)
+        {
+            if (task->run_start != -1)
+            {
+                task->cpu += s->last - task->run_start;
+            }
+            if (!import_close(s, task))
+            {
+                return 0;
+            }
+        }
+    }
+    if (s->no_of_jobs > 0xFFFFFFFFLL || (s->last - s->start) / unit > INT_MAX)
+    {
+        return -1;
+    }
+
+    // arrival above, index below, like the runs of the external sort
+    unsigned long long *keys = malloc((s->no_of_jobs > 0 ? s->no_of_jobs : 1) * sizeof(unsigned long long));
+    if (keys == NULL)
+    {
+        return 0;
+    }
+    for (long long j = 0; j < s->no_of_jobs; j++)
+    {
+        keys[j] = (unsigned long long)((s->jobs[j].at - s->start) / unit) << 32 | (unsigned long long)j;
+    }
+    qsort(keys, s->no_of_jobs, sizeof(unsigned long long), compare_key);
+
+    char line[40];
+    int ok = 1;
+    for (long long k = 0; ok && k < s->no_of_jobs; k++)
+    {
+        const import_job *job = &s->jobs[keys[k] & 0xFFFFFFFFu];
+        long long bt = (job->bt + unit / 2) / unit;
+        int length = sort_format(line, (int)(keys[k] >> 32));
+        line[length++] = ' ';
+        length += sort_format(line + length, bt < 1 ? 1 : bt > INT_MAX ? INT_MAX : (int)bt);
+        line[length++] = ' ';
+        length += sort_format(line + length, job->priority);
+        line[length++] = '\n';
+        ok = fwrite(line, 1, length, out) == (size_t)length;
+    }
+    free(keys);
+    return ok;
+}
+
+// reads the trace in blocks, parsing up to threads of them at once, and writes the workload.
+// The result of import_write, or 0 when out of memory. s keeps the counts.
+int import_trace(FILE *in, FILE *out, int threads, int unit, import_state *s)
+{
+#if SIM_PTHREADS
+    threads = threads < 1 ? 1 : threads > IMPORT_MAX_THREADS ? IMPORT_MAX_THREADS : threads;
+    pthread_t workers[IMPORT_MAX_THREADS];
+    int started[IMPORT_MAX_THREADS] = {0};
+#else
+    threads = 1;
+#endif
+    import_block blocks[IMPORT_MAX_THREADS] = {0};
+    int ok = 1;
+    for (int t = 0; t < threads; t++)
+    {
+        blocks[t].text = malloc(IMPORT_BLOCK + 1);
+        blocks[t].ok = 1;
+        ok &= blocks[t].text != NULL;
+    }
+
+    // blocks go round the threads : a block is replayed when its thread is needed for the next
+    // read, after every block read before it, while the blocks read after it are being parsed
+    size_t filled = 0;
+    int t = 0, at_end = 0;
+    while (ok)
+    {
+        import_block *block = &blocks[t];
+        if (!at_end)
+        {
+            filled += fread(block->text + filled, 1, IMPORT_BLOCK - filled, in);
+            at_end = filled < IMPORT_BLOCK;
+        }
+        if (filled == 0)
+        {
+            break;
+        }
+        size_t length = filled;
+        while (!at_end && length > 0 && block->text[length - 1] != '\n')
+        {
+            length--;
+        }
+        block->length = length > 0 ? length : filled; // the last line, or one longer than a block (cut)
+
+        int next = t;
+#if SIM_PTHREADS
+        started[t] = pthread_create(&workers[t], NULL, import_parse, block) == 0;
+        if (!started[t])
+        {
+            import_parse(block);
+        }
+        next = (t + 1) % threads;
+        if (started[next])
+        {
+            pthread_join(workers[next], NULL);
+            started[next] = 0;
+        }
+#else
+        import_parse(block);
+#endif
+        ok = import_replay(s, &blocks[next]);
+
+        // the block's thread only reads up to its length, what follows starts the next block
+        filled -= block->length;
+        memmove(blocks[next].text, block->text + block->length, filled);
+        t = next;
+    }
+#if SIM_PTHREADS
+    for (int u = 0; u < threads; u++)
+    {
+        int oldest = (t + u) % threads;
+        if (started[oldest])
+        {
+            pthread_join(workers[oldest], NULL);
+        }
+        ok = ok && import_replay(s, &blocks[oldest]);
+    }
+#endif
+    for (int u = 0; u < threads; u++)
+    {
+        free(blocks[u].text);
+        free(blocks[u].events);
+    }
+    ok = ok && !ferror(in);
+    return ok ? import_write(s, out, unit) : 0;
+}
+
+// Sort mode : workload_tools --sort <file|-> --out <file> [--memory MB] [--threads t]
+// Writes the processes of a workload file in arrival order (arrivals of the same time in the
+// order they were read) for the simulator's --stream, holding about --memory MB (default 256) whatever the size
+// of the input. With SIM_PTHREADS runs are sorted on up to --threads threads (default 1).
+int sort_main(int argc, char *argv[])
+{
+    char *file = NULL, *output = NULL;
+    int megabytes = SORT_DEFAULT_MEMORY, threads = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc)
+        {
+            file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc && (megabytes = atoi(argv[++i])) > 0)
+        {
+            continue;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && (threads = atoi(argv[++i])) > 0)
+        {
+            continue;
+        }
+        else
+        {
+            file = NULL;
+            break;
+        }
+    }
+    if (file == NULL || output == NULL)
+    {
+        fprintf(stderr, "Usage : %s --sort <file|-> --out <file> [--memory MB] [--threads t]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *fptr = strcmp(file, "-") == 0 ? stdin : fopen(file, "r");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", file);
+        return 1;
+    }
+    long long records, skipped;
+    int ok = sort_workload(fptr, output, (long long)megabytes << 20, threads, &records, &skipped);
+    if (fptr != stdin)
+    {
+        fclose(fptr);
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "Could not sort %s into %s (out of memory or disk)\n", file, output);
+        return 1;
+    }
+    fprintf(stderr, "%lld process(es) sorted into %s, %lld line(s) without a process left out\n", records, output,
+            skipped);
+    return 0;
+}
+
+// Import mode : workload_tools --import <trace|-> [--out file] [--threads t] [--unit us]
+// Writes the jobs of an ftrace text trace (sched_switch and sched_wakeup events, e.g. the trace
+// file of trace-cmd or /sys/kernel/tracing) or of perf script over the same events as a workload
+// file in arrival order : "at bt priority" a job, times in --unit microseconds (default 1) from the
+// first record and the kernel prio as priority. The jobs of every cpu of the host go to the one
+// simulated cpu. With SIM_PTHREADS the trace is parsed on up to --threads threads (default 1).
+int import_main(int argc, char *argv[])
+{
+    char *file = NULL, *output = NULL;
+    int threads = 1, unit = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+        {
+            file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && (threads = atoi(argv[++i])) > 0)
+        {
+            continue;
+        }
+        else if (strcmp(argv[i], "--unit") == 0 && i + 1 < argc && (unit = atoi(argv[++i])) > 0)
+        {
+            continue;
+        }
+        else
+        {
+            file = NULL;
+            break;
+        }
+    }
+    if (file == NULL)
+    {
+        fprintf(stderr, "Usage : %s --import <trace|-> [--out file] [--threads t] [--unit us]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *fptr = strcmp(file, "-") == 0 ? stdin : fopen(file, "r");
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", file);
+        return 1;
+    }
+    FILE *out = output != NULL ? fopen(output, "w") : stdout;
+    if (out == NULL)
+    {
+        fprintf(stderr, "Could not create %s\n", output);
+        if (fptr != stdin)
+        {
+            fclose(fptr);
+        }
+        return 1;
+    }
+    import_state s = {0};
+    s.start = -1;
+    int ok = import_trace(fptr, out, threads, unit, &s);
+    long long jobs = s.no_of_jobs;
+    free(s.tasks);
+    free(s.jobs);
+    if (fptr != stdin)
+    {
+        fclose(fptr);
+    }
+    if (out != stdout && fclose(out) != 0 && ok == 1)
+    {
+        ok = 0;
+    }
+    if (ok != 1)
+    {
+        fprintf(stderr, ok == -1 ? "%s spans more time than a workload holds, try a larger --unit\n"
+                                 : "Could not import %s (out of memory or disk)\n",
+                file);
+        return 1;
+    }
+    fprintf(stderr, "%lld job(s) from %lld scheduling record(s), %lld other line(s) left out\n", jobs, s.records,
+            s.skipped);
+    return 0;
+}
+
+#ifndef WORKLOAD_TOOLS_NO_MAIN // the checks in tests/ bring their own main
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--sort") == 0)
+    {
+        return sort_main(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--import") == 0)
+    {
+        return import_main(argc, argv);
+    }
+    fprintf(stderr, "Usage : %s --sort <file|-> --out <file> [--memory MB] [--threads t]\n", argv[0]);
+    fprintf(stderr, "        %s --import <trace|-> [--out file] [--threads t] [--unit us]\n", argv[0]);
+    return 2;
+}
+#endif